@@ -0,0 +1,317 @@
+/**
+ * AES-128.
+ *
+ * There's no XOR on the DMAC, so XOR is a chain of lookups, one per digit: the running value is
+ * written into the low byte of the next lookup's source address and the digit of the other operand
+ * picks the page, so a byte XOR is DIGITS_PER_BYTE lookups plus the page lookups. The tables that
+ * pick the page can be anything that maps a byte to a digit, which is where the cipher goes:
+ * SubBytes and the MixColumns multiplies are baked into them, and a whole round of one column is
+ * the round key XORed with 4 table-mapped state bytes per output byte. ShiftRows is just which
+ * bytes of the old state get read for each column.
+ *
+ * The 40 column-rounds run as one loop. The loop counter picks the old state bytes, the round key
+ * column and where the new column goes (the state ping-pongs between two buffers, one per round
+ * parity), and the last 4 passes branch off to a round without MixColumns.
+ *
+ * Decryption is the equivalent inverse cipher from FIPS-197, which has the same shape as
+ * encryption with the inverse tables and InvMixColumns applied to the middle round keys. Key
+ * expansion is done by the CPU, once per key.
+ */
+
+#include "aes.h"
+#include "dmainstrs.h"
+
+// Layout of the first page of scratch.
+#define TARGETS_OFFSET      0
+#define LAST_OFFSET         8
+#define STATE_OFFSET(n)     (16 + (16 * (n)))
+#define COLUMN_OFFSET       48
+#define MIXED_OFFSET        52
+#define KEY_OFFSET          56
+#define PASSES_OFFSET       60
+#define COUNT_OFFSET        61
+
+#define AES128_PASSES (4 * AES128_ROUNDS)
+
+static uint8_t gf_xtime(uint8_t x)
+{
+    return (uint8_t)((x << 1) ^ ((x & 0x80) ? 0x1b : 0x00));
+}
+
+static uint8_t gf_mul(uint8_t a, uint8_t b)
+{
+    uint8_t p = 0;
+    for (; b; b >>= 1) {
+        if (b & 1) { p ^= a; }
+        a = gf_xtime(a);
+    }
+    return p;
+}
+
+/**
+ * x^-1 in GF(2^8) as x^254, with 0 mapping to 0.
+ */
+static uint8_t gf_inv(uint8_t x)
+{
+    uint8_t result = 1;
+    uint8_t square = x;
+    for (uint32_t e = 254; e; e >>= 1) {
+        if (e & 1) { result = gf_mul(result, square); }
+        square = gf_mul(square, square);
+    }
+    return result;
+}
+
+static uint8_t rotl8(uint8_t x, uint32_t n)
+{
+    return (uint8_t)((x << n) | (x >> (8 - n)));
+}
+
+static uint8_t aes_sbox(uint8_t x)
+{
+    uint8_t b = gf_inv(x);
+    return b ^ rotl8(b, 1) ^ rotl8(b, 2) ^ rotl8(b, 3) ^ rotl8(b, 4) ^ 0x63;
+}
+
+static uint8_t aes_inv_sbox(uint8_t x)
+{
+    return gf_inv(rotl8(x, 1) ^ rotl8(x, 3) ^ rotl8(x, 6) ^ 0x05);
+}
+
+/**
+ * Byte 'row' of column 'col' = the 4 bytes at col[0..3] run through MixColumns (or InvMixColumns).
+ */
+static uint8_t mix_byte(const uint8_t* m, const uint8_t* col, uint32_t row)
+{
+    uint8_t b = 0;
+    for (uint32_t j = 0; j < 4; j++) { b ^= gf_mul(m[j], col[(row + j) & 3]); }
+    return b;
+}
+
+static const uint8_t mix_encrypt[4] = { 2, 3, 1, 1 };
+static const uint8_t mix_decrypt[4] = { 14, 11, 13, 9 };
+
+/**
+ * Fills out the tables for encrypting (decrypt == 0) or decrypting. 'mem' must start on a 256-byte
+ * boundary and have room for AES_ENGINE_SIZE bytes. The tables assume the scratch layout used by
+ * build_aes128().
+ */
+void setup_aes_engine(aes_engine_t* eng, int decrypt, uint8_t* mem)
+{
+    const uint8_t* m = decrypt ? mix_decrypt : mix_encrypt;
+    uint8_t* p = mem;
+    uint8_t* mix[4][DIGITS_PER_BYTE];
+    uint8_t* last[DIGITS_PER_BYTE];
+    uint8_t* key[DIGITS_PER_BYTE];
+
+    eng->decrypt = decrypt;
+
+    for (uint32_t i = 0; i < DIGITS_PER_BYTE; i++) {
+        eng->xor[i] = p;
+        for (uint32_t page = 0; page < DIGIT_VALUES; page++) {
+            for (uint32_t count = 0; count < 256; count++) {
+                p[count] = count ^ (page << (i * DIGIT_BITS));
+            }
+            p += 256;
+        }
+    }
+    for (uint32_t j = 0; j < 4; j++) {
+        for (uint32_t i = 0; i < DIGITS_PER_BYTE; i++) { eng->mix[j][i] = mix[j][i] = p; p += 256; }
+    }
+    for (uint32_t i = 0; i < DIGITS_PER_BYTE; i++) { eng->last[i] = last[i] = p; p += 256; }
+    for (uint32_t i = 0; i < DIGITS_PER_BYTE; i++) { eng->key[i] = key[i] = p; p += 256; }
+
+    for (uint32_t count = 0; count < 256; count++) {
+        const uint8_t s = decrypt ? aes_inv_sbox(count) : aes_sbox(count);
+        for (uint32_t i = 0; i < DIGITS_PER_BYTE; i++) {
+            const uint8_t xor_page = lut_page(eng->xor[i]);
+            const uint32_t shift = i * DIGIT_BITS;
+            for (uint32_t j = 0; j < 4; j++) {
+                mix[j][i][count] = xor_page + ((gf_mul(m[j], s) >> shift) & DIGIT_MASK);
+            }
+            last[i][count] = xor_page + ((s >> shift) & DIGIT_MASK);
+            key[i][count] = xor_page + ((count >> shift) & DIGIT_MASK);
+        }
+    }
+
+    // Pass 'count' of the loop is column c of round r, counting from round 1.
+    uint8_t* read[4];
+    for (uint32_t row = 0; row < 4; row++) { eng->read[row] = read[row] = p; p += 256; }
+    uint8_t* write = p;
+    eng->write = write;
+    p += 256;
+    uint8_t* last_round = p;
+    eng->last_round = last_round;
+    p += 256;
+    for (uint32_t count = 0; count < 256; count++) {
+        const uint32_t pass = (AES128_PASSES - count) & 0xff;
+        const uint32_t r = (pass / 4) + 1;
+        const uint32_t c = pass % 4;
+        for (uint32_t row = 0; row < 4; row++) {
+            const uint32_t shifted = decrypt ? ((c - row) & 3) : ((c + row) & 3);
+            read[row][count] = STATE_OFFSET((r - 1) & 1) + row + (4 * shifted);
+        }
+        write[count] = STATE_OFFSET(r & 1) + (4 * c) + 4;
+        last_round[count] = LAST_OFFSET + ((count <= 4) ? 4 : 0);
+    }
+
+    eng->dec = p;
+    setup_decrement(p);
+    p += 256;
+    eng->branch = p;
+    setup_branch_if_zero(p);
+}
+
+/**
+ * Expands 'key' (AES128_KEY_BYTES) into the AES128_ROUND_KEYS_SIZE bytes of round keys that
+ * build_aes128() takes, in the order that 'eng' uses them.
+ */
+void aes128_expand_key(const aes_engine_t* eng, const uint8_t* key, uint8_t* round_keys)
+{
+    uint8_t w[AES128_ROUND_KEYS_SIZE];
+    uint8_t rcon = 1;
+
+    for (uint32_t i = 0; i < AES128_KEY_BYTES; i++) { w[i] = key[i]; }
+    for (uint32_t i = AES128_KEY_BYTES; i < AES128_ROUND_KEYS_SIZE; i += 4) {
+        uint8_t t[4] = { w[i - 4], w[i - 3], w[i - 2], w[i - 1] };
+        if ((i % AES128_KEY_BYTES) == 0) {
+            const uint8_t t0 = t[0];
+            t[0] = aes_sbox(t[1]) ^ rcon;
+            t[1] = aes_sbox(t[2]);
+            t[2] = aes_sbox(t[3]);
+            t[3] = aes_sbox(t0);
+            rcon = gf_xtime(rcon);
+        }
+        for (uint32_t j = 0; j < 4; j++) { w[i + j] = w[i + j - AES128_KEY_BYTES] ^ t[j]; }
+    }
+
+    if (!eng->decrypt) {
+        for (uint32_t i = 0; i < AES128_ROUND_KEYS_SIZE; i++) { round_keys[i] = w[i]; }
+        return;
+    }
+
+    // The equivalent inverse cipher uses the round keys backwards, with InvMixColumns applied to
+    // all but the first and last.
+    for (uint32_t r = 0; r <= AES128_ROUNDS; r++) {
+        const uint8_t* src = &w[(AES128_ROUNDS - r) * AES_BLOCK_BYTES];
+        uint8_t* dst = &round_keys[r * AES_BLOCK_BYTES];
+        for (uint32_t c = 0; c < 4; c++) {
+            for (uint32_t row = 0; row < 4; row++) {
+                const int mixed = (r != 0) && (r != AES128_ROUNDS);
+                dst[(4 * c) + row] = mixed ? mix_byte(mix_decrypt, &src[4 * c], row) :
+                                             src[(4 * c) + row];
+            }
+        }
+    }
+}
+
+/**
+ * 1 + (3 * DIGITS_PER_BYTE * nterms) descriptors. *result = *k ^ f[0](*x[0]) ^ f[1](*x[1]) ^ ...,
+ * where f[j] is the function that the page tables terms[j] were built from.
+ */
+static DmacDescriptor* build_xor_terms(DmacDescriptor* d,
+                                       const aes_engine_t* eng,
+                                       const volatile uint8_t* k,
+                                       const uint8_t* const* const* terms,
+                                       const volatile uint8_t* const* x,
+                                       uint32_t nterms,
+                                       volatile uint8_t* result)
+{
+    d = build_copy(d, k, desc_src_byte(d + 3, 0), 1);
+    for (uint32_t j = 0; j < nterms; j++) {
+        for (uint32_t i = 0; i < DIGITS_PER_BYTE; i++) {
+            const int end = (j == (nterms - 1)) && (i == (DIGITS_PER_BYTE - 1));
+            DmacDescriptor* lookup = d + 2;
+            d = build_lookup(d, terms[j][i], x[j], desc_src_byte(lookup, 1));
+            dma_desc_set(lookup, DMAC_BTCTRL_BEATSIZE_BYTE, 1, eng->xor[i],
+                         end ? result : desc_src_byte(lookup + 3, 0), lookup + 1);
+            d = lookup + 1;
+        }
+    }
+    return d;
+}
+
+/**
+ * At most AES128_DESCS descriptors. Encrypts or decrypts (depending on 'eng') the 16-byte block
+ * at 'in' into 'out' with round keys from aes128_expand_key().
+ *
+ * The chain can be rerun on a new block by copying it into 'in' first. 'round_keys' must not cross
+ * a 64KiB boundary. 'scratch' is AES_SCRATCH bytes that must start on a 256-byte boundary and be
+ * private to this instance.
+ */
+DmacDescriptor* build_aes128(DmacDescriptor* descs,
+                             const aes_engine_t* eng,
+                             const uint8_t* round_keys,
+                             const volatile uint8_t* in,
+                             volatile uint8_t* out,
+                             uint8_t* scratch)
+{
+    // targets has to be at the start of a page, since eng->branch isn't biased.
+    DmacDescriptor** targets = (DmacDescriptor**)&scratch[TARGETS_OFFSET];
+    DmacDescriptor** last_targets = (DmacDescriptor**)&scratch[LAST_OFFSET];
+    uint8_t* column = &scratch[COLUMN_OFFSET];
+    uint8_t* mixed = &scratch[MIXED_OFFSET];
+    uint8_t* key = &scratch[KEY_OFFSET];
+    uint8_t* passes = &scratch[PASSES_OFFSET];
+    uint8_t* count = &scratch[COUNT_OFFSET];
+    uint8_t* key_lo = &scratch[1 * 256];
+    uint8_t* key_hi = &scratch[2 * 256];
+
+    const uint8_t* const* key_terms[1] = { eng->key };
+    const uint8_t* const* last_terms[1] = { eng->last };
+    const uint8_t* const* mix_terms[4] = { eng->mix[0], eng->mix[1], eng->mix[2], eng->mix[3] };
+
+    DmacDescriptor* d = descs;
+
+    // Pass 'count' uses round key column 4 + (AES128_PASSES - count).
+    *passes = AES128_PASSES;
+    setup_index_to_addr(key_lo, key_hi, round_keys, -4, AES_BLOCK_BYTES + (4 * AES128_PASSES) + 4);
+
+    // round 0 is just AddRoundKey
+    for (uint32_t i = 0; i < AES_BLOCK_BYTES; i++) {
+        const volatile uint8_t* x[1] = { &in[i] };
+        d = build_xor_terms(d, eng, &round_keys[i], key_terms, x, 1, &scratch[STATE_OFFSET(0) + i]);
+    }
+    d = build_copy(d, passes, count, 1);
+
+    DmacDescriptor* body = d;
+    for (uint32_t row = 0; row < 4; row++) {
+        DmacDescriptor* fetch = d + 2;
+        d = build_lookup(d, eng->read[row], count, desc_src_byte(fetch, 0));
+        dma_desc_set(fetch, DMAC_BTCTRL_BEATSIZE_BYTE, 1, scratch, &column[row], fetch + 1);
+        d = fetch + 1;
+    }
+    d = build_indexed_copy(d, round_keys, key_lo, key_hi, count, key, 4);
+    d = build_branch(d, eng->last_round, count, last_targets);
+
+    DmacDescriptor* mix = d;
+    for (uint32_t row = 0; row < 4; row++) {
+        const volatile uint8_t* x[4];
+        for (uint32_t j = 0; j < 4; j++) { x[j] = &column[(row + j) & 3]; }
+        d = build_xor_terms(d, eng, &key[row], mix_terms, x, 4, &mixed[row]);
+    }
+    DmacDescriptor* mix_end = d - 1;
+
+    DmacDescriptor* last = d;
+    for (uint32_t row = 0; row < 4; row++) {
+        const volatile uint8_t* x[1] = { &column[row] };
+        d = build_xor_terms(d, eng, &key[row], last_terms, x, 1, &mixed[row]);
+    }
+    mix_end->DESCADDR.reg = (uint32_t)d;
+    last_targets[0] = mix;
+    last_targets[1] = last;
+
+    DmacDescriptor* store = d + 2;
+    d = build_lookup(d, eng->write, count, desc_dst_byte(store, 0));
+    dma_desc_set(store, DMAC_BTCTRL_BEATSIZE_BYTE | DMAC_BTCTRL_SRCINC | DMAC_BTCTRL_DSTINC, 4,
+                 mixed, scratch, store + 1);
+    d = store + 1;
+
+    d = build_lookup(d, eng->dec, count, count);
+    DmacDescriptor* exit = build_branch(d, eng->branch, count, targets);
+    targets[0] = body;
+    targets[1] = exit;
+
+    // Round 10 is even, so it leaves the state in the first buffer.
+    return build_copy(exit, &scratch[STATE_OFFSET(AES128_ROUNDS & 1)], out, AES_BLOCK_BYTES);
+}
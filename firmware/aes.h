@@ -0,0 +1,48 @@
+#ifndef _AES_H
+#define _AES_H
+
+#include <stdint.h>
+#include "dma.h"
+#include "dmainstrs.h"
+
+#define AES_BLOCK_BYTES         16
+#define AES128_KEY_BYTES        16
+#define AES128_ROUNDS           10
+#define AES128_ROUND_KEYS_SIZE  ((AES128_ROUNDS + 1) * AES_BLOCK_BYTES)
+
+/**
+ * Tables for one direction (encrypt or decrypt) of AES; see setup_aes_engine().
+ *
+ * Every byte of a round's output is its round key byte XORed with 4 terms, one per byte of a
+ * column, and each term is the S-box output times a MixColumns coefficient. XOR is done a digit at
+ * a time: xor[i] has a page for every value of digit i, and page p maps t to t with p XORed into
+ * digit i. The term tables go straight from a state byte to the xor[i] page for digit i of the
+ * term, so the S-box and the multiply cost nothing extra.
+ */
+typedef struct aes_engine {
+    const uint8_t* xor[DIGITS_PER_BYTE];        // DIGIT_VALUES x 256 each
+    const uint8_t* mix[4][DIGITS_PER_BYTE];     // x -> page of xor[i] + digit i of m[j] * S[x]
+    const uint8_t* last[DIGITS_PER_BYTE];       // x -> page of xor[i] + digit i of S[x]
+    const uint8_t* key[DIGITS_PER_BYTE];        // x -> page of xor[i] + digit i of x
+    const uint8_t* read[4];     // loop counter -> low byte of the old state byte for row r
+    const uint8_t* write;       // loop counter -> low byte of the end of the new state column
+    const uint8_t* last_round;  // loop counter -> byte offset of the mix or last round target
+    const uint8_t* dec;         // loop counter
+    const uint8_t* branch;      // setup_branch_if_zero(), unbiased
+    int decrypt;
+} aes_engine_t;
+
+#define AES_ENGINE_SIZE ((DIGITS_PER_BYTE * ((DIGIT_VALUES + 6) * 256)) + (8 * 256))
+#define AES_SCRATCH     (3 * 256)
+#define AES128_DESCS    (56 + (108 * DIGITS_PER_BYTE))
+
+void setup_aes_engine(aes_engine_t* eng, int decrypt, uint8_t* mem);
+void aes128_expand_key(const aes_engine_t* eng, const uint8_t* key, uint8_t* round_keys);
+DmacDescriptor* build_aes128(DmacDescriptor* descs,
+                             const aes_engine_t* eng,
+                             const uint8_t* round_keys,
+                             const volatile uint8_t* in,
+                             volatile uint8_t* out,
+                             uint8_t* scratch);
+
+#endif
@@ -0,0 +1,1581 @@
+/**
+ * Benchmarks for descriptor chains.
+ *
+ * Each benchmark builds its chain (and tables) in a scratch arena, runs it on the real DMAC while
+ * SysTick counts CPU cycles, checks the answer against one computed on the CPU, and reports over
+ * the UART that init_hardware() sets up.
+ */
+
+#include "samd21g18a.h"
+#include "bench.h"
+#include "aes.h"
+#include "bloom.h"
+#include "chase.h"
+#include "chip8.h"
+#include "codec.h"
+#include "dfa.h"
+#include "dmac.h"
+#include "dmainstrs.h"
+#include "ecc.h"
+#include "fir.h"
+#include "hashtab.h"
+#include "histogram.h"
+#include "jobq.h"
+#include "matmul.h"
+#include "rng.h"
+#include "sort.h"
+#include "strscan.h"
+#include "subleq.h"
+#include "uart_rx.h"
+#include "uart_tx.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Scratch memory
+
+// With the default 8KiB stack, this is about as much as the 32KiB of SRAM leaves.
+#define BENCH_ARENA_SIZE (20 * 1024)
+
+// init_hardware() runs the CPU straight off of OSC8M.
+#define BENCH_CPU_HZ 8000000ull
+
+static uint8_t arena[BENCH_ARENA_SIZE] __attribute__((aligned(256)));
+static uint32_t arena_used;
+static int arena_failed;
+
+static void uart_puts(const char* s);
+static void uart_put_u32(uint32_t v);
+
+/**
+ * Frees everything that was bench_alloc()'d.
+ */
+void bench_reset(void)
+{
+    arena_used = 0;
+    arena_failed = 0;
+}
+
+/**
+ * Allocates from the benchmark arena. If the arena is exhausted, prints the allocation that didn't
+ * fit and returns NULL; bench_alloc_failed() stays set until the next bench_reset(), so a benchmark
+ * can make all of its allocations and check once before touching any of them.
+ */
+void* bench_alloc(uint32_t nbytes, uint32_t align)
+{
+    uint32_t start = (arena_used + (align - 1)) & ~(align - 1);
+    if ((start > BENCH_ARENA_SIZE) || (nbytes > (BENCH_ARENA_SIZE - start))) {
+        uart_puts("bench_alloc: ");
+        uart_put_u32(nbytes);
+        uart_puts(" bytes (align ");
+        uart_put_u32(align);
+        uart_puts(") with ");
+        uart_put_u32(arena_used);
+        uart_puts(" / ");
+        uart_put_u32(BENCH_ARENA_SIZE);
+        uart_puts(" used\r\n");
+        arena_failed = 1;
+        return 0;
+    }
+    arena_used = start + nbytes;
+    return &arena[start];
+}
+
+/**
+ * Whether a bench_alloc() has failed since the last bench_reset().
+ */
+int bench_alloc_failed(void)
+{
+    return arena_failed;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Timing and reporting
+
+static void timer_start(void)
+{
+    SysTick->LOAD = 0x00ffffff;
+    SysTick->VAL  = 0;
+    SysTick->CTRL = ((1 << 2) |    // count CPU clock cycles
+                     (1 << 0));    // enable
+}
+
+/**
+ * SysTick is only 24 bits wide, so this has to be called at least every 2^24 cycles to count
+ * wraps.
+ */
+static void timer_poll(uint32_t* wraps)
+{
+    if (SysTick->CTRL & (1 << 16)) { (*wraps)++; }    // COUNTFLAG clears on read
+}
+
+/**
+ * Only enabled while a bench sleeps, so that a WFI can't outlast a wrap. The startup code's default
+ * handler hangs.
+ */
+void SysTick_Handler(void)
+{
+}
+
+static uint32_t timer_stop(uint32_t wraps)
+{
+    uint32_t val = SysTick->VAL;
+    if (SysTick->CTRL & (1 << 16)) { wraps++; val = SysTick->VAL; }
+    SysTick->CTRL = 0;
+
+    return (wraps << 24) + (0x00ffffff - val);
+}
+
+/**
+ * Runs 'chain' to completion and returns the number of CPU cycles it took.
+ */
+uint32_t bench_cycles(uint8_t channel, const DmacDescriptor* chain)
+{
+    uint32_t wraps = 0;
+
+    timer_start();
+    dmac_start(channel, chain);
+    while (dmac_busy(channel)) { timer_poll(&wraps); }
+    return timer_stop(wraps);
+}
+
+static void uart_putc(char c)
+{
+    while (!(SERCOM0->USART.INTFLAG.reg & (1 << 0)));    // wait for DRE
+    SERCOM0->USART.DATA.reg = c;
+}
+
+static void uart_puts(const char* s)
+{
+    while (*s) { uart_putc(*s++); }
+}
+
+static void uart_put_u32(uint32_t v)
+{
+    char buf[11];
+    int i = sizeof(buf) - 1;
+    buf[i] = '\0';
+    do { buf[--i] = '0' + (v % 10); v /= 10; } while (v);
+    uart_puts(&buf[i]);
+}
+
+/**
+ * Prints "name: <ops> ops in <cycles> cycles (<cycles / op> cycles/op, <ops / s> ops/s) ok" on one
+ * line.
+ */
+void bench_print(const char* name, const bench_result_t* result)
+{
+    uart_puts(name);
+    uart_puts(": ");
+    uart_put_u32(result->ops);
+    uart_puts(" ops in ");
+    uart_put_u32(result->cycles);
+    uart_puts(" cycles (");
+    uart_put_u32(result->ops ? (result->cycles / result->ops) : 0);
+    uart_puts(" cycles/op, ");
+    uart_put_u32(result->cycles ? (uint32_t)((result->ops * BENCH_CPU_HZ) / result->cycles) : 0);
+    uart_puts(" ops/s) ");
+    uart_puts(result->ok ? "ok\r\n" : "WRONG\r\n");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Shared tables
+
+static digit_luts_t luts;
+
+/**
+ * (Re)builds the tables that every benchmark uses at the start of the arena.
+ */
+static void bench_setup_luts(void)
+{
+    bench_reset();
+    uint8_t* mem = bench_alloc(DIGIT_LUTS_SIZE, 256);
+    if (mem) { setup_digit_luts(&luts, mem); }
+}
+
+/**
+ * Cheap PRNG for filling in benchmark inputs.
+ */
+static uint32_t bench_rand(void)
+{
+    static uint32_t x = 2463534242ul;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Carry-save reduction
+
+/**
+ * Sums nterms (<= 255) random 32-bit values into a 40-bit result with a descriptor loop. One op is
+ * one term.
+ *
+ * With resolve_every_term set, the loop resolves the accumulator and splits the sum back into
+ * digits after every term, which is what doing the same reduction with a ripple-carry add costs.
+ */
+bench_result_t bench_csa_reduction(uint32_t nterms, int resolve_every_term)
+{
+    const uint32_t nbytes = 5;
+    const uint32_t ndigits = nbytes * DIGITS_PER_BYTE;
+    bench_result_t result = { .ops = nterms, .cycles = 0, .ok = 0 };
+
+    bench_setup_luts();
+
+    csa_engine_t eng;
+    uint8_t* csa_mem = bench_alloc(CSA_ENGINE_SIZE, 256);
+
+    uint8_t* dec   = bench_alloc(256, 256);
+    uint8_t* sel   = bench_alloc(256, 256);
+    uint8_t* idxlo = bench_alloc(256, 256);
+    uint8_t* idxhi = bench_alloc(256, 256);
+    uint8_t* split[DIGITS_PER_BYTE];
+    for (uint32_t i = 0; i < DIGITS_PER_BYTE; i++) { split[i] = bench_alloc(256, 256); }
+
+    uint32_t* terms = bench_alloc(nterms * 4, 4);
+    uint8_t* acc    = bench_alloc(ndigits, 4);
+    uint8_t* x      = bench_alloc(4, 4);
+    uint8_t* sum    = bench_alloc(nbytes, 4);
+    uint8_t* count  = bench_alloc(1, 1);
+    DmacDescriptor** targets = bench_alloc(2 * sizeof(DmacDescriptor*), 8);
+
+    // The longest chain (DIGIT_BITS == 2, resolving every term) is 633 descriptors.
+    DmacDescriptor* descs = bench_alloc(sizeof(DmacDescriptor) * 640, 16);
+
+    if (bench_alloc_failed()) { return result; }
+    setup_csa_engine(&eng, &luts, csa_mem);
+    for (uint32_t i = 0; i < DIGITS_PER_BYTE; i++) { setup_digit_extract(split[i], i); }
+
+    // The counter runs from nterms down to 1, so term (count - 1) ends at terms + (4 * count).
+    setup_decrement(dec);
+    setup_branch_if_zero(sel);
+    lut_add_bias(sel, 256, (uint32_t)targets & 0xff);
+    setup_index_to_addr(idxlo, idxhi, terms, 4, 0);
+
+    uint64_t expected = 0;
+    for (uint32_t i = 0; i < nterms; i++) {
+        terms[i] = bench_rand();
+        expected += terms[i];
+    }
+
+    DmacDescriptor* d = descs;
+
+    // loop body
+    d = build_indexed_copy(d, terms, idxlo, idxhi, count, x, 4);
+    d = build_csa_accumulate(d, &eng, acc, nbytes, x, 4);
+    if (resolve_every_term) {
+        d = build_csa_resolve(d, &eng, acc, nbytes, sum);
+        for (uint32_t i = 0; i < ndigits; i++) {
+            d = build_lookup(d, split[i % DIGITS_PER_BYTE], &sum[i / DIGITS_PER_BYTE], &acc[i]);
+        }
+    }
+    d = build_lookup(d, dec, count, count);
+    DmacDescriptor* exit = build_branch(d, sel, count, targets);
+
+    // after the loop
+    d = build_csa_resolve(exit, &eng, acc, nbytes, sum);
+    dma_chain_terminate(d - 1);
+
+    targets[0] = descs;
+    targets[1] = exit;
+
+    for (uint32_t i = 0; i < ndigits; i++) { acc[i] = 0; }
+    *count = nterms;
+
+    result.cycles = bench_cycles(0, descs);
+
+    result.ok = 1;
+    for (uint32_t i = 0; i < nbytes; i++) {
+        if (sum[i] != (uint8_t)(expected >> (8 * i))) { result.ok = 0; }
+    }
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// DFA matching
+
+/**
+ * Searches ~4KiB of pseudo-random printable text for a regex, 'unroll' bytes per loop pass. One op
+ * is one byte of input.
+ */
+bench_result_t bench_dfa(uint32_t unroll)
+{
+    const uint32_t len = 255 * 16;
+    bench_result_t result = { .ops = len, .cycles = 0, .ok = 0 };
+    dfa_t dfa;
+
+    bench_reset();
+
+    uint8_t* scratch = bench_alloc(DFA_RUN_SCRATCH, 256);
+    uint8_t* buf     = bench_alloc(len, 4);
+    uint8_t* state   = bench_alloc(1, 1);
+    uint8_t* match   = bench_alloc(1, 1);
+    DmacDescriptor* descs = bench_alloc(sizeof(DmacDescriptor) * DFA_RUN_DESCS(unroll), 16);
+
+    // Whatever is left of the arena holds the tables.
+    uint32_t avail = (BENCH_ARENA_SIZE - arena_used - 256) & ~0xff;
+    uint8_t* tables = bench_alloc(avail, 256);
+
+    if (bench_alloc_failed()) { return result; }
+
+    if (dfa_compile(&dfa, "(GET|POST) /[a-z0-9/]*\\.html", DFA_SEARCH, tables, avail) < 0) {
+        return result;
+    }
+
+    for (uint32_t i = 0; i < len; i++) { buf[i] = ' ' + (bench_rand() % 95); }
+    const char* needle = "POST /docs/index.html";
+    for (uint32_t i = 0; needle[i]; i++) { buf[len - 64 + i] = needle[i]; }
+
+    DmacDescriptor* d = build_dfa_run(descs, &dfa, buf, len, unroll, state, match, scratch);
+    dma_chain_terminate(d - 1);
+
+    *state = dfa.start;
+    result.cycles = bench_cycles(0, descs);
+    result.ok = (*match == 1) && (*state == dfa_step(&dfa, dfa.start, buf, len));
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// UART RX pipeline
+
+/**
+ * Streams 1KiB of telemetry lines through a UART RX pipeline at 'baud', using the TC3 stand-in for
+ * the UART. Every byte is folded into a CRC-8, upper-cased and fed to a DFA looking for error
+ * codes. One op is one byte; keeping up means ops/s comes out at baud / 10, and falling behind
+ * far enough to fill the ring fails the bench.
+ */
+bench_result_t bench_uart_rx(uint32_t baud)
+{
+    const uint32_t len = 1024;
+    const uint32_t nslots = 64;
+    bench_result_t result = { .ops = len, .cycles = 0, .ok = 0 };
+    uart_rx_pipe_t pipe;
+    dfa_t dfa;
+
+    bench_setup_luts();
+
+    uint8_t* scratch    = bench_alloc(UART_RX_SCRATCH, 256);
+    uint8_t* xor_table  = bench_alloc(256, 256);
+    uint8_t* crc_table  = bench_alloc(256, 256);
+    uint8_t* upper      = bench_alloc(256, 256);
+    uint16_t* ring      = bench_alloc(nslots * sizeof(uint16_t), 2);
+    uint16_t* stream    = bench_alloc(len * sizeof(uint16_t), 2);
+    uint8_t* vars       = bench_alloc(4 + DIGITS_PER_BYTE, 4);
+    DmacDescriptor* descs = bench_alloc(sizeof(DmacDescriptor) * (UART_RX_HEAD_DESCS +
+                                                                  CRC8_UPDATE_DESCS +
+                                                                  2 +
+                                                                  DFA_FEED_DESCS +
+                                                                  UART_RX_TAIL_DESCS +
+                                                                  (len / nslots) + 1), 16);
+
+    uint32_t avail = (BENCH_ARENA_SIZE - arena_used - 256) & ~0xff;
+    uint8_t* tables = bench_alloc(avail, 256);
+
+    if (bench_alloc_failed()) { return result; }
+
+    if (dfa_compile(&dfa, "ERR[0-9]+", DFA_SEARCH, tables, avail) < 0) { return result; }
+
+    setup_digit_xor(xor_table);
+    setup_crc8(crc_table, 0x07);
+    for (uint32_t i = 0; i < 256; i++) { upper[i] = ((i >= 'a') && (i <= 'z')) ? (i - 32) : i; }
+
+    // "t=<temp>,h=<humidity>\n" lines, with an error report near the end.
+    for (uint32_t i = 0; i < len; ) {
+        char line[16] = "t=00,h=00\n";
+        uint32_t r = bench_rand();
+        line[2] += (r >> 0) % 10; line[3] += (r >> 8) % 10;
+        line[7] += (r >> 16) % 10; line[8] += (r >> 24) % 10;
+        for (uint32_t j = 0; line[j] && (i < len); j++) { stream[i++] = line[j]; }
+    }
+    const char* report = "err42\n";
+    for (uint32_t i = 0; report[i]; i++) { stream[len - 32 + i] = report[i]; }
+
+    volatile uint8_t* crc = &vars[0];
+    volatile uint8_t* state = &vars[1];
+    volatile uint8_t* mapped = &vars[2];
+    uart_rx_pipe_init(&pipe, ring, nslots, scratch);
+    DmacDescriptor* d = build_uart_rx_head(descs, &pipe);
+    d = build_crc8_update(d, &luts, xor_table, crc_table, pipe.byte, crc, &vars[4]);
+    d = build_lookup(d, upper, pipe.byte, mapped);
+    d = build_dfa_feed(d, &dfa, mapped, state);
+    d = build_uart_rx_tail(d, &pipe);
+    DmacDescriptor* inject_descs = d;
+
+    *crc = 0;
+    *state = dfa.start;
+
+    // The compute channel's SUSP interrupt ends the WFI once per byte, and the SysTick interrupt at
+    // least every 2^24 cycles, so that a pipeline that has stalled is given up on.
+    uint32_t wraps = 0;
+    timer_start();
+    SysTick->CTRL |= (1 << 1);    // interrupt on wrap
+    uart_rx_inject(&pipe, inject_descs, stream, len, baud);
+    __disable_irq();
+    while ((dmac_busy(UART_RX_CHANNEL) || !uart_rx_idle(&pipe)) && (wraps < 2)) {
+        __WFI();
+        __enable_irq();
+        __disable_irq();
+        timer_poll(&wraps);
+    }
+    __enable_irq();
+    result.cycles = timer_stop(wraps);
+    uart_rx_stop(&pipe);
+    if (wraps >= 2) { return result; }
+
+    if (uart_rx_overran(&pipe)) { uart_puts("uart_rx: ring overran\r\n"); }
+
+    uint8_t want_crc = 0;
+    uint8_t want_state = dfa.start;
+    for (uint32_t i = 0; i < len; i++) {
+        uint8_t c = stream[i];
+        want_crc = crc_table[want_crc ^ c];
+        want_state = dfa_step(&dfa, want_state, &upper[c], 1);
+    }
+    result.ok = (*crc == want_crc) && (*state == want_state) && dfa.accept[*state] &&
+                !uart_rx_overran(&pipe);
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Sorting
+
+/**
+ * Dot product of two n-byte vectors, the second one read with a stride of 3. One op is one
+ * multiply-accumulate.
+ */
+bench_result_t bench_dot_product(uint32_t n)
+{
+    bench_result_t result = { .ops = n, .cycles = 0, .ok = 0 };
+    bn_engine_t bn;
+
+    bench_setup_luts();
+    uint8_t* bn_mem = bench_alloc(BN_ENGINE_SIZE, 256);
+
+    uint8_t* scratch = bench_alloc(DOT_PRODUCT_SCRATCH, 256);
+    uint8_t* x       = bench_alloc(n, 4);
+    uint8_t* y       = bench_alloc(3 * n, 4);
+    uint32_t* dot    = bench_alloc(4, 4);
+    DmacDescriptor* descs = bench_alloc(sizeof(DmacDescriptor) * DOT_PRODUCT_DESCS, 16);
+    if (bench_alloc_failed()) { return result; }
+    setup_bn_engine(&bn, &luts, bn_mem);
+
+    uint32_t expected = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        x[i] = bench_rand();
+        y[3 * i] = bench_rand();
+        expected += x[i] * y[3 * i];
+    }
+
+    DmacDescriptor* d = build_dot_product(descs, &bn, x, 1, y, 3, n, dot, scratch);
+    dma_chain_terminate(d - 1);
+
+    result.cycles = bench_cycles(0, descs);
+    result.ok = (*dot == expected);
+    return result;
+}
+
+/**
+ * (m x k) * (k x n) matrix multiply on random bytes. One op is one multiply-accumulate.
+ */
+bench_result_t bench_matmul(uint32_t m, uint32_t k, uint32_t n)
+{
+    bench_result_t result = { .ops = m * k * n, .cycles = 0, .ok = 0 };
+    bn_engine_t bn;
+
+    bench_setup_luts();
+    uint8_t* bn_mem = bench_alloc(BN_ENGINE_SIZE, 256);
+
+    uint8_t* scratch = bench_alloc(MATMUL_SCRATCH(m, n), 256);
+    uint8_t* a       = bench_alloc(m * k, 4);
+    uint8_t* b       = bench_alloc(k * n, 4);
+    uint32_t* c      = bench_alloc(4 * m * n, 4);
+    DmacDescriptor* descs = bench_alloc(sizeof(DmacDescriptor) * MATMUL_DESCS(m, k, n), 16);
+    if (bench_alloc_failed()) { return result; }
+    setup_bn_engine(&bn, &luts, bn_mem);
+
+    for (uint32_t i = 0; i < (m * k); i++) { a[i] = bench_rand(); }
+    for (uint32_t i = 0; i < (k * n); i++) { b[i] = bench_rand(); }
+
+    DmacDescriptor* d = build_matmul(descs, &bn, a, b, c, m, k, n, scratch);
+    dma_chain_terminate(d - 1);
+
+    result.cycles = bench_cycles(0, descs);
+
+    result.ok = 1;
+    for (uint32_t i = 0; i < m; i++) {
+        for (uint32_t j = 0; j < n; j++) {
+            uint32_t expected = 0;
+            for (uint32_t p = 0; p < k; p++) { expected += a[(i * k) + p] * b[(p * n) + j]; }
+            if (c[(i * n) + j] != expected) { result.ok = 0; }
+        }
+    }
+    return result;
+}
+
+/**
+ * 'ntaps'-tap FIR filter with random coefficients over two blocks of n random samples, so the
+ * second block also checks that the delay line carries over. One op is one sample filtered.
+ */
+bench_result_t bench_fir(uint32_t ntaps, uint32_t n)
+{
+    bench_result_t result = { .ops = 2 * n, .cycles = 0, .ok = 0 };
+    bn_engine_t bn;
+    fir_t fir;
+    int8_t coeffs[FIR_MAX_TAPS];
+    int8_t history[FIR_MAX_TAPS + FIR_MAX_BLOCK];
+
+    bench_setup_luts();
+    uint8_t* bn_mem = bench_alloc(BN_ENGINE_SIZE, 256);
+
+    uint8_t* tables  = bench_alloc(FIR_TABLES_SIZE(ntaps), 256);
+    uint8_t* scratch = bench_alloc(FIR_SCRATCH, 256);
+    int8_t* in       = bench_alloc(n, 4);
+    int32_t* out     = bench_alloc(4 * n, 4);
+    DmacDescriptor* descs = bench_alloc(sizeof(DmacDescriptor) * FIR_DESCS(ntaps), 16);
+    if (bench_alloc_failed()) { return result; }
+    setup_bn_engine(&bn, &luts, bn_mem);
+
+    for (uint32_t k = 0; k < ntaps; k++) { coeffs[k] = bench_rand(); }
+    for (uint32_t k = 0; k < ntaps; k++) { history[k] = 0; }
+    setup_fir(&fir, coeffs, ntaps, tables);
+
+    DmacDescriptor* d = build_fir(descs, &bn, &fir, in, out, n, scratch);
+    dma_chain_terminate(d - 1);
+
+    result.ok = 1;
+    for (uint32_t block = 0; block < 2; block++) {
+        for (uint32_t i = 0; i < n; i++) { in[i] = bench_rand(); history[ntaps + i] = in[i]; }
+
+        result.cycles += bench_cycles(0, descs);
+
+        for (uint32_t i = 0; i < n; i++) {
+            int32_t expected = 0;
+            for (uint32_t k = 0; k < ntaps; k++) {
+                expected += coeffs[k] * history[ntaps + i - k];
+            }
+            if (out[i] != expected) { result.ok = 0; }
+        }
+        for (uint32_t k = 0; k < ntaps; k++) { history[k] = history[n + k]; }
+    }
+    return result;
+}
+
+/**
+ * Counts n random bytes into 256 counters that are 'width' bytes wide (1 or 2), split across
+ * 'nchannels' channels and then merged. One op is one byte counted.
+ */
+bench_result_t bench_histogram(uint32_t n, uint32_t width, uint32_t nchannels)
+{
+    const uint32_t unroll = 8;
+    bench_result_t result = { .ops = n, .cycles = 0, .ok = 0 };
+    bn_engine_t bn;
+    count_engine_t count;
+    histogram_split_t split;
+
+    bench_setup_luts();
+    uint8_t* bn_mem = bench_alloc(BN_ENGINE_SIZE, 256);
+    uint8_t* count_mem = bench_alloc(COUNT_ENGINE_SIZE, 256);
+
+    uint8_t* scratch = bench_alloc(HISTOGRAM_SPLIT_SCRATCH(nchannels), 256);
+    uint8_t* hist    = bench_alloc(width * 256, 256);
+    uint8_t* parts   = bench_alloc((nchannels - 1) * width * 256, 256);
+    uint8_t* buf     = bench_alloc(n, 4);
+    DmacDescriptor* descs = bench_alloc(sizeof(DmacDescriptor) *
+                                        HISTOGRAM_SPLIT_DESCS(width, unroll, nchannels), 16);
+    if (bench_alloc_failed()) { return result; }
+    setup_bn_engine(&bn, &luts, bn_mem);
+    setup_count_engine(&count, 1, count_mem);
+
+    for (uint32_t i = 0; i < n; i++) { buf[i] = bench_rand(); }
+
+    if (!build_histogram_split(descs, &split, &bn, &count, hist, parts, width, buf, n, 1, 0,
+                               unroll, nchannels, scratch)) {
+        return result;
+    }
+
+    // histogram_split_run() blocks, so SysTick can't be polled; this is well short of 2^24 cycles.
+    timer_start();
+    histogram_split_run(&split);
+    result.cycles = timer_stop(0);
+
+    // take every byte back off of its counter; they should all end up at 0
+    for (uint32_t i = 0; i < n; i++) {
+        uint8_t k = buf[i];
+        if ((width == 2) && (hist[k] == 0)) { hist[256 + k]--; }
+        hist[k]--;
+    }
+    result.ok = 1;
+    for (uint32_t i = 0; i < (width * 256); i++) {
+        if (hist[i] != 0) { result.ok = 0; }
+    }
+    return result;
+}
+
+/**
+ * Radix sorts n random esize-byte keys, 'unroll' per loop pass. One op is one element.
+ */
+bench_result_t bench_radix_sort(uint32_t n, uint32_t esize, uint32_t unroll)
+{
+    bench_result_t result = { .ops = n, .cycles = 0, .ok = 0 };
+    bn_engine_t bn;
+    count_engine_t count;
+
+    bench_setup_luts();
+    uint8_t* bn_mem = bench_alloc(BN_ENGINE_SIZE, 256);
+    uint8_t* count_mem = bench_alloc(COUNT_ENGINE_SIZE, 256);
+
+    uint8_t* scratch = bench_alloc(RADIX_SORT_SCRATCH(esize), 256);
+    uint8_t* buf     = bench_alloc(n * esize, 4);
+    uint8_t* tmp     = bench_alloc(n * esize, 4);
+    DmacDescriptor* descs = bench_alloc(sizeof(DmacDescriptor) * RADIX_SORT_DESCS(n, esize, unroll),
+                                        16);
+    if (bench_alloc_failed()) { return result; }
+    setup_bn_engine(&bn, &luts, bn_mem);
+    setup_count_engine(&count, esize, count_mem);
+
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < (n * esize); i++) {
+        buf[i] = bench_rand();
+        sum += buf[i];
+    }
+
+    DmacDescriptor* d = build_radix_sort(descs, &bn, &count, buf, tmp, n, esize, unroll, scratch);
+    if (!d) { return result; }
+    dma_chain_terminate(d - 1);
+
+    result.cycles = bench_cycles(0, descs);
+
+    // sorted, and still the same bytes (more or less)
+    result.ok = 1;
+    uint32_t prev = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t key = 0;
+        for (uint32_t j = 0; j < esize; j++) {
+            key |= (uint32_t)buf[(i * esize) + j] << (8 * j);
+            sum -= buf[(i * esize) + j];
+        }
+        if (key < prev) { result.ok = 0; }
+        prev = key;
+    }
+    if (sum != 0) { result.ok = 0; }
+    return result;
+}
+
+/**
+ * Sorts n random bytes with a sorting network spread over 'nchannels' channels. One op is one
+ * comparator.
+ *
+ * There's only room in the arena for small networks: n = 16 on 2 channels doesn't fit.
+ */
+bench_result_t bench_sort_network(uint32_t n, uint32_t nchannels)
+{
+    bench_result_t result = { .ops = 0, .cycles = 0, .ok = 0 };
+    bn_engine_t bn;
+    network_engine_t eng;
+    sort_network_t net;
+
+    bench_setup_luts();
+    uint8_t* bn_mem = bench_alloc(BN_ENGINE_SIZE, 256);
+    uint8_t* network_mem = bench_alloc(NETWORK_ENGINE_SIZE, 256);
+
+    uint8_t* scratch = bench_alloc(SORT_NETWORK_SCRATCH(nchannels), 256);
+    uint8_t* array   = bench_alloc(n, 1);
+    DmacDescriptor* descs = bench_alloc(sizeof(DmacDescriptor) * sort_network_descs(n, nchannels),
+                                        16);
+    if (bench_alloc_failed()) { return result; }
+    setup_bn_engine(&bn, &luts, bn_mem);
+    setup_network_engine(&eng, &bn, network_mem);
+
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        array[i] = bench_rand();
+        sum += array[i];
+    }
+
+    if (!build_sort_network(descs, &net, &eng, array, n, nchannels, scratch)) { return result; }
+    result.ops = net.ncomparators;
+
+    uint32_t wraps = 0;
+    timer_start();
+    sort_network_start(&net);
+    while (sort_network_busy(&net)) { timer_poll(&wraps); }
+    result.cycles = timer_stop(wraps);
+
+    result.ok = 1;
+    for (uint32_t i = 0; i < n; i++) {
+        if ((i > 0) && (array[i] < array[i - 1])) { result.ok = 0; }
+        sum -= array[i];
+    }
+    if (sum != 0) { result.ok = 0; }
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Crypto
+
+// The AES-128 example vector from FIPS-197, appendix C.1.
+static const uint8_t aes_key[AES128_KEY_BYTES] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+static const uint8_t aes_plaintext[AES_BLOCK_BYTES] = {
+    0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff
+};
+static const uint8_t aes_ciphertext[AES_BLOCK_BYTES] = {
+    0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a
+};
+
+/**
+ * Encrypts (or decrypts) one block of the FIPS-197 test vector. One op is one byte.
+ */
+bench_result_t bench_aes128(int decrypt)
+{
+    bench_result_t result = { .ops = AES_BLOCK_BYTES, .cycles = 0, .ok = 0 };
+    aes_engine_t eng;
+
+    // AES doesn't use the shared digit tables.
+    bench_reset();
+    uint8_t* aes_mem = bench_alloc(AES_ENGINE_SIZE, 256);
+
+    uint8_t* scratch    = bench_alloc(AES_SCRATCH, 256);
+    uint8_t* round_keys = bench_alloc(AES128_ROUND_KEYS_SIZE, 4);
+    uint8_t* in         = bench_alloc(AES_BLOCK_BYTES, 4);
+    uint8_t* out        = bench_alloc(AES_BLOCK_BYTES, 4);
+    DmacDescriptor* descs = bench_alloc(sizeof(DmacDescriptor) * AES128_DESCS, 16);
+    if (bench_alloc_failed()) { return result; }
+    setup_aes_engine(&eng, decrypt, aes_mem);
+
+    const uint8_t* src = decrypt ? aes_ciphertext : aes_plaintext;
+    const uint8_t* expected = decrypt ? aes_plaintext : aes_ciphertext;
+
+    aes128_expand_key(&eng, aes_key, round_keys);
+    for (uint32_t i = 0; i < AES_BLOCK_BYTES; i++) { in[i] = src[i]; }
+
+    DmacDescriptor* d = build_aes128(descs, &eng, round_keys, in, out, scratch);
+    dma_chain_terminate(d - 1);
+
+    result.cycles = bench_cycles(0, descs);
+
+    result.ok = 1;
+    for (uint32_t i = 0; i < AES_BLOCK_BYTES; i++) {
+        if (out[i] != expected[i]) { result.ok = 0; }
+    }
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Text encoding
+
+static const char bench_hex_digits[16] = "0123456789abcdef";
+static const char bench_base64_alphabet[64] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/**
+ * CPU reference for the encoders: hex or base64 of the n bytes at 'in'.
+ */
+static void bench_encode(int base64, const uint8_t* in, uint32_t n, uint8_t* out)
+{
+    if (!base64) {
+        for (uint32_t i = 0; i < n; i++) {
+            out[(2 * i) + 0] = bench_hex_digits[in[i] >> 4];
+            out[(2 * i) + 1] = bench_hex_digits[in[i] & 0x0f];
+        }
+        return;
+    }
+
+    for (uint32_t i = 0; i < n; i += 3) {
+        const uint32_t left = n - i;
+        const uint32_t v = ((in[i] << 16) |
+                            ((left > 1) ? (in[i + 1] << 8) : 0) |
+                            ((left > 2) ? in[i + 2] : 0));
+        *out++ = bench_base64_alphabet[(v >> 18) & 0x3f];
+        *out++ = bench_base64_alphabet[(v >> 12) & 0x3f];
+        *out++ = (left > 1) ? bench_base64_alphabet[(v >> 6) & 0x3f] : '=';
+        *out++ = (left > 2) ? bench_base64_alphabet[(v >> 0) & 0x3f] : '=';
+    }
+}
+
+/**
+ * Hex or base64 encodes n random bytes, or decodes them back after the CPU has encoded them. One
+ * op is one byte of binary data. Encoded text then goes out of the UART with uart_tx_start(), on
+ * its own line ahead of the result; that part isn't timed.
+ */
+bench_result_t bench_codec(int base64, int decode, uint32_t n)
+{
+    const uint32_t unroll = CODEC_MAX_UNROLL;
+    const uint32_t text_len = base64 ? BASE64_ENCODED_LEN(n) : HEX_ENCODED_LEN(n);
+    bench_result_t result = { .ops = n, .cycles = 0, .ok = 0 };
+    codec_t codec;
+
+    bench_reset();
+    uint8_t* tables  = bench_alloc(BASE64_DECODER_SIZE, 256);
+    uint8_t* scratch = bench_alloc(CODEC_SCRATCH, 256);
+    uint8_t* binary  = bench_alloc(n, 4);
+    uint8_t* text    = bench_alloc(text_len, 4);
+    uint8_t* out     = bench_alloc(decode ? n : (text_len + 2), 4);
+    DmacDescriptor* descs = bench_alloc(sizeof(DmacDescriptor) * CODEC_DESCS(unroll), 16);
+    if (bench_alloc_failed()) { return result; }
+
+    if (base64 && decode) {
+        setup_base64_decoder(&codec, tables);
+    } else if (base64) {
+        setup_base64_encoder(&codec, tables);
+    } else if (decode) {
+        setup_hex_decoder(&codec, tables);
+    } else {
+        setup_hex_encoder(&codec, tables);
+    }
+
+    for (uint32_t i = 0; i < n; i++) { binary[i] = bench_rand(); }
+    bench_encode(base64, binary, n, text);
+
+    DmacDescriptor* d = decode ? build_codec(descs, &codec, text, text_len, out, unroll, scratch) :
+                                 build_codec(descs, &codec, binary, n, out, unroll, scratch);
+    dma_chain_terminate(d - 1);
+
+    result.cycles = bench_cycles(0, descs);
+
+    const uint8_t* expected = decode ? binary : text;
+    result.ok = 1;
+    for (uint32_t i = 0; i < (decode ? n : text_len); i++) {
+        if (out[i] != expected[i]) { result.ok = 0; }
+    }
+
+    // At 115200 baud that takes about 700 cycles a byte; give up after 2^25.
+    if (!decode) {
+        out[text_len + 0] = '\r';
+        out[text_len + 1] = '\n';
+        uart_tx_start(descs, out, text_len + 2);
+
+        uint32_t wraps = 0;
+        timer_start();
+        while (uart_tx_busy() && (wraps < 2)) { timer_poll(&wraps); }
+        timer_stop(wraps);
+        if (uart_tx_busy()) {
+            uart_tx_stop();
+            result.ok = 0;
+        }
+    }
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// String scanning
+
+/**
+ * Looks for a byte that only shows up at the end of n random bytes, with memchr() or, if 'nul' is
+ * set, with strnlen(). One op is one byte looked at.
+ */
+bench_result_t bench_memchr(uint32_t n, int nul)
+{
+    const uint8_t c = nul ? 0 : '\n';
+    bench_result_t result = { .ops = n, .cycles = 0, .ok = 0 };
+    scan_luts_t luts;
+    scan_engine_t eng;
+
+    bench_reset();
+    uint8_t* luts_mem = bench_alloc(SCAN_LUTS_SIZE, 256);
+    uint8_t* scan_mem = bench_alloc(SCAN_ENGINE_SIZE, 256);
+    uint8_t* scratch = bench_alloc(SCAN_SCRATCH, 256);
+    uint8_t* buf = bench_alloc(n, 4);
+    uint16_t* found = bench_alloc(sizeof(uint16_t), 4);
+    DmacDescriptor* descs = bench_alloc(sizeof(DmacDescriptor) * SCAN_DESCS, 16);
+    if (bench_alloc_failed()) { return result; }
+    setup_scan_luts(&luts, luts_mem);
+    setup_scan_engine(&eng, &luts, c, scan_mem);
+
+    for (uint32_t i = 0; i < n; i++) {
+        do { buf[i] = bench_rand(); } while (buf[i] == c);
+    }
+    buf[n - 1] = c;
+
+    DmacDescriptor* d = nul ? build_strnlen(descs, &eng, buf, n, found, scratch) :
+                                 build_memchr(descs, &eng, buf, n, found, scratch);
+    dma_chain_terminate(d - 1);
+
+    result.cycles = bench_cycles(0, descs);
+    result.ok = (*found == (n - 1));
+    return result;
+}
+
+/**
+ * strncmp() of two n-byte strings that only differ in their last byte. One op is one pair of bytes
+ * compared.
+ */
+bench_result_t bench_strncmp(uint32_t n)
+{
+    bench_result_t result = { .ops = n, .cycles = 0, .ok = 0 };
+    strcmp_engine_t eng;
+
+    bench_setup_luts();
+    uint8_t* strcmp_mem = bench_alloc(STRCMP_ENGINE_SIZE, 256);
+    uint8_t* scratch = bench_alloc(STRCMP_SCRATCH, 256);
+    uint8_t* a = bench_alloc(n, 4);
+    uint8_t* b = bench_alloc(n, 4);
+    int8_t* cmp = bench_alloc(1, 4);
+    DmacDescriptor* descs = bench_alloc(sizeof(DmacDescriptor) * STRCMP_DESCS, 16);
+    if (bench_alloc_failed()) { return result; }
+    setup_strcmp_engine(&eng, &luts, strcmp_mem);
+
+    for (uint32_t i = 0; i < n; i++) {
+        do { a[i] = bench_rand(); } while (a[i] == 0);
+        b[i] = a[i];
+    }
+    b[n - 1] = a[n - 1] + 1;
+
+    DmacDescriptor* d = build_strncmp(descs, &eng, a, b, n, cmp, scratch);
+    dma_chain_terminate(d - 1);
+
+    result.cycles = bench_cycles(0, descs);
+    result.ok = (*cmp == ((a[n - 1] > b[n - 1]) ? 1 : -1));
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Pointer chasing
+
+/**
+ * Links nodes[lo..hi-1], whose keys are in order, into a balanced search tree. Returns its root.
+ */
+static chase_node_t* bench_build_tree(chase_node_t* nodes, int32_t lo, int32_t hi)
+{
+    if (lo >= hi) { return 0; }
+    const int32_t mid = (lo + hi) / 2;
+    nodes[mid].link[0] = bench_build_tree(nodes, lo, mid);
+    nodes[mid].link[1] = bench_build_tree(nodes, mid + 1, hi);
+    return &nodes[mid];
+}
+
+/**
+ * Looks up the largest of n keys (n < 256) in a linked list or in a balanced binary search tree.
+ * One op is one node visited.
+ */
+bench_result_t bench_chase(uint32_t n, int tree)
+{
+    bench_result_t result = { .ops = 0, .cycles = 0, .ok = 0 };
+    chase_engine_t eng;
+
+    bench_reset();
+    uint8_t* mem = bench_alloc(CHASE_ENGINE_SIZE, 256);
+    uint8_t* scratch = bench_alloc(CHASE_SCRATCH, 256);
+    chase_node_t* nodes = bench_alloc(sizeof(chase_node_t) * n, sizeof(chase_node_t));
+    chase_node_t** root = bench_alloc(sizeof(chase_node_t*), 4);
+    chase_node_t** found = bench_alloc(sizeof(chase_node_t*), 4);
+    DmacDescriptor* descs = bench_alloc(sizeof(DmacDescriptor) * CHASE_DESCS, 16);
+    if (bench_alloc_failed()) { return result; }
+
+    for (uint32_t i = 0; i < n; i++) {
+        nodes[i].key = i;
+        nodes[i].link[0] = (!tree && (i + 1 < n)) ? &nodes[i + 1] : 0;
+        nodes[i].link[1] = 0;
+    }
+    *root = tree ? bench_build_tree(nodes, 0, n) : &nodes[0];
+    *found = 0;
+
+    const uint8_t key = n - 1;
+    if (tree) {
+        setup_chase_tree(&eng, key, mem);
+    } else {
+        setup_chase_list(&eng, key, mem);
+    }
+    // A list only has link[0]; it's the tree that's searched by key.
+    for (chase_node_t* p = *root; p; p = p->link[(tree && (key > p->key)) ? 1 : 0]) {
+        result.ops++;
+        if (p->key == key) { break; }
+    }
+
+    DmacDescriptor* d = build_chase(descs, &eng, root, found, scratch);
+    dma_chain_terminate(d - 1);
+
+    result.cycles = bench_cycles(0, descs);
+    result.ok = (*found == &nodes[n - 1]);
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Hash tables
+
+#define BENCH_HASH_KEY   4
+#define BENCH_HASH_VALUE 4
+
+/**
+ * Fills a 256-slot table with n random 4-byte keys, then looks up nlookups keys, every other one
+ * of which is in the table. One op is one lookup.
+ */
+bench_result_t bench_hash_lookup(uint32_t n, uint32_t nlookups)
+{
+    bench_result_t result = { .ops = nlookups, .cycles = 0, .ok = 1 };
+    hash_engine_t eng;
+    hash_table_t table;
+    uint8_t keys[BENCH_HASH_KEY * 256];
+
+    bench_setup_luts();
+    uint8_t* hash_mem = bench_alloc(HASH_ENGINE_SIZE, 256);
+    uint8_t* scratch = bench_alloc(HASH_SCRATCH, 256);
+    uint8_t* slots = bench_alloc(HASH_SLOTS_SIZE(256, BENCH_HASH_KEY, BENCH_HASH_VALUE), 4);
+    uint8_t* key = bench_alloc(BENCH_HASH_KEY, 4);
+    uint8_t* value = bench_alloc(BENCH_HASH_VALUE, 4);
+    uint8_t* found = bench_alloc(1, 4);
+    DmacDescriptor* descs =
+        bench_alloc(sizeof(DmacDescriptor) * HASH_LOOKUP_DESCS(BENCH_HASH_KEY), 16);
+    if (bench_alloc_failed()) { result.ok = 0; return result; }
+    setup_hash_engine(&eng, &luts, hash_mem);
+
+    // The value of each key is its index, and keys are all distinct since bench_rand() never
+    // repeats a number.
+    hash_init(&table, &eng, slots, 256, BENCH_HASH_KEY, BENCH_HASH_VALUE);
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t k = bench_rand();
+        for (uint32_t j = 0; j < BENCH_HASH_KEY; j++) {
+            keys[(i * BENCH_HASH_KEY) + j] = k >> (8 * j);
+        }
+        hash_insert(&table, &keys[i * BENCH_HASH_KEY], (const uint8_t*)&i);
+    }
+
+    DmacDescriptor* d = build_hash_lookup(descs, &table, key, value, found, scratch);
+    dma_chain_terminate(d - 1);
+
+    for (uint32_t q = 0; q < nlookups; q++) {
+        const uint32_t i = bench_rand() % n;
+        const int hit = !(q & 1);
+        uint32_t k = bench_rand();
+        for (uint32_t j = 0; j < BENCH_HASH_KEY; j++) {
+            key[j] = hit ? keys[(i * BENCH_HASH_KEY) + j] : (k >> (8 * j));
+        }
+
+        result.cycles += bench_cycles(0, descs);
+
+        if (*found != hit) { result.ok = 0; }
+        if (hit && (*(uint32_t*)value != i)) { result.ok = 0; }
+    }
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Bloom filters
+
+#define BENCH_BLOOM_HASHES 4
+#define BENCH_BLOOM_KEY    2
+
+/**
+ * Adds n (at most 256) random 2-byte keys to a filter with 4 hashes (1024 bits), then queries n
+ * keys, every other one of which was added. One op is one insertion, or one query if 'query' is
+ * set. Either way, ok means that no added key was reported missing.
+ *
+ * The query chain is only built once the insertions are done, into the same descriptors and
+ * scratch; with DIGIT_BITS == 2, the arena doesn't have room for both.
+ */
+bench_result_t bench_bloom(uint32_t n, int query)
+{
+    bench_result_t result = { .ops = n, .cycles = 0, .ok = 1 };
+    bloom_t bloom;
+    uint16_t keys[256];
+
+    bench_setup_luts();
+    uint8_t* mem = bench_alloc(BLOOM_TABLES_SIZE(BENCH_BLOOM_HASHES), 256);
+    uint8_t* bitmap = bench_alloc(BLOOM_BITMAP_SIZE(BENCH_BLOOM_HASHES), 256);
+    uint8_t* scratch = bench_alloc(BLOOM_SCRATCH, 256);
+    uint8_t* key = bench_alloc(BENCH_BLOOM_KEY, 4);
+    uint8_t* found = bench_alloc(1, 4);
+    DmacDescriptor* descs = bench_alloc(
+        sizeof(DmacDescriptor) * BLOOM_QUERY_DESCS(BENCH_BLOOM_HASHES, BENCH_BLOOM_KEY), 16);
+    if (bench_alloc_failed()) { result.ok = 0; return result; }
+
+    setup_bloom(&bloom, &luts, BENCH_BLOOM_HASHES, mem, bitmap);
+    DmacDescriptor* d = build_bloom_insert(descs, &bloom, key, BENCH_BLOOM_KEY, scratch);
+    dma_chain_terminate(d - 1);
+
+    for (uint32_t i = 0; i < n; i++) {
+        keys[i] = bench_rand();
+        *(uint16_t*)key = keys[i];
+        const uint32_t cycles = bench_cycles(0, descs);
+        if (!query) { result.cycles += cycles; }
+    }
+
+    d = build_bloom_query(descs, &bloom, key, BENCH_BLOOM_KEY, found, scratch);
+    dma_chain_terminate(d - 1);
+
+    for (uint32_t q = 0; q < n; q++) {
+        const int added = !(q & 1);
+        *(uint16_t*)key = added ? keys[bench_rand() % n] : bench_rand();
+
+        const uint32_t cycles = bench_cycles(0, descs);
+        if (query) { result.cycles += cycles; }
+
+        if (added && !*found) { result.ok = 0; }
+    }
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SUBLEQ
+
+#define BENCH_SUBLEQ_N 16
+
+// Sums BENCH_SUBLEQ_N bytes at 0xc0 into 0xd0 with a load per byte.
+static const mini_instr_t bench_subleq_sum[] = {
+    { MINI_LI,   0, 0, 0 },
+    { MINI_LI,   1, 0, 0xc0 },
+    { MINI_LI,   2, 0, BENCH_SUBLEQ_N },
+    { MINI_LW,   3, 1, 0 },
+    { MINI_ADD,  0, 3, 0 },
+    { MINI_ADDI, 1, 0, 1 },
+    { MINI_ADDI, 2, 0, -1 },
+    { MINI_BLEZ, 2, 0, 9 },
+    { MINI_JMP,  0, 0, 3 },
+    { MINI_LI,   4, 0, 0xd0 },
+    { MINI_SW,   4, 0, 0 },
+    { MINI_HALT, 0, 0, 0 },
+};
+
+/**
+ * Compiles a mini-ISA array sum to SUBLEQ and runs it. One op is one SUBLEQ instruction, or one
+ * mini instruction if 'mini' is set; the ratio of the two is what the compiler expands code by.
+ */
+bench_result_t bench_subleq(int mini)
+{
+    bench_result_t result = { .ops = 0, .cycles = 0, .ok = 0 };
+    subleq_engine_t eng;
+    uint8_t expect[SUBLEQ_MEM_SIZE];
+
+    bench_setup_luts();
+    uint8_t* subleq_mem = bench_alloc(SUBLEQ_ENGINE_SIZE, 256);
+    uint8_t* mem = bench_alloc(SUBLEQ_MEM_SIZE, 256);
+    uint8_t* scratch = bench_alloc(SUBLEQ_SCRATCH, 256);
+    DmacDescriptor* descs = bench_alloc(sizeof(DmacDescriptor) * SUBLEQ_DESCS, 16);
+    if (bench_alloc_failed()) { return result; }
+    setup_subleq_engine(&eng, &luts, subleq_mem);
+
+    const uint32_t n = sizeof(bench_subleq_sum) / sizeof(bench_subleq_sum[0]);
+    const int len = mini_compile(bench_subleq_sum, n, mem);
+    if ((len < 0) || (len > 0xc0)) { return result; }
+
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < BENCH_SUBLEQ_N; i++) {
+        mem[0xc0 + i] = bench_rand();
+        sum += mem[0xc0 + i];
+    }
+    for (uint32_t i = 0; i < SUBLEQ_MEM_SIZE; i++) { expect[i] = mem[i]; }
+    const uint32_t steps = subleq_run(expect, 100000);
+
+    DmacDescriptor* d = build_subleq(descs, &eng, mem, scratch);
+    dma_chain_terminate(d - 1);
+
+    // 3 set-up instructions, 5 per byte plus the jump back, and 3 to store the sum.
+    result.ops = mini ? (3 + (6 * BENCH_SUBLEQ_N) - 1 + 3) : steps;
+    result.cycles = bench_cycles(0, descs);
+    result.ok = (mem[0xd0] == (uint8_t)sum);
+    for (uint32_t i = 0; i < SUBLEQ_MEM_SIZE; i++) {
+        if (mem[i] != expect[i]) { result.ok = 0; }
+    }
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// CHIP-8
+
+#define BENCH_CHIP8_STEPS 200
+
+// Counts up in VA and draws the last decimal digit of the count along the top of the screen,
+// with some random arithmetic in between.
+static const uint8_t bench_chip8_prog[] = {
+    0x00, 0xe0,    // 200: CLS
+    0x6a, 0x00,    // 202: VA = 0
+    0x6b, 0x00,    // 204: VB = 0
+    0x22, 0x20,    // 206: CALL 220
+    0x7a, 0x01,    // 208: VA += 1
+    0x7b, 0x05,    // 20a: VB += 5
+    0x4b, 0x3c,    // 20c: skip if VB != 60
+    0x6b, 0x00,    // 20e: VB = 0
+    0xc7, 0x0f,    // 210: V7 = random & 0x0f
+    0x81, 0x74,    // 212: V1 += V7
+    0x81, 0x76,    // 214: V1 >>= 1
+    0x12, 0x06,    // 216: JP 206
+    0x00, 0x00,
+    0x00, 0x00,
+    0x00, 0x00,
+    0x00, 0x00,
+    0xa3, 0x00,    // 220: I = 300
+    0xfa, 0x33,    // 222: BCD of VA at I
+    0xf2, 0x65,    // 224: V0 - V2 = hundreds, tens, ones
+    0xf2, 0x29,    // 226: I = font sprite for V2
+    0x6c, 0x01,    // 228: VC = 1
+    0xdb, 0xc5,    // 22a: draw 5 rows at VB, VC
+    0x00, 0xee,    // 22c: RET
+};
+
+static uint32_t bench_chip8_hash(const chip8_t* c8)
+{
+    uint32_t h = 0;
+    for (uint32_t i = 0; i < c8->mem_size; i++) { h = (h * 31) + c8->mem[i]; }
+    for (uint32_t i = 0; i < 256; i++) { h = (h * 31) + c8->display[i]; }
+    const uint8_t* state = (const uint8_t*)c8->state;
+    for (uint32_t i = 0; i < sizeof(chip8_state_t); i++) { h = (h * 31) + state[i]; }
+    return h;
+}
+
+/**
+ * Runs a small CHIP-8 program that draws, calls and does arithmetic. One op is one emulated
+ * instruction.
+ */
+bench_result_t bench_chip8(void)
+{
+    bench_result_t result = { .ops = 0, .cycles = 0, .ok = 0 };
+    chip8_engine_t eng;
+    chip8_t c8;
+
+    bench_setup_luts();
+    uint8_t* chip8_mem = bench_alloc(CHIP8_ENGINE_SIZE, 256);
+    uint8_t* scratch = bench_alloc(CHIP8_SCRATCH, 256);
+    uint8_t* display = bench_alloc(256, 256);
+    chip8_state_t* state = bench_alloc(256, 256);
+    const uint32_t mem_size = 0x300 + CHIP8_WINDOW;
+    uint8_t* mem = bench_alloc(mem_size, 256);
+    DmacDescriptor* descs = bench_alloc(sizeof(DmacDescriptor) * CHIP8_DESCS, 16);
+    if (bench_alloc_failed()) { return result; }
+    setup_chip8_engine(&eng, &luts, chip8_mem);
+
+    chip8_init(&c8, mem, mem_size, display, state);
+    if (chip8_load(&c8, bench_chip8_prog, sizeof(bench_chip8_prog)) != 0) { return result; }
+    DmacDescriptor* d = build_chip8(descs, &eng, &c8, BENCH_CHIP8_STEPS, scratch);
+    dma_chain_terminate(d - 1);
+
+    result.ops = BENCH_CHIP8_STEPS;
+    result.cycles = bench_cycles(0, descs);
+    const uint32_t h = bench_chip8_hash(&c8);
+
+    // The same from scratch on the CPU.
+    chip8_init(&c8, mem, mem_size, display, state);
+    chip8_load(&c8, bench_chip8_prog, sizeof(bench_chip8_prog));
+    chip8_run(&c8, BENCH_CHIP8_STEPS);
+    result.ok = (h == bench_chip8_hash(&c8));
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Random numbers
+
+/**
+ * Fills n bytes from a random seed. One op is one byte.
+ */
+bench_result_t bench_rng(int xorshift, uint32_t n)
+{
+    bench_result_t result = { .ops = 0, .cycles = 0, .ok = 0 };
+    const rng_kind_t kind = xorshift ? RNG_XORSHIFT32 : RNG_LFSR16;
+    rng_engine_t eng;
+
+    bench_setup_luts();
+    uint8_t* rng_mem = bench_alloc(RNG_ENGINE_SIZE, 256);
+    uint8_t* scratch = bench_alloc(RNG_FILL_SCRATCH, 256);
+    uint8_t* state = bench_alloc(4, 4);
+    uint8_t* buf = bench_alloc(n, 4);
+    DmacDescriptor* descs = bench_alloc(sizeof(DmacDescriptor) * RNG_FILL_DESCS(kind), 16);
+    if (bench_alloc_failed()) { return result; }
+    setup_rng_engine(&eng, &luts, rng_mem);
+
+    uint32_t seed = bench_rand() | 1;
+    for (uint32_t i = 0; i < 4; i++) { state[i] = seed >> (8 * i); }
+    DmacDescriptor* d = build_rng_fill(descs, &eng, kind, state, buf, n, scratch);
+    dma_chain_terminate(d - 1);
+
+    result.ops = n;
+    result.cycles = bench_cycles(0, descs);
+
+    result.ok = 1;
+    uint16_t lfsr = seed;
+    for (uint32_t i = 0; i < n; i++) {
+        if (!xorshift) {
+            result.ok &= (buf[i] == lfsr16_next(&lfsr));
+        } else if (i % 4 == 0) {
+            const uint32_t x = xorshift32_next(&seed);
+            for (uint32_t j = 0; j < 4; j++) {
+                result.ok &= (buf[i + j] == (uint8_t)(x >> (8 * j)));
+            }
+        }
+    }
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Error correction
+
+/**
+ * Stores n random words of 'width' bytes, then loads them back with no bit, one bit or two bits
+ * flipped in turn. One op is one store, or one load if 'load' is set. ok means that every word
+ * came back right, or was reported uncorrectable when two bits were flipped.
+ */
+bench_result_t bench_ecc(uint32_t width, uint32_t n, int load)
+{
+    bench_result_t result = { .ops = n, .cycles = 0, .ok = 1 };
+    ecc_engine_t eng;
+
+    bench_setup_luts();
+    uint8_t* ecc_mem = bench_alloc(ECC_ENGINE_SIZE, 256);
+    uint8_t* store_scratch = bench_alloc(ECC_SCRATCH, 4);
+    uint8_t* load_scratch = bench_alloc(ECC_SCRATCH, 4);
+    uint8_t* src = bench_alloc(ECC_MAX_WIDTH, 4);
+    uint8_t* word = bench_alloc(ECC_MAX_WIDTH, 4);
+    uint8_t* check = bench_alloc(1, 4);
+    uint8_t* dst = bench_alloc(ECC_MAX_WIDTH, 4);
+    uint8_t* status = bench_alloc(1, 4);
+    DmacDescriptor* store = bench_alloc(sizeof(DmacDescriptor) * ECC_STORE_DESCS(width), 16);
+    DmacDescriptor* lookup = bench_alloc(sizeof(DmacDescriptor) * ECC_LOAD_DESCS(width), 16);
+    if (bench_alloc_failed()) { result.ok = 0; return result; }
+    setup_ecc_engine(&eng, &luts, ecc_mem);
+
+    DmacDescriptor* d = build_ecc_store(store, &eng, width, src, word, check, store_scratch);
+    dma_chain_terminate(d - 1);
+    d = build_ecc_load(lookup, &eng, width, word, check, dst, status, load_scratch);
+    dma_chain_terminate(d - 1);
+
+    for (uint32_t i = 0; i < n; i++) {
+        const uint32_t value = bench_rand();
+        for (uint32_t k = 0; k < width; k++) { src[k] = value >> (8 * k); }
+
+        const uint32_t store_cycles = bench_cycles(0, store);
+        if (!load) { result.cycles += store_cycles; }
+        if (*check != ecc_check(src, width)) { result.ok = 0; }
+
+        // Flip distinct bits of the word or its check byte.
+        const uint32_t nflips = i % 3;
+        const uint32_t nbits = (8 * width) + 8;
+        uint32_t flips[2];
+        flips[0] = bench_rand() % nbits;
+        flips[1] = (flips[0] + 1 + (bench_rand() % (nbits - 1))) % nbits;
+        for (uint32_t f = 0; f < nflips; f++) {
+            const uint32_t b = flips[f];
+            if (b < 8 * width) {
+                word[b / 8] ^= 1 << (b % 8);
+            } else {
+                *check ^= 1 << (b - (8 * width));
+            }
+        }
+
+        const uint32_t load_cycles = bench_cycles(0, lookup);
+        if (load) { result.cycles += load_cycles; }
+
+        if (nflips < 2) {
+            for (uint32_t k = 0; k < width; k++) { result.ok &= (dst[k] == src[k]); }
+            result.ok &= (*status == (nflips ? ECC_CORRECTED : ECC_OK));
+        } else {
+            result.ok &= (*status == ECC_UNCORRECTABLE);
+        }
+    }
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Job queue
+
+static uint8_t bench_reverse(uint8_t v)
+{
+    uint8_t r = 0;
+    for (uint32_t b = 0; b < 8; b++) { r |= ((v >> b) & 1) << (7 - b); }
+    return r;
+}
+
+static volatile uint32_t bench_jobq_callbacks;
+
+/**
+ * Counts callbacks, which have to come in the order the jobs were submitted.
+ */
+static void bench_jobq_callback(void* ctx)
+{
+    if ((uint32_t)ctx == bench_jobq_callbacks) { bench_jobq_callbacks++; }
+}
+
+/**
+ * Submits n (at most 256) jobs to an 8-slot queue as fast as it takes them: two out of three copy
+ * 16 bytes, and the rest reverse the bits of a byte with a lookup. With 'async', every job gets a
+ * callback, and the CPU sleeps in jobq_wait() for the last one. One op is one job, from the first
+ * submission until the last job is done.
+ */
+bench_result_t bench_jobq(uint32_t n, int async)
+{
+    const uint32_t nslots = 8;
+    bench_result_t result = { .ops = n, .cycles = 0, .ok = 1 };
+
+    bench_reset();
+    jobq_t* q = bench_alloc(sizeof(jobq_t), 4);
+    uint8_t* scratch = bench_alloc(JOBQ_SCRATCH, 256);
+    uint8_t* reverse = bench_alloc(256, 256);
+    job_slot_t* ring = bench_alloc(sizeof(job_slot_t) * nslots, 4);
+    uint8_t* src = bench_alloc(16 * n, 4);
+    uint8_t* dst = bench_alloc(16 * n, 4);
+    uint8_t* done = bench_alloc(n, 4);
+    DmacDescriptor* descs = bench_alloc(sizeof(DmacDescriptor) * (JOBQ_DESCS + 3 +
+                                                                  JOBQ_BIND_DESCS(2) * 2), 16);
+    if (bench_alloc_failed()) { result.ok = 0; return result; }
+
+    for (uint32_t i = 0; i < 256; i++) { reverse[i] = bench_reverse(i); }
+    for (uint32_t i = 0; i < 16 * n; i++) {
+        src[i] = bench_rand();
+        dst[i] = 0;
+    }
+
+    jobq_init(q, ring, nslots, scratch, descs);
+    DmacDescriptor* d = &descs[JOBQ_DESCS];
+
+    // The addresses the programs are built with get replaced by every job's.
+    DmacDescriptor* copy = d;
+    d = build_copy(d, src, dst, 16);
+    const job_site_t copy_sites[2] = { job_src_site(copy, 0), job_dst_site(copy, 1) };
+    d = jobq_add_program(q, 1, copy, copy, copy_sites, 2, d);
+
+    DmacDescriptor* lookup = d;
+    d = build_lookup(d, reverse, src, dst);
+    const job_site_t lookup_sites[2] = { job_src_site(&lookup[0], 0),
+                                         job_dst_site(&lookup[1], 1) };
+    d = jobq_add_program(q, 2, lookup, &lookup[1], lookup_sites, 2, d);
+
+    jobq_start(q);
+
+    bench_jobq_callbacks = 0;
+    job_t last = JOB_NONE;
+
+    // SysTick wraps every 2^24 cycles, which is far more than the sleep in jobq_wait() can take.
+    uint32_t wraps = 0;
+    uint32_t submitted = 0;
+    uint32_t stalled = 0;
+    timer_start();
+    for (uint32_t i = 0; i < n; ) {
+        const void* args[2] = { &src[16 * i], &dst[16 * i] };
+        const uint8_t id = ((i % 3) == 2) ? 2 : 1;
+        if (async) {
+            last = jobq_submit_async(q, id, args, bench_jobq_callback, (void*)i);
+            if (last != JOB_NONE) { i++; }
+        } else if (jobq_submit(q, id, args, &done[i]) == 0) {
+            i++;
+        }
+        if (i != submitted) {
+            submitted = i;
+            stalled = wraps;
+        }
+        timer_poll(&wraps);
+
+        // Slots are only given back by the DMAC interrupt, so if it never comes, the ring stays
+        // full. Give up rather than spin forever.
+        if ((wraps - stalled) > 1) {
+            jobq_stop(q);
+            result.ok = 0;
+            return result;
+        }
+    }
+    if (async) {
+        jobq_wait(q, last);
+    } else {
+        while (!done[n - 1]) { timer_poll(&wraps); }
+    }
+    result.cycles = timer_stop(wraps);
+    jobq_stop(q);
+
+    if (async) { result.ok &= (bench_jobq_callbacks == n); }
+    for (uint32_t i = 0; i < n; i++) {
+        if (!async) { result.ok &= done[i]; }
+        if ((i % 3) == 2) {
+            result.ok &= (dst[16 * i] == reverse[src[16 * i]]);
+        } else {
+            for (uint32_t j = 0; j < 16; j++) {
+                result.ok &= (dst[(16 * i) + j] == src[(16 * i) + j]);
+            }
+        }
+    }
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void bench_run_all(void)
+{
+    bench_result_t r;
+
+    r = bench_csa_reduction(255, 0);
+    bench_print("csa reduction, 255 x 32b", &r);
+    r = bench_csa_reduction(255, 1);
+    bench_print("ripple reduction, 255 x 32b", &r);
+    r = bench_uart_rx(57600);
+    bench_print("uart rx pipeline, 57600 baud", &r);
+#if DIGIT_BITS == 4
+    // With 2-bit digits, the CRC-8 is twice as long and a byte doesn't fit in 694 cycles.
+    r = bench_uart_rx(115200);
+    bench_print("uart rx pipeline, 115200 baud", &r);
+#endif
+    r = bench_dot_product(255);
+    bench_print("dot product, 255 x 8b, stride 3", &r);
+    r = bench_matmul(8, 8, 8);
+    bench_print("matmul, 8x8 * 8x8 8b", &r);
+    r = bench_fir(4, 32);
+    bench_print("fir, 4 taps (512B tables/tap), 2 x 32 samples", &r);
+    r = bench_histogram(1024, 1, 1);
+    bench_print("histogram, 1024 bytes, 8b counters", &r);
+    r = bench_histogram(1024, 2, 1);
+    bench_print("histogram, 1024 bytes, 16b counters", &r);
+    r = bench_histogram(1024, 2, 2);
+    bench_print("histogram, 1024 bytes, 16b counters, 2 channels", &r);
+    r = bench_radix_sort(1020, 1, 4);
+    bench_print("radix sort, 1020 x 8b keys", &r);
+    r = bench_radix_sort(384, 2, 2);
+    bench_print("radix sort, 384 x 16b keys", &r);
+    r = bench_sort_network(8, 1);
+    bench_print("sorting network, 8 bytes, 1 channel", &r);
+    r = bench_sort_network(8, 2);
+    bench_print("sorting network, 8 bytes, 2 channels", &r);
+    r = bench_sort_network(16, 1);
+    bench_print("sorting network, 16 bytes, 1 channel", &r);
+#if DIGIT_BITS == 4
+    // With 2-bit digits, these need more than the arena has.
+    r = bench_aes128(0);
+    bench_print("aes-128 encrypt, 1 block", &r);
+    r = bench_aes128(1);
+    bench_print("aes-128 decrypt, 1 block", &r);
+#endif
+    r = bench_codec(0, 0, 240);
+    bench_print("hex encode, 240 bytes", &r);
+    r = bench_codec(0, 1, 240);
+    bench_print("hex decode, 240 bytes", &r);
+    r = bench_codec(1, 0, 240);
+    bench_print("base64 encode, 240 bytes", &r);
+    r = bench_codec(1, 1, 240);
+    bench_print("base64 decode, 240 bytes", &r);
+    r = bench_memchr(240, 0);
+    bench_print("memchr, 240 bytes", &r);
+    r = bench_memchr(240, 1);
+    bench_print("strnlen, 240 bytes", &r);
+    r = bench_strncmp(240);
+    bench_print("strncmp, 240 bytes", &r);
+    r = bench_hash_lookup(192, 16);
+    bench_print("hash lookup, 4B keys, 192 / 256 slots used", &r);
+    r = bench_bloom(128, 0);
+    bench_print("bloom insert, 2B keys, 4 hashes", &r);
+    r = bench_bloom(128, 1);
+    bench_print("bloom query, 2B keys, 4 hashes, half present", &r);
+    r = bench_subleq(0);
+    bench_print("subleq array sum, per subleq instruction", &r);
+    r = bench_subleq(1);
+    bench_print("subleq array sum, per mini instruction", &r);
+    r = bench_chip8();
+    bench_print("chip-8, per emulated instruction", &r);
+    r = bench_rng(0, 64);
+    bench_print("lfsr16 fill, 64 bytes", &r);
+    r = bench_rng(1, 64);
+    bench_print("xorshift32 fill, 64 bytes", &r);
+    r = bench_ecc(1, 64, 0);
+    bench_print("ecc store, 8b words", &r);
+    r = bench_ecc(1, 64, 1);
+    bench_print("ecc load, 8b words, 1/3 with 1 bit and 1/3 with 2 bits flipped", &r);
+    r = bench_ecc(4, 64, 0);
+    bench_print("ecc store, 32b words", &r);
+    r = bench_ecc(4, 64, 1);
+    bench_print("ecc load, 32b words, 1/3 with 1 bit and 1/3 with 2 bits flipped", &r);
+    r = bench_chase(255, 0);
+    bench_print("linked list walk, 255 nodes", &r);
+    r = bench_chase(255, 1);
+    bench_print("binary tree lookup, 255 nodes", &r);
+    r = bench_jobq(96, 0);
+    bench_print("job queue, 16B copies and byte lookups", &r);
+    r = bench_jobq(96, 1);
+    bench_print("job queue, async with callbacks and wfi", &r);
+
+    r = bench_dfa(16);
+    bench_print("dfa search, 16 bytes/pass", &r);
+    r = bench_dfa(64);
+    bench_print("dfa search, 64 bytes/pass", &r);
+}
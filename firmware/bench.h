@@ -0,0 +1,47 @@
+#ifndef _BENCH_H
+#define _BENCH_H
+
+#include <stdint.h>
+#include "dma.h"
+
+/**
+ * Result of running one benchmark chain: how many "ops" (whatever unit the benchmark counts in)
+ * were done in how many CPU clock cycles, and whether the chain computed the right answer.
+ */
+typedef struct bench_result {
+    uint32_t ops;
+    uint32_t cycles;
+    int ok;
+} bench_result_t;
+
+void bench_reset(void);
+void* bench_alloc(uint32_t nbytes, uint32_t align);
+int bench_alloc_failed(void);
+uint32_t bench_cycles(uint8_t channel, const DmacDescriptor* chain);
+void bench_print(const char* name, const bench_result_t* result);
+
+bench_result_t bench_csa_reduction(uint32_t nterms, int resolve_every_term);
+bench_result_t bench_dfa(uint32_t unroll);
+bench_result_t bench_uart_rx(uint32_t baud);
+bench_result_t bench_dot_product(uint32_t n);
+bench_result_t bench_matmul(uint32_t m, uint32_t k, uint32_t n);
+bench_result_t bench_fir(uint32_t ntaps, uint32_t n);
+bench_result_t bench_histogram(uint32_t n, uint32_t width, uint32_t nchannels);
+bench_result_t bench_radix_sort(uint32_t n, uint32_t esize, uint32_t unroll);
+bench_result_t bench_sort_network(uint32_t n, uint32_t nchannels);
+bench_result_t bench_aes128(int decrypt);
+bench_result_t bench_codec(int base64, int decode, uint32_t n);
+bench_result_t bench_memchr(uint32_t n, int nul);
+bench_result_t bench_strncmp(uint32_t n);
+bench_result_t bench_chase(uint32_t n, int tree);
+bench_result_t bench_hash_lookup(uint32_t n, uint32_t nlookups);
+bench_result_t bench_bloom(uint32_t n, int query);
+bench_result_t bench_subleq(int mini);
+bench_result_t bench_chip8(void);
+bench_result_t bench_rng(int xorshift, uint32_t n);
+bench_result_t bench_ecc(uint32_t width, uint32_t n, int load);
+bench_result_t bench_jobq(uint32_t n, int async);
+
+void bench_run_all(void);
+
+#endif
@@ -0,0 +1,202 @@
+/**
+ * Bloom filter insertion and membership queries.
+ *
+ * Hash i of a key is a Pearson hash, h = P_i[h ^ byte] over the bytes of the key, done a byte at a
+ * time with build_crc8_update() and a random permutation P_i in place of the CRC table. The filter
+ * is partitioned: hash i only ever picks a bit in its own 32 bytes of the bitmap, with the top 5
+ * bits of the hash selecting the byte and the bottom 3 the bit. Partitioning is what lets a single
+ * 8-bit hash address a bitmap bigger than 256 bits, and it has about the same false positive rate
+ * as a plain Bloom filter of the same size.
+ *
+ * Setting and testing a bit are lookups into 8-page tables with one page per bit position; the
+ * position picks the row, and the bitmap byte, read through a patched SRCADDR, the column. A
+ * query stops at the first bit that isn't set.
+ */
+
+#include "bloom.h"
+
+static const uint8_t bloom_zero = 0;
+static const uint8_t bloom_one = 1;
+
+/**
+ * Fills 'perm' with a permutation of 0 - 255 that only depends on 'seed'.
+ */
+static void setup_permutation(uint8_t* perm, uint32_t seed)
+{
+    uint32_t x = 2463534242ul + (seed * 0x9e3779b9ul);
+
+    for (uint32_t count = 0; count < 256; count++) { perm[count] = count; }
+    for (uint32_t count = 255; count > 0; count--) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        uint32_t j = x % (count + 1);
+        uint8_t t = perm[count];
+        perm[count] = perm[j];
+        perm[j] = t;
+    }
+}
+
+/**
+ * Sets up a filter with nhashes (at most BLOOM_MAX_HASHES) hash functions and an empty bitmap.
+ * 'mem' is BLOOM_TABLES_SIZE(nhashes) bytes and 'bitmap' BLOOM_BITMAP_SIZE(nhashes) bytes; both
+ * must start on a 256-byte boundary.
+ */
+void setup_bloom(bloom_t* bloom,
+                 const digit_luts_t* luts,
+                 uint32_t nhashes,
+                 uint8_t* mem,
+                 uint8_t* bitmap)
+{
+    uint8_t* set = &mem[0 * 256];
+    uint8_t* test = &mem[8 * 256];
+    uint8_t* to_set = &mem[16 * 256];
+    uint8_t* to_test = &mem[17 * 256];
+    uint8_t* xor = &mem[18 * 256];
+    uint8_t* branch = &mem[19 * 256];
+    uint8_t* p = &mem[20 * 256];
+
+    bloom->luts = luts;
+    bloom->nhashes = nhashes;
+    bloom->bitmap = bitmap;
+    bloom->set = set;
+    bloom->test = test;
+    bloom->to_set = to_set;
+    bloom->to_test = to_test;
+    bloom->xor = xor;
+    bloom->branch = branch;
+
+    for (uint32_t b = 0; b < 8; b++) {
+        for (uint32_t count = 0; count < 256; count++) {
+            set[(b * 256) + count] = count | (1 << b);
+            test[(b * 256) + count] = count & (1 << b);
+        }
+    }
+    for (uint32_t count = 0; count < 256; count++) {
+        to_set[count] = lut_page(set) + (count & 7);
+        to_test[count] = lut_page(test) + (count & 7);
+    }
+    setup_digit_xor(xor);
+    setup_branch_if_zero(branch);
+
+    for (uint32_t i = 0; i < nhashes; i++) {
+        uint8_t* byte = p + 256;
+        setup_permutation(p, i);
+        for (uint32_t count = 0; count < 256; count++) {
+            byte[count] = (uint8_t)(((uint32_t)bitmap + (32 * i) + (count >> 3)) & 0xff);
+        }
+        bloom->hash[i] = p;
+        bloom->byte[i] = byte;
+        p += 2 * 256;
+    }
+
+    bloom_clear(bloom);
+}
+
+/**
+ * Empties the filter.
+ */
+void bloom_clear(bloom_t* bloom)
+{
+    for (uint32_t i = 0; i < BLOOM_BITMAP_SIZE(bloom->nhashes); i++) { bloom->bitmap[i] = 0; }
+}
+
+/**
+ * At most 1 + key_len * CRC8_UPDATE_DESCS descriptors. *h = hash i of the key_len bytes at 'key'.
+ */
+static DmacDescriptor* build_bloom_hash(DmacDescriptor* d,
+                                        const bloom_t* bloom,
+                                        uint32_t i,
+                                        const volatile uint8_t* key,
+                                        uint32_t key_len,
+                                        uint8_t* h,
+                                        uint8_t* scratch)
+{
+    d = build_copy(d, &bloom_zero, h, 1);
+    for (uint32_t j = 0; j < key_len; j++) {
+        d = build_crc8_update(d, bloom->luts, bloom->xor, bloom->hash[i], &key[j], h, scratch);
+    }
+    return d;
+}
+
+/**
+ * At most BLOOM_INSERT_DESCS(bloom->nhashes, key_len) descriptors. Adds the key_len bytes at 'key'
+ * to the filter. The key is read when the chain runs.
+ *
+ * 'scratch' is BLOOM_SCRATCH bytes that must be private to this instance.
+ */
+DmacDescriptor* build_bloom_insert(DmacDescriptor* descs,
+                                   const bloom_t* bloom,
+                                   const volatile uint8_t* key,
+                                   uint32_t key_len,
+                                   uint8_t* scratch)
+{
+    uint8_t* h = &scratch[0];
+    DmacDescriptor* d = descs;
+
+    for (uint32_t i = 0; i < bloom->nhashes; i++) {
+        d = build_bloom_hash(d, bloom, i, key, key_len, h, &scratch[8]);
+
+        // bitmap byte = set[bit][bitmap byte], read and written back through patched addresses.
+        DmacDescriptor* read = d + 6;
+        DmacDescriptor* write = read + 1;
+        d = build_lookup(d, bloom->byte[i], h, desc_src_byte(read, 0));
+        d = build_lookup(d, bloom->byte[i], h, desc_dst_byte(write, 0));
+        d = build_lookup(d, bloom->to_set, h, desc_src_byte(write, 1));
+        dma_desc_set(read, DMAC_BTCTRL_BEATSIZE_BYTE, 1, bloom->bitmap, desc_src_byte(write, 0),
+                     write);
+        dma_desc_set(write, DMAC_BTCTRL_BEATSIZE_BYTE, 1, bloom->set, bloom->bitmap, write + 1);
+        d = write + 1;
+    }
+    return d;
+}
+
+/**
+ * At most BLOOM_QUERY_DESCS(bloom->nhashes, key_len) descriptors. Sets *result to 1 if the key_len
+ * bytes at 'key' might have been added to the filter, and to 0 if they definitely weren't. The key
+ * is read when the chain runs.
+ *
+ * 'scratch' is BLOOM_SCRATCH bytes that must start on a 256-byte boundary and be private to this
+ * instance; it's filled in here.
+ */
+DmacDescriptor* build_bloom_query(DmacDescriptor* descs,
+                                  const bloom_t* bloom,
+                                  const volatile uint8_t* key,
+                                  uint32_t key_len,
+                                  volatile uint8_t* result,
+                                  uint8_t* scratch)
+{
+    // Every bit test branches through the same targets, so the "bit is set" one is switched over
+    // to the next hash before each branch. nexts[i] is where hash i continues.
+    DmacDescriptor** targets = (DmacDescriptor**)&scratch[0];
+    DmacDescriptor** nexts = (DmacDescriptor**)&scratch[8];
+    uint8_t* h = &scratch[48];
+    uint8_t* flag = &scratch[49];
+    uint8_t* crc_scratch = &scratch[56];
+
+    DmacDescriptor* d = descs;
+
+    for (uint32_t i = 0; i < bloom->nhashes; i++) {
+        d = build_bloom_hash(d, bloom, i, key, key_len, h, crc_scratch);
+
+        DmacDescriptor* read = d + 4;
+        DmacDescriptor* test = read + 1;
+        d = build_lookup(d, bloom->byte[i], h, desc_src_byte(read, 0));
+        d = build_lookup(d, bloom->to_test, h, desc_src_byte(test, 1));
+        dma_desc_set(read, DMAC_BTCTRL_BEATSIZE_BYTE, 1, bloom->bitmap, desc_src_byte(test, 0),
+                     test);
+        dma_desc_set(test, DMAC_BTCTRL_BEATSIZE_BYTE, 1, bloom->test, flag, test + 1);
+        d = test + 1;
+
+        d = build_copy(d, &nexts[i], &targets[0], 4);
+        d = build_branch(d, bloom->branch, flag, targets);
+        nexts[i] = d;
+    }
+
+    DmacDescriptor* hit = d;
+    d = build_copy(d, &bloom_one, result, 1);
+    targets[1] = d;
+    d = build_copy(d, &bloom_zero, result, 1);
+    hit->DESCADDR.reg = (uint32_t)d;
+    return build_nop(d);
+}
@@ -0,0 +1,55 @@
+#ifndef _BLOOM_H
+#define _BLOOM_H
+
+#include <stdint.h>
+#include "dma.h"
+#include "dmainstrs.h"
+
+#define BLOOM_MAX_HASHES 8
+
+/**
+ * A partitioned Bloom filter: hash i picks one of the 256 bits in bytes 32 * i to 32 * i + 31 of
+ * the bitmap. See bloom.c.
+ */
+typedef struct bloom {
+    const digit_luts_t* luts;
+    uint32_t nhashes;
+    uint8_t* bitmap;                            // 32 * nhashes bytes, 256-byte aligned
+    const uint8_t* hash[BLOOM_MAX_HASHES];      // Pearson permutation for hash i
+    const uint8_t* byte[BLOOM_MAX_HASHES];      // hash i -> low byte of its bitmap byte
+    const uint8_t* to_set;    // hash -> page of set for its bit in the byte
+    const uint8_t* to_test;   // hash -> page of test for its bit in the byte
+    const uint8_t* set;       // 8x256, [b][v] -> v with bit b set
+    const uint8_t* test;      // 8x256, [b][v] -> v & (1 << b)
+    const uint8_t* xor;       // setup_digit_xor()
+    const uint8_t* branch;    // setup_branch_if_zero(), unbiased
+} bloom_t;
+
+#define BLOOM_TABLES_SIZE(nhashes) ((20 + (2 * (nhashes))) * 256)
+#define BLOOM_BITMAP_SIZE(nhashes) (32 * (nhashes))
+#define BLOOM_SCRATCH 256
+
+#define BLOOM_INSERT_DESCS(nhashes, key_len) \
+    ((nhashes) * (9 + ((key_len) * CRC8_UPDATE_DESCS)))
+#define BLOOM_QUERY_DESCS(nhashes, key_len) \
+    (3 + ((nhashes) * (12 + ((key_len) * CRC8_UPDATE_DESCS))))
+
+void setup_bloom(bloom_t* bloom,
+                 const digit_luts_t* luts,
+                 uint32_t nhashes,
+                 uint8_t* mem,
+                 uint8_t* bitmap);
+void bloom_clear(bloom_t* bloom);
+DmacDescriptor* build_bloom_insert(DmacDescriptor* descs,
+                                   const bloom_t* bloom,
+                                   const volatile uint8_t* key,
+                                   uint32_t key_len,
+                                   uint8_t* scratch);
+DmacDescriptor* build_bloom_query(DmacDescriptor* descs,
+                                  const bloom_t* bloom,
+                                  const volatile uint8_t* key,
+                                  uint32_t key_len,
+                                  volatile uint8_t* result,
+                                  uint8_t* scratch);
+
+#endif
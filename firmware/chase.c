@@ -0,0 +1,114 @@
+/**
+ * Pointer chasing: walking linked lists and binary search trees with descriptors.
+ *
+ * A hop is a word copy whose SRCADDR was patched with the address of the link to follow, and which
+ * writes the pointer it reads over the current node pointer. The address of the link is the node
+ * pointer with its low byte run through a table that adds the offset of link[0] or link[1]; which
+ * of the two comes from a table indexed by the node's key, which can also say that the key
+ * matched. Walking a list and searching a tree are then the same loop with a different key table.
+ *
+ * The walk stops on a match or on a null link. Null is recognized by the top byte of the pointer
+ * alone, which is 0x20 for every SRAM address. Nothing stops a walk around a cycle.
+ */
+
+#include <stddef.h>
+#include "chase.h"
+#include "dmainstrs.h"
+
+/**
+ * Everything but the key table. Its 'found' value only ever goes to the done table, and never
+ * selects an actual page of 'link'.
+ */
+static void setup_chase_common(chase_engine_t* eng, uint8_t* mem)
+{
+    uint8_t* link = &mem[1 * 256];
+    uint8_t* done = &mem[3 * 256];
+    uint8_t* branch = &mem[4 * 256];
+
+    eng->dir = &mem[0];
+    eng->link = link;
+    eng->done = done;
+    eng->branch = branch;
+
+    for (uint32_t count = 0; count < 256; count++) {
+        link[(0 * 256) + count] = count + offsetof(chase_node_t, link[0]);
+        link[(1 * 256) + count] = count + offsetof(chase_node_t, link[1]);
+        done[count] = (count == (uint8_t)(lut_page(link) + CHASE_FOUND)) ? 12 : 8;
+    }
+    setup_branch_if_zero(branch);
+}
+
+/**
+ * Sets up a search of a list for the first node with the given key. 'mem' must start on a 256-byte
+ * boundary and have room for CHASE_ENGINE_SIZE bytes. Calling this again with another key changes
+ * what chains that were built with the engine look for.
+ */
+void setup_chase_list(chase_engine_t* eng, uint8_t key, uint8_t* mem)
+{
+    setup_chase_common(eng, mem);
+    for (uint32_t count = 0; count < 256; count++) {
+        mem[count] = lut_page(eng->link) + ((count == key) ? CHASE_FOUND : 0);
+    }
+}
+
+/**
+ * Like setup_chase_list(), but for looking up a key in a binary search tree.
+ */
+void setup_chase_tree(chase_engine_t* eng, uint8_t key, uint8_t* mem)
+{
+    setup_chase_common(eng, mem);
+    for (uint32_t count = 0; count < 256; count++) {
+        mem[count] = lut_page(eng->link) + ((key < count) ? 0 : ((key > count) ? 1 : CHASE_FOUND));
+    }
+}
+
+/**
+ * CHASE_DESCS descriptors. Starting from the node that *root points to, follows links until the
+ * engine's key turns up, and sets *result to the node that has it or to NULL if a null link was
+ * reached first. *root is read when the chain runs, so it can change between runs.
+ *
+ * Costs 15 descriptors per node visited. 'scratch' is CHASE_SCRATCH bytes that must start on a
+ * 256-byte boundary and be private to this instance; it's filled in here.
+ */
+DmacDescriptor* build_chase(DmacDescriptor* descs,
+                            const chase_engine_t* eng,
+                            chase_node_t* const volatile* root,
+                            chase_node_t* volatile* result,
+                            uint8_t* scratch)
+{
+    // eng->done picks byte offset 8 or 12, so the null test's targets fit in front of its own.
+    DmacDescriptor** targets = (DmacDescriptor**)&scratch[0];
+    DmacDescriptor** found_targets = (DmacDescriptor**)&scratch[8];
+    uint8_t* node = &scratch[16];
+
+    DmacDescriptor* d = descs;
+
+    d = build_copy(d, root, node, 4);
+
+    DmacDescriptor* test = d;
+    DmacDescriptor* body = build_branch(d, eng->branch, &node[3], targets);
+
+    // The key is the first byte of the node, so reading it needs no address arithmetic.
+    DmacDescriptor* key = body + 1;
+    DmacDescriptor* link = key + 7;
+    DmacDescriptor* hop = link + 2;
+    build_copy(body, node, &key->SRCADDR.reg, 4);
+    dma_desc_set(key, DMAC_BTCTRL_BEATSIZE_BYTE, 1, 0, desc_src_byte(key + 1, 0), key + 1);
+    dma_desc_set(key + 1, DMAC_BTCTRL_BEATSIZE_BYTE, 1, eng->dir, desc_src_byte(link, 1), key + 2);
+
+    DmacDescriptor* next = build_branch(key + 2, eng->done, desc_src_byte(link, 1), found_targets);
+    found_targets[0] = next;
+
+    // link[page][low byte of node] is the low byte of the link's address; the rest of the address
+    // is the node's.
+    build_copy(next, &node[0], desc_src_byte(link, 0), 1);
+    dma_desc_set(link, DMAC_BTCTRL_BEATSIZE_BYTE, 1, eng->link, desc_src_byte(hop, 0), link + 1);
+    build_copy(link + 1, &node[1], desc_src_byte(hop, 1), 3);
+    dma_desc_set(hop, DMAC_BTCTRL_BEATSIZE_WORD, 1, 0, node, test);
+    d = hop + 1;
+
+    targets[0] = body;
+    targets[1] = d;
+    found_targets[1] = d;
+    return build_copy(d, node, result, 4);
+}
@@ -0,0 +1,43 @@
+#ifndef _CHASE_H
+#define _CHASE_H
+
+#include <stdint.h>
+#include "dma.h"
+
+/**
+ * A node of a linked list or binary tree that build_chase() can walk. For a list, link[0] is the
+ * next node; for a tree, link[0] and link[1] are the left (smaller keys) and right children.
+ * Nodes have to be in SRAM, and the 16-byte alignment keeps a node's fields on one 256-byte page.
+ */
+typedef struct chase_node {
+    uint8_t key;
+    uint8_t data[3];                // free for whatever the node carries
+    struct chase_node* link[2];
+    uint32_t user;
+} __attribute__((aligned(16))) chase_node_t;
+
+/**
+ * Tables for searching for one key; see setup_chase_list() and setup_chase_tree().
+ */
+typedef struct chase_engine {
+    const uint8_t* dir;       // node key -> page of 'link' to follow, or CHASE_FOUND past it
+    const uint8_t* link;      // 2x256, [i][low byte of node] -> low byte of &node->link[i]
+    const uint8_t* done;      // dir -> byte offset 12 if it's the found page, 8 otherwise
+    const uint8_t* branch;    // setup_branch_if_zero(), unbiased
+} chase_engine_t;
+
+#define CHASE_FOUND 2    // page of 'link' that dir points to when the key matches
+
+#define CHASE_ENGINE_SIZE (5 * 256)
+#define CHASE_SCRATCH     256
+#define CHASE_DESCS       17
+
+void setup_chase_list(chase_engine_t* eng, uint8_t key, uint8_t* mem);
+void setup_chase_tree(chase_engine_t* eng, uint8_t key, uint8_t* mem);
+DmacDescriptor* build_chase(DmacDescriptor* descs,
+                            const chase_engine_t* eng,
+                            chase_node_t* const volatile* root,
+                            chase_node_t* volatile* result,
+                            uint8_t* scratch);
+
+#endif
@@ -0,0 +1,843 @@
+/**
+ * A CHIP-8 interpreter made of descriptors.
+ *
+ * The main loop is fixed: bump pc by 2 with a table and a carry into its page byte, fetch the
+ * opcode through a patched SRCADDR, pull x and y out of it with nibble tables and load Vx and Vy
+ * with lookups into the register file (which starts on a 256-byte boundary, so it can be used as a
+ * table), then branch on the first opcode byte through a jump page. The 8XYN and the 0NNN / EXNN /
+ * FXNN groups take a second branch on the second byte. Every handler ends by jumping back to the
+ * top of the loop, which counts down the number of instructions to run.
+ *
+ * Arithmetic and logic all go through one digit-serial ALU, called like a subroutine: the caller
+ * sets the op and writes where to continue into the DESCADDR of the ALU's last descriptor. The op
+ * is picked at run time by encoding it above the carry in every digit result of the op tables, so
+ * the same carry_page lookup that chains the digits of an add also keeps every digit on the pages
+ * of the right op; the first digit starts from the op byte instead of a carry.
+ *
+ * DXYN draws a row at a time: the sprite byte is shifted right by x & 7 into a pair of bytes with
+ * an unrolled ladder of 1-bit shifts that's entered part way down, and each byte is ANDed with the
+ * display (a nonzero result sets VF) and then XORed into it. FX33, FX55, FX65 and DXYN go through
+ * a 16-byte window at I that's copied in and, if it was changed, back out: I is stored as I + 16
+ * so that its bytes can be patched straight into a SRCINC / DSTINC descriptor.
+ *
+ * Not implemented: there's no keypad, so EX9E never skips, EXA1 always skips and FX0A does nothing,
+ * and the timers only count down if the CPU does that. FX55 and FX65 leave I alone, and 8XY6 and
+ * 8XYE shift Vx, not Vy. 0NNN machine code calls and anything that isn't a CHIP-8 instruction do
+ * whatever the instruction with the same second byte in the 0 / E / F groups does, or nothing.
+ * Nothing is bounds checked: a program that goes outside mem_size, or 16 deep in calls, overwrites
+ * whatever is there.
+ */
+
+#include "chip8.h"
+
+// Offsets of the handlers and branch targets in the jump page.
+#define J_MAIN   0      // 16 handlers by the top nibble of the opcode
+#define J_GROUP8 64     // 8XY0 - 8XY7, then 8XYE at 96
+#define J_NOP    100
+#define J_CLS    104
+#define J_RET    108
+#define J_SKIP   112
+#define J_FX07   116
+#define J_FX15   120
+#define J_FX18   124
+#define J_FX1E   128
+#define J_FX29   132
+#define J_FX33   136
+#define J_FX55   140
+#define J_FX65   144
+#define J_SHIFT  148    // 8 entries into the sprite shift, by x & 7
+#define J_LOOP   180    // the rest are { nonzero, zero } pairs that get copied to J_SLOT
+#define J_SE     188
+#define J_SNE    196
+#define J_ROW    204
+#define J_COLL0  212
+#define J_COLL1  220
+#define J_SLOT   248
+
+// ALU ops, as the op byte the first digit starts from.
+#define ALU_ADD  0
+#define ALU_ADDC (1 << DIGIT_BITS)
+#define ALU_OR   (1 << (DIGIT_BITS + 1))
+#define ALU_AND  (2 << (DIGIT_BITS + 1))
+#define ALU_XOR  (3 << (DIGIT_BITS + 1))
+
+static const uint8_t chip8_zero = 0;
+static const uint8_t chip8_one = 1;
+static const uint8_t chip8_window = CHIP8_WINDOW;
+static const uint8_t chip8_ff = 0xff;
+static const uint32_t chip8_zero_word = 0;
+static const uint8_t alu_add = ALU_ADD;
+static const uint8_t alu_addc = ALU_ADDC;
+static const uint8_t alu_or = ALU_OR;
+static const uint8_t alu_and = ALU_AND;
+static const uint8_t alu_xor = ALU_XOR;
+
+static const uint8_t chip8_font[80] = {
+    0xf0, 0x90, 0x90, 0x90, 0xf0, 0x20, 0x60, 0x20, 0x20, 0x70,
+    0xf0, 0x10, 0xf0, 0x80, 0xf0, 0xf0, 0x10, 0xf0, 0x10, 0xf0,
+    0x90, 0x90, 0xf0, 0x10, 0x10, 0xf0, 0x80, 0xf0, 0x10, 0xf0,
+    0xf0, 0x80, 0xf0, 0x90, 0xf0, 0xf0, 0x10, 0x20, 0x40, 0x40,
+    0xf0, 0x90, 0xf0, 0x90, 0xf0, 0xf0, 0x90, 0xf0, 0x10, 0xf0,
+    0xf0, 0x90, 0xf0, 0x90, 0x90, 0xe0, 0x90, 0xe0, 0x90, 0xe0,
+    0xf0, 0x80, 0x80, 0x80, 0xf0, 0xe0, 0x90, 0x90, 0x90, 0xe0,
+    0xf0, 0x80, 0xf0, 0x80, 0xf0, 0xf0, 0x80, 0xf0, 0x80, 0x80,
+};
+
+static uint8_t lfsr_next(uint8_t v)
+{
+    return (v >> 1) ^ ((v & 1) ? 0xb8 : 0);
+}
+
+/**
+ * Fills out the tables. 'mem' must start on a 256-byte boundary and have room for
+ * CHIP8_ENGINE_SIZE bytes.
+ */
+void setup_chip8_engine(chip8_engine_t* eng, const digit_luts_t* luts, uint8_t* mem)
+{
+    uint8_t* alu = &mem[0 * 256];
+    uint8_t* to_alu = &mem[5 * 256];
+    uint8_t* ident = &mem[6 * 256];
+    uint8_t* inc = &mem[7 * 256];
+    uint8_t* dec = &mem[8 * 256];
+    uint8_t* add2 = &mem[9 * 256];
+    uint8_t* carry2 = &mem[10 * 256];
+    uint8_t* carry_row = &mem[11 * 256];
+    uint8_t* flag = &mem[12 * 256];
+    uint8_t* dispatch = &mem[13 * 256];
+    uint8_t* group8 = &mem[14 * 256];
+    uint8_t* misc = &mem[15 * 256];
+    uint8_t* zero = &mem[16 * 256];
+    uint8_t* lo_nibble = &mem[17 * 256];
+    uint8_t* hi_nibble = &mem[18 * 256];
+    uint8_t* shr = &mem[19 * 256];
+    uint8_t* to_shr = &mem[21 * 256];
+    uint8_t* shift = &mem[22 * 256];
+    uint8_t* row = &mem[23 * 256];
+    uint8_t* column = &mem[24 * 256];
+    uint8_t* next_byte = &mem[25 * 256];
+    uint8_t* add8 = &mem[26 * 256];
+    uint8_t* lfsr = &mem[27 * 256];
+    uint8_t* font = &mem[28 * 256];
+    uint8_t* hundreds = &mem[29 * 256];
+    uint8_t* tens_ones = &mem[30 * 256];
+
+    eng->luts = luts;
+    eng->alu = alu;
+    eng->to_alu = to_alu;
+    eng->ident = ident;
+    eng->inc = inc;
+    eng->dec = dec;
+    eng->add2 = add2;
+    eng->carry2 = carry2;
+    eng->carry_row = carry_row;
+    eng->flag = flag;
+    eng->dispatch = dispatch;
+    eng->group8 = group8;
+    eng->misc = misc;
+    eng->zero = zero;
+    eng->lo_nibble = lo_nibble;
+    eng->hi_nibble = hi_nibble;
+    eng->shr = shr;
+    eng->to_shr = to_shr;
+    eng->shift = shift;
+    eng->row = row;
+    eng->column = column;
+    eng->next_byte = next_byte;
+    eng->add8 = add8;
+    eng->lfsr = lfsr;
+    eng->font = font;
+    eng->hundreds = hundreds;
+    eng->tens_ones = tens_ones;
+
+    // The ALU pages are add without and with carry in, or, and, xor; op n > 0 is on page n + 1.
+    for (uint32_t count = 0; count < 256; count++) {
+        uint32_t a = (count >> DIGIT_BITS) & DIGIT_MASK;
+        uint32_t b = count & DIGIT_MASK;
+        alu[(0 * 256) + count] = ALU_ADD | ((a + b) & ((DIGIT_MASK << 1) | 1));
+        alu[(1 * 256) + count] = ALU_ADD | ((a + b + 1) & ((DIGIT_MASK << 1) | 1));
+        alu[(2 * 256) + count] = ALU_OR | (a | b);
+        alu[(3 * 256) + count] = ALU_AND | (a & b);
+        alu[(4 * 256) + count] = ALU_XOR | (a ^ b);
+
+        uint32_t op = count >> (DIGIT_BITS + 1);
+        uint32_t carry = (count >> DIGIT_BITS) & 1;
+        to_alu[count] = lut_page(alu) + ((op == 0) ? carry : (op < 4) ? (op + 1) : 0);
+    }
+
+    setup_add_const(ident, 0);
+    setup_add_const(inc, 1);
+    setup_decrement(dec);
+    setup_add_const(add2, 2);
+    setup_carry_to_page(carry2, 2, lut_page(inc), lut_page(ident));
+    setup_flags_to_page(carry_row, lut_page(ident));
+    setup_add_const(add8, 8);
+
+    for (uint32_t count = 0; count < 256; count++) {
+        flag[count] = (count >> DIGIT_BITS) & 1;
+        dispatch[count] = J_MAIN + ((count >> 4) * 4);
+        group8[count] = ((count & 0xf) < 8) ? (J_GROUP8 + ((count & 0xf) * 4)) :
+                        ((count & 0xf) == 0xe) ? (J_GROUP8 + 32) : J_NOP;
+        misc[count] = J_NOP;
+        zero[count] = (count == 0) ? (J_SLOT + 4) : J_SLOT;
+        lo_nibble[count] = count & 0xf;
+        hi_nibble[count] = count >> 4;
+        shr[count] = count >> 1;
+        shr[256 + count] = (count >> 1) | 0x80;
+        to_shr[count] = lut_page(shr) + (count & 1);
+        shift[count] = J_SHIFT + ((count & 7) * 4);
+        row[count] = (count & 31) * 8;
+        column[count] = (count >> 3) & 7;
+        next_byte[count] = (count & 0xf8) | ((count + 1) & 7);
+        lfsr[count] = lfsr_next(count);
+        font[count] = ((count & 0xf) * 5) + CHIP8_WINDOW;
+        hundreds[count] = count / 100;
+        tens_ones[count] = (((count / 10) % 10) << 4) | (count % 10);
+    }
+    misc[0xe0] = J_CLS;
+    misc[0xee] = J_RET;
+    misc[0xa1] = J_SKIP;
+    misc[0x07] = J_FX07;
+    misc[0x15] = J_FX15;
+    misc[0x18] = J_FX18;
+    misc[0x1e] = J_FX1E;
+    misc[0x29] = J_FX29;
+    misc[0x33] = J_FX33;
+    misc[0x55] = J_FX55;
+    misc[0x65] = J_FX65;
+}
+
+/**
+ * Clears the machine and puts the font at address 0. 'mem' is mem_size bytes (at most
+ * CHIP8_MEM_SIZE); it, the display and the state must all start on a 256-byte boundary.
+ */
+void chip8_init(chip8_t* c8,
+                uint8_t* mem,
+                uint32_t mem_size,
+                uint8_t* display,
+                chip8_state_t* state)
+{
+    c8->mem = mem;
+    c8->mem_size = mem_size;
+    c8->display = display;
+    c8->state = state;
+
+    for (uint32_t i = 0; i < mem_size; i++) { mem[i] = 0; }
+    for (uint32_t i = 0; i < sizeof(chip8_font); i++) { mem[i] = chip8_font[i]; }
+    for (uint32_t i = 0; i < 256; i++) { display[i] = 0; }
+    for (uint32_t i = 0; i < sizeof(*state); i++) { ((uint8_t*)state)[i] = 0; }
+
+    const uint32_t pc = (uint32_t)mem + CHIP8_PROG_START;
+    const uint32_t i_end = (uint32_t)mem + CHIP8_WINDOW;
+    state->pc[0] = pc & 0xff;
+    state->pc[1] = (pc >> 8) & 0xff;
+    state->i[0] = i_end & 0xff;
+    state->i[1] = (i_end >> 8) & 0xff;
+    state->sp = 30;
+    state->rng = 1;
+}
+
+/**
+ * Copies a program to CHIP8_PROG_START. Returns 0, or -1 if it (and the window at I, if I is
+ * pointed at its end) doesn't fit in memory.
+ */
+int chip8_load(chip8_t* c8, const uint8_t* prog, uint32_t len)
+{
+    if ((CHIP8_PROG_START + len + CHIP8_WINDOW) > c8->mem_size) { return -1; }
+    for (uint32_t i = 0; i < len; i++) { c8->mem[CHIP8_PROG_START + i] = prog[i]; }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Reference interpreter
+
+static uint32_t get_addr(const uint8_t* a)
+{
+    return a[0] | (a[1] << 8);
+}
+
+static void set_addr(uint8_t* a, uint32_t addr)
+{
+    a[0] = addr & 0xff;
+    a[1] = (addr >> 8) & 0xff;
+}
+
+/**
+ * The byte at the low two address bytes 'addr', in the same 64KiB as the machine's memory.
+ */
+static uint8_t* chip8_ptr(const chip8_t* c8, uint32_t addr)
+{
+    return (uint8_t*)(((uint32_t)c8->mem & 0xffff0000ul) | (addr & 0xffff));
+}
+
+/**
+ * Runs 'steps' instructions on the CPU, exactly as build_chip8() does.
+ */
+void chip8_run(chip8_t* c8, uint32_t steps)
+{
+    chip8_state_t* s = c8->state;
+    uint8_t* v = s->v;
+    const uint32_t base = (uint32_t)c8->mem;
+
+    for (uint32_t n = 0; n < steps; n++) {
+        const uint32_t pc = get_addr(s->pc) + 2;
+        set_addr(s->pc, pc);
+        const uint8_t* ins = chip8_ptr(c8, pc - 2);
+        const uint8_t op0 = ins[0];
+        const uint8_t op1 = ins[1];
+        const uint32_t nnn = ((op0 & 0xf) << 8) | op1;
+        const uint8_t x = op0 & 0xf;
+        const uint8_t vx = v[x];
+        const uint8_t vy = v[op1 >> 4];
+        uint8_t* window = chip8_ptr(c8, get_addr(s->i) - CHIP8_WINDOW);
+        uint8_t* top;
+        uint32_t r;
+
+        switch (op0 >> 4) {
+        case 0x0:
+        case 0xe:
+        case 0xf:
+            switch (op1) {
+            case 0xe0: for (uint32_t i = 0; i < 256; i++) { c8->display[i] = 0; } break;
+            case 0xee:
+                top = &((uint8_t*)s)[s->sp];
+                s->pc[0] = top[0];
+                s->pc[1] = top[1];
+                s->sp -= 2;
+                break;
+            case 0xa1: set_addr(s->pc, pc + 2); break;
+            case 0x07: v[x] = s->dt; break;
+            case 0x15: s->dt = vx; break;
+            case 0x18: s->st = vx; break;
+            case 0x1e: set_addr(s->i, get_addr(s->i) + vx); break;
+            case 0x29: set_addr(s->i, base + ((vx & 0xf) * 5) + CHIP8_WINDOW); break;
+            case 0x33:
+                window[0] = vx / 100;
+                window[1] = (vx / 10) % 10;
+                window[2] = vx % 10;
+                break;
+            case 0x55: for (uint32_t i = 0; i <= x; i++) { window[i] = v[i]; } break;
+            case 0x65: for (uint32_t i = 0; i <= x; i++) { v[i] = window[i]; } break;
+            default: break;
+            }
+            break;
+        case 0x2:
+            s->sp += 2;
+            top = &((uint8_t*)s)[s->sp];
+            top[0] = pc & 0xff;
+            top[1] = (pc >> 8) & 0xff;
+            set_addr(s->pc, base + nnn);
+            break;
+        case 0x1: set_addr(s->pc, base + nnn); break;
+        case 0x3: if (vx == op1) { set_addr(s->pc, pc + 2); } break;
+        case 0x4: if (vx != op1) { set_addr(s->pc, pc + 2); } break;
+        case 0x5: if (vx == vy) { set_addr(s->pc, pc + 2); } break;
+        case 0x9: if (vx != vy) { set_addr(s->pc, pc + 2); } break;
+        case 0x6: v[x] = op1; break;
+        case 0x7: v[x] = vx + op1; break;
+        case 0x8:
+            switch (op1 & 0xf) {
+            case 0x0: v[x] = vy; break;
+            case 0x1: v[x] = vx | vy; break;
+            case 0x2: v[x] = vx & vy; break;
+            case 0x3: v[x] = vx ^ vy; break;
+            case 0x4: r = vx + vy; v[x] = r; v[15] = r >> 8; break;
+            case 0x5: r = vx + (vy ^ 0xff) + 1; v[x] = r; v[15] = r >> 8; break;
+            case 0x6: v[x] = vx >> 1; v[15] = vx & 1; break;
+            case 0x7: r = (vx ^ 0xff) + vy + 1; v[x] = r; v[15] = r >> 8; break;
+            case 0xe: r = vx + vx; v[x] = r; v[15] = r >> 8; break;
+            default: break;
+            }
+            break;
+        case 0xa: set_addr(s->i, base + nnn + CHIP8_WINDOW); break;
+        case 0xb: set_addr(s->pc, base + nnn + v[0]); break;
+        case 0xc: s->rng = lfsr_next(s->rng); v[x] = s->rng & op1; break;
+        case 0xd: {
+            const uint32_t k = vx & 7;
+            uint8_t lo = ((vy & 31) * 8) + ((vx >> 3) & 7);
+            v[15] = 0;
+            for (uint32_t i = 0; i < (op1 & 0xfu); i++) {
+                const uint8_t parts[2] = { window[i] >> k, (window[i] << (8 - k)) & 0xff };
+                const uint8_t at[2] = { lo, (lo & 0xf8) | ((lo + 1) & 7) };
+                for (uint32_t j = 0; j < 2; j++) {
+                    if (c8->display[at[j]] & parts[j]) { v[15] = 1; }
+                    c8->display[at[j]] ^= parts[j];
+                }
+                lo += 8;
+            }
+            break;
+        }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Descriptors
+
+// Where the ALU is and where its callers continue; set up by build_chip8() as it goes.
+static DmacDescriptor* alu_entry;
+static DmacDescriptor* alu_exit;
+static uint8_t* alu_op;
+static DmacDescriptor** alu_rets;
+static uint32_t alu_nrets;
+
+/**
+ * 2 descriptors. Runs the ALU with op *op and continues at 'cont', or after these descriptors if
+ * it's NULL.
+ */
+static DmacDescriptor* build_alu_call(DmacDescriptor* d, const uint8_t* op, DmacDescriptor* cont)
+{
+    DmacDescriptor** ret = &alu_rets[alu_nrets++];
+
+    d = build_copy(d, op, alu_op, 1);
+    d = build_copy(d, ret, &alu_exit->DESCADDR.reg, 4);
+    (d - 1)->DESCADDR.reg = (uint32_t)alu_entry;
+    *ret = cont ? cont : d;
+    return d;
+}
+
+/**
+ * 4 descriptors. *out = *page, plus 1 if table[*index] says that the low byte carried.
+ */
+static DmacDescriptor* build_carry(DmacDescriptor* d,
+                                   const chip8_engine_t* eng,
+                                   const uint8_t* table,
+                                   const volatile uint8_t* index,
+                                   const volatile uint8_t* page,
+                                   volatile uint8_t* out)
+{
+    DmacDescriptor* add = d + 3;
+
+    d = build_lookup(d, table, index, desc_src_byte(add, 1));
+    d = build_copy(d, page, desc_src_byte(add, 0), 1);
+    dma_desc_set(add, DMAC_BTCTRL_BEATSIZE_BYTE, 1, eng->ident, out, add + 1);
+    return add + 1;
+}
+
+/**
+ * 6 descriptors. pc += 2.
+ */
+static DmacDescriptor* build_next_pc(DmacDescriptor* d,
+                                     const chip8_engine_t* eng,
+                                     chip8_state_t* st)
+{
+    d = build_carry(d, eng, eng->carry2, &st->pc[0], &st->pc[1], &st->pc[1]);
+    return build_lookup(d, eng->add2, &st->pc[0], &st->pc[0]);
+}
+
+/**
+ * 2 descriptors. base[*index] = *src, where 'base' starts on a 256-byte boundary.
+ */
+static DmacDescriptor* build_store(DmacDescriptor* d,
+                                   uint8_t* base,
+                                   const uint8_t* index,
+                                   const volatile uint8_t* src)
+{
+    DmacDescriptor* store = d + 1;
+
+    d = build_copy(d, index, desc_dst_byte(store, 0), 1);
+    dma_desc_set(store, DMAC_BTCTRL_BEATSIZE_BYTE, 1, src, base, store + 1);
+    return store + 1;
+}
+
+/**
+ * 2 descriptors. Copies the CHIP8_WINDOW bytes at I to 'window', or back if 'write' is set.
+ */
+static DmacDescriptor* build_window(DmacDescriptor* d, chip8_t* c8, uint8_t* window, int write)
+{
+    const uint16_t btctrl = DMAC_BTCTRL_BEATSIZE_BYTE | DMAC_BTCTRL_SRCINC | DMAC_BTCTRL_DSTINC;
+    DmacDescriptor* copy = d + 1;
+
+    if (write) {
+        d = build_copy(d, c8->state->i, desc_dst_byte(copy, 0), 2);
+        dma_desc_set(copy, btctrl, CHIP8_WINDOW, window, c8->mem, copy + 1);
+    } else {
+        d = build_copy(d, c8->state->i, desc_src_byte(copy, 0), 2);
+        dma_desc_set(copy, btctrl, CHIP8_WINDOW, c8->mem, window, copy + 1);
+    }
+    return copy + 1;
+}
+
+/**
+ * 6 descriptors. Copies V0 - V[*x] to or from the start of 'window', which must start on a
+ * 256-byte boundary, depending on 'store'.
+ */
+static DmacDescriptor* build_copy_regs(DmacDescriptor* d,
+                                       const chip8_engine_t* eng,
+                                       chip8_state_t* st,
+                                       const uint8_t* x,
+                                       uint8_t* window,
+                                       uint8_t* n,
+                                       int store)
+{
+    const uint16_t btctrl = DMAC_BTCTRL_BEATSIZE_BYTE | DMAC_BTCTRL_SRCINC | DMAC_BTCTRL_DSTINC;
+    DmacDescriptor* copy = d + 5;
+
+    // Both ends are x + 1, and so is the count.
+    d = build_lookup(d, eng->inc, x, n);
+    d = build_copy(d, n, (volatile uint8_t*)&copy->BTCNT.reg, 1);
+    d = build_copy(d, n, desc_src_byte(copy, 0), 1);
+    d = build_copy(d, n, desc_dst_byte(copy, 0), 1);
+    if (store) {
+        dma_desc_set(copy, btctrl, 16, st->v, window, copy + 1);
+    } else {
+        dma_desc_set(copy, btctrl, 16, window, st->v, copy + 1);
+    }
+    return copy + 1;
+}
+
+/**
+ * About CHIP8_DESCS descriptors. Runs 'steps' (1 - 255) instructions of the machine 'c8' from
+ * where it is; the state is left so that the chain, or chip8_run(), can carry on from there.
+ *
+ * 'scratch' is CHIP8_SCRATCH bytes that must start on a 256-byte boundary and be private to this
+ * instance; it's filled in here.
+ */
+DmacDescriptor* build_chip8(DmacDescriptor* descs,
+                            const chip8_engine_t* eng,
+                            chip8_t* c8,
+                            uint8_t steps,
+                            uint8_t* scratch)
+{
+    DmacDescriptor** jump = (DmacDescriptor**)&scratch[0];
+    uint8_t* w = &scratch[256];
+    uint8_t* mem_page = &scratch[512];
+
+    chip8_state_t* st = c8->state;
+    const uint8_t* regs = st->v;    // starts on a 256-byte boundary
+    uint8_t* vf = &st->v[15];
+
+    uint8_t* window = &w[0];        // must stay at 0, it's used as a table
+    uint8_t* op = &w[16];
+    uint8_t* x = &w[18];
+    uint8_t* y = &w[19];
+    uint8_t* a = &w[20];            // ALU operands, loaded with Vx and Vy by the decode
+    uint8_t* b = &w[21];
+    uint8_t* r = &w[22];
+    uint8_t* flag = &w[23];
+    uint8_t* digits = &w[24];
+    uint8_t* carry = &digits[DIGITS_PER_BYTE - 1];
+    uint8_t* count = &w[32];
+    uint8_t* nsteps = &w[33];
+    uint8_t* n = &w[34];
+    uint8_t* t = &w[35];
+    uint8_t* page = &w[36];
+    uint8_t* sx = &w[37];
+    uint8_t* rows = &w[38];
+    uint8_t* index = &w[39];
+    uint8_t* lo = &w[40];
+    uint8_t* lo1 = &w[41];
+    uint8_t* left = &w[42];
+    uint8_t* right = &w[43];
+    uint8_t* shr_row = &w[44];
+
+    alu_op = &w[45];
+    alu_rets = (DmacDescriptor**)&w[64];
+    alu_nrets = 0;
+
+    *nsteps = steps;
+    *page = lut_page(c8->mem);
+    for (uint32_t i = 0; i < 256; i++) {
+        mem_page[i] = lut_page(c8->mem) + (i & 0xf);
+    }
+
+    DmacDescriptor* d = descs;
+    DmacDescriptor* entry = d;
+    d = build_copy(d, nsteps, count, 1);
+
+    // The ALU sits out of the way of the main loop: r = a op b, with the raw top digit in *carry.
+    alu_entry = d;
+    for (uint32_t i = 0; i < DIGITS_PER_BYTE; i++) {
+        d = build_digit_op(d, eng->luts, i, a, b, eng->to_alu, (i == 0) ? alu_op : &digits[i - 1],
+                           eng->alu, &digits[i]);
+    }
+    d = build_merge_digits(d, eng->luts, digits, r);
+    alu_exit = d - 1;
+
+    // Loop, fetch and decode.
+    DmacDescriptor* top = d;
+    entry->DESCADDR.reg = (uint32_t)top;
+    d = build_copy(d, &jump[J_LOOP / 4], &jump[J_SLOT / 4], 8);
+    DmacDescriptor* body = build_branch(d, eng->zero, count, jump);
+    d = build_lookup(body, eng->dec, count, count);
+    d = build_next_pc(d, eng, st);
+
+    // The fetch's source address is the end of the opcode, which is the new pc.
+    DmacDescriptor* fetch = d + 1;
+    d = build_copy(d, st->pc, desc_src_byte(fetch, 0), 2);
+    dma_desc_set(fetch, DMAC_BTCTRL_BEATSIZE_BYTE | DMAC_BTCTRL_SRCINC | DMAC_BTCTRL_DSTINC, 2,
+                 c8->mem, op, fetch + 1);
+    d = fetch + 1;
+
+    d = build_lookup(d, eng->lo_nibble, &op[0], x);
+    d = build_lookup(d, eng->hi_nibble, &op[1], y);
+    d = build_lookup(d, regs, x, a);
+    d = build_lookup(d, regs, y, b);
+    d = build_branch(d, eng->dispatch, &op[0], jump);
+
+    // Second level dispatch.
+    jump[(J_MAIN / 4) + 0x0] = d;
+    jump[(J_MAIN / 4) + 0xe] = d;
+    jump[(J_MAIN / 4) + 0xf] = d;
+    d = build_branch(d, eng->misc, &op[1], jump);
+    jump[(J_MAIN / 4) + 0x8] = d;
+    d = build_branch(d, eng->group8, &op[1], jump);
+    jump[J_NOP / 4] = top;
+
+    // Common tails: V[x] = r, and V[x] = r then VF = carry out.
+    DmacDescriptor* store = d;
+    d = build_store(d, st->v, x, r);
+    (d - 1)->DESCADDR.reg = (uint32_t)top;
+
+    DmacDescriptor* store_carry = d;
+    d = build_lookup(d, eng->flag, carry, flag);
+    DmacDescriptor* store_flag = d;
+    d = build_store(d, st->v, x, r);
+    d = build_copy(d, flag, vf, 1);
+    (d - 1)->DESCADDR.reg = (uint32_t)top;
+
+    DmacDescriptor* skip = d;
+    jump[J_SKIP / 4] = d;
+    d = build_next_pc(d, eng, st);
+    (d - 1)->DESCADDR.reg = (uint32_t)top;
+
+    // 00E0 and 00EE.
+    jump[J_CLS / 4] = d;
+    dma_desc_set(d, DMAC_BTCTRL_BEATSIZE_WORD | DMAC_BTCTRL_DSTINC, 64, &chip8_zero_word,
+                 c8->display, top);
+    d++;
+
+    jump[J_RET / 4] = d;
+    DmacDescriptor* pop = d + 1;
+    d = build_copy(d, &st->sp, desc_src_byte(pop, 0), 1);
+    dma_desc_set(pop, DMAC_BTCTRL_BEATSIZE_HWORD, 1, st, st->pc, pop + 1);
+    d = build_lookup(pop + 1, eng->dec, &st->sp, &st->sp);
+    d = build_lookup(d, eng->dec, &st->sp, &st->sp);
+    (d - 1)->DESCADDR.reg = (uint32_t)top;
+
+    // 2NNN pushes pc and carries on into 1NNN.
+    jump[(J_MAIN / 4) + 0x2] = d;
+    DmacDescriptor* push = d + 3;
+    d = build_lookup(d, eng->add2, &st->sp, &st->sp);
+    d = build_copy(d, &st->sp, desc_dst_byte(push, 0), 1);
+    dma_desc_set(push, DMAC_BTCTRL_BEATSIZE_HWORD, 1, st->pc, st, push + 1);
+    d = push + 1;
+
+    jump[(J_MAIN / 4) + 0x1] = d;
+    d = build_copy(d, &op[1], &st->pc[0], 1);
+    d = build_lookup(d, mem_page, &op[0], &st->pc[1]);
+    (d - 1)->DESCADDR.reg = (uint32_t)top;
+
+    // 3XNN, 4XNN, 5XY0 and 9XY0 all compare a with b, then skip on equal or not equal.
+    DmacDescriptor* compare = d;
+    d = build_alu_call(d, &alu_xor, 0);
+    d = build_branch(d, eng->zero, r, jump);
+
+    jump[(J_MAIN / 4) + 0x3] = d;
+    d = build_copy(d, &op[1], b, 1);
+    d = build_copy(d, &jump[J_SE / 4], &jump[J_SLOT / 4], 8);
+    (d - 1)->DESCADDR.reg = (uint32_t)compare;
+
+    jump[(J_MAIN / 4) + 0x4] = d;
+    d = build_copy(d, &op[1], b, 1);
+    d = build_copy(d, &jump[J_SNE / 4], &jump[J_SLOT / 4], 8);
+    (d - 1)->DESCADDR.reg = (uint32_t)compare;
+
+    jump[(J_MAIN / 4) + 0x5] = d;
+    d = build_copy(d, &jump[J_SE / 4], &jump[J_SLOT / 4], 8);
+    (d - 1)->DESCADDR.reg = (uint32_t)compare;
+
+    jump[(J_MAIN / 4) + 0x9] = d;
+    d = build_copy(d, &jump[J_SNE / 4], &jump[J_SLOT / 4], 8);
+    (d - 1)->DESCADDR.reg = (uint32_t)compare;
+
+    // 6XNN and 7XNN.
+    jump[(J_MAIN / 4) + 0x6] = d;
+    d = build_store(d, st->v, x, &op[1]);
+    (d - 1)->DESCADDR.reg = (uint32_t)top;
+
+    jump[(J_MAIN / 4) + 0x7] = d;
+    d = build_copy(d, &op[1], b, 1);
+    d = build_alu_call(d, &alu_add, store);
+
+    // 8XYN. Subtraction is a + ~b + 1, so the carry out is VF = NOT borrow.
+    jump[(J_GROUP8 / 4) + 0x0] = d;
+    d = build_store(d, st->v, x, b);
+    (d - 1)->DESCADDR.reg = (uint32_t)top;
+
+    jump[(J_GROUP8 / 4) + 0x1] = d;
+    d = build_alu_call(d, &alu_or, store);
+    jump[(J_GROUP8 / 4) + 0x2] = d;
+    d = build_alu_call(d, &alu_and, store);
+    jump[(J_GROUP8 / 4) + 0x3] = d;
+    d = build_alu_call(d, &alu_xor, store);
+    jump[(J_GROUP8 / 4) + 0x4] = d;
+    d = build_alu_call(d, &alu_add, store_carry);
+
+    jump[(J_GROUP8 / 4) + 0x5] = d;
+    d = build_copy(d, a, t, 1);
+    d = build_copy(d, b, a, 1);
+    d = build_copy(d, &chip8_ff, b, 1);
+    d = build_alu_call(d, &alu_xor, 0);
+    d = build_copy(d, r, b, 1);
+    d = build_copy(d, t, a, 1);
+    d = build_alu_call(d, &alu_addc, store_carry);
+
+    jump[(J_GROUP8 / 4) + 0x7] = d;
+    d = build_copy(d, b, t, 1);
+    d = build_copy(d, &chip8_ff, b, 1);
+    d = build_alu_call(d, &alu_xor, 0);
+    d = build_copy(d, r, a, 1);
+    d = build_copy(d, t, b, 1);
+    d = build_alu_call(d, &alu_addc, store_carry);
+
+    jump[(J_GROUP8 / 4) + 0x6] = d;
+    d = build_copy(d, &chip8_one, b, 1);
+    d = build_alu_call(d, &alu_and, 0);
+    d = build_copy(d, r, flag, 1);
+    d = build_lookup(d, eng->shr, a, r);
+    (d - 1)->DESCADDR.reg = (uint32_t)store_flag;
+
+    jump[(J_GROUP8 / 4) + 0x8] = d;
+    d = build_copy(d, a, b, 1);
+    d = build_alu_call(d, &alu_add, store_carry);
+
+    // ANNN and BNNN: the low byte goes through the ALU, the carry into mem_page[N].
+    jump[(J_MAIN / 4) + 0xa] = d;
+    d = build_copy(d, &op[1], a, 1);
+    d = build_copy(d, &chip8_window, b, 1);
+    d = build_alu_call(d, &alu_add, 0);
+    d = build_lookup(d, mem_page, &op[0], &st->i[1]);
+    d = build_carry(d, eng, eng->carry_row, carry, &st->i[1], &st->i[1]);
+    d = build_copy(d, r, &st->i[0], 1);
+    (d - 1)->DESCADDR.reg = (uint32_t)top;
+
+    jump[(J_MAIN / 4) + 0xb] = d;
+    d = build_copy(d, &op[1], a, 1);
+    d = build_copy(d, &regs[0], b, 1);
+    d = build_alu_call(d, &alu_add, 0);
+    d = build_lookup(d, mem_page, &op[0], &st->pc[1]);
+    d = build_carry(d, eng, eng->carry_row, carry, &st->pc[1], &st->pc[1]);
+    d = build_copy(d, r, &st->pc[0], 1);
+    (d - 1)->DESCADDR.reg = (uint32_t)top;
+
+    // CXNN.
+    jump[(J_MAIN / 4) + 0xc] = d;
+    d = build_lookup(d, eng->lfsr, &st->rng, &st->rng);
+    d = build_copy(d, &st->rng, a, 1);
+    d = build_copy(d, &op[1], b, 1);
+    d = build_alu_call(d, &alu_and, store);
+
+    // FXNN.
+    jump[J_FX07 / 4] = d;
+    d = build_store(d, st->v, x, &st->dt);
+    (d - 1)->DESCADDR.reg = (uint32_t)top;
+
+    jump[J_FX15 / 4] = d;
+    d = build_copy(d, a, &st->dt, 1);
+    (d - 1)->DESCADDR.reg = (uint32_t)top;
+
+    jump[J_FX18 / 4] = d;
+    d = build_copy(d, a, &st->st, 1);
+    (d - 1)->DESCADDR.reg = (uint32_t)top;
+
+    jump[J_FX1E / 4] = d;
+    d = build_copy(d, &st->i[0], b, 1);
+    d = build_alu_call(d, &alu_add, 0);
+    d = build_carry(d, eng, eng->carry_row, carry, &st->i[1], &st->i[1]);
+    d = build_copy(d, r, &st->i[0], 1);
+    (d - 1)->DESCADDR.reg = (uint32_t)top;
+
+    jump[J_FX29 / 4] = d;
+    d = build_lookup(d, eng->font, a, &st->i[0]);
+    d = build_copy(d, page, &st->i[1], 1);
+    (d - 1)->DESCADDR.reg = (uint32_t)top;
+
+    jump[J_FX33 / 4] = d;
+    d = build_window(d, c8, window, 0);
+    d = build_lookup(d, eng->hundreds, a, &window[0]);
+    d = build_lookup(d, eng->tens_ones, a, t);
+    d = build_lookup(d, eng->hi_nibble, t, &window[1]);
+    d = build_lookup(d, eng->lo_nibble, t, &window[2]);
+    d = build_window(d, c8, window, 1);
+    (d - 1)->DESCADDR.reg = (uint32_t)top;
+
+    jump[J_FX55 / 4] = d;
+    d = build_window(d, c8, window, 0);
+    d = build_copy_regs(d, eng, st, x, window, n, 1);
+    d = build_window(d, c8, window, 1);
+    (d - 1)->DESCADDR.reg = (uint32_t)top;
+
+    jump[J_FX65 / 4] = d;
+    d = build_window(d, c8, window, 0);
+    d = build_copy_regs(d, eng, st, x, window, n, 0);
+    (d - 1)->DESCADDR.reg = (uint32_t)top;
+
+    // DXYN: set up, then a row at a time while 'rows' counts down.
+    jump[(J_MAIN / 4) + 0xd] = d;
+    d = build_window(d, c8, window, 0);
+    d = build_copy(d, &chip8_zero, vf, 1);
+    d = build_copy(d, a, sx, 1);
+    d = build_lookup(d, eng->lo_nibble, &op[1], rows);
+    d = build_copy(d, &chip8_zero, index, 1);
+    d = build_lookup(d, eng->row, b, b);
+    d = build_lookup(d, eng->column, a, a);
+    d = build_alu_call(d, &alu_add, 0);
+    d = build_copy(d, r, lo, 1);
+
+    DmacDescriptor* row_top = d;
+    d = build_copy(d, &jump[J_ROW / 4], &jump[J_SLOT / 4], 8);
+    DmacDescriptor* row_body = build_branch(d, eng->zero, rows, jump);
+    d = build_lookup(row_body, eng->dec, rows, rows);
+    d = build_lookup(d, window, index, left);
+    d = build_copy(d, &chip8_zero, right, 1);
+    d = build_lookup(d, eng->inc, index, index);
+    d = build_branch(d, eng->shift, sx, jump);
+
+    // Entering at step 7 - k shifts (left, right) right by k.
+    for (uint32_t k = 7; k > 0; k--) {
+        jump[(J_SHIFT / 4) + k] = d;
+        d = build_lookup(d, eng->to_shr, left, shr_row);
+        d = build_lookup2(d, eng->shr, shr_row, right, right);
+        d = build_lookup(d, eng->shr, left, left);
+    }
+    jump[J_SHIFT / 4] = d;
+
+    // Left byte: collide, then XOR.
+    d = build_lookup(d, c8->display, lo, a);
+    d = build_copy(d, left, b, 1);
+    d = build_alu_call(d, &alu_and, 0);
+    d = build_copy(d, &jump[J_COLL0 / 4], &jump[J_SLOT / 4], 8);
+    d = build_branch(d, eng->zero, r, jump);
+    jump[J_COLL0 / 4] = d;
+    d = build_copy(d, &chip8_one, vf, 1);
+    jump[(J_COLL0 / 4) + 1] = d;
+    d = build_alu_call(d, &alu_xor, 0);
+    d = build_store(d, c8->display, lo, r);
+
+    // Right byte, which wraps around to the start of the row.
+    d = build_lookup(d, eng->next_byte, lo, lo1);
+    d = build_lookup(d, c8->display, lo1, a);
+    d = build_copy(d, right, b, 1);
+    d = build_alu_call(d, &alu_and, 0);
+    d = build_copy(d, &jump[J_COLL1 / 4], &jump[J_SLOT / 4], 8);
+    d = build_branch(d, eng->zero, r, jump);
+    jump[J_COLL1 / 4] = d;
+    d = build_copy(d, &chip8_one, vf, 1);
+    jump[(J_COLL1 / 4) + 1] = d;
+    d = build_alu_call(d, &alu_xor, 0);
+    d = build_store(d, c8->display, lo1, r);
+
+    d = build_lookup(d, eng->add8, lo, lo);
+    (d - 1)->DESCADDR.reg = (uint32_t)row_top;
+    jump[J_ROW / 4] = row_body;
+    jump[(J_ROW / 4) + 1] = top;
+
+    jump[J_SE / 4] = top;
+    jump[(J_SE / 4) + 1] = skip;
+    jump[J_SNE / 4] = skip;
+    jump[(J_SNE / 4) + 1] = top;
+
+    jump[J_LOOP / 4] = body;
+    jump[(J_LOOP / 4) + 1] = d;
+    return build_nop(d);
+}
@@ -0,0 +1,95 @@
+#ifndef _CHIP8_H
+#define _CHIP8_H
+
+#include <stdint.h>
+#include "dma.h"
+#include "dmainstrs.h"
+
+/**
+ * CHIP-8 has 4KiB of memory with programs loaded at 0x200, sixteen byte registers V0 - VF, a
+ * 12-bit index register I, a 16-level call stack and a 64x32 monochrome display. See chip8.c for
+ * what is and isn't implemented.
+ */
+#define CHIP8_MEM_SIZE   4096
+#define CHIP8_PROG_START 0x200
+#define CHIP8_WINDOW     16      // bytes read at I by the load / store / draw instructions
+
+/**
+ * Machine state, laid out for the descriptors. Addresses (pc, I and the stack entries) are kept
+ * as the low two bytes of their SRAM address, low byte first, and I is kept as I + CHIP8_WINDOW.
+ * Must start on a 256-byte boundary.
+ */
+typedef struct chip8_state {
+    uint8_t v[16];
+    uint8_t unused[16];
+    uint8_t stack[32];    // the entry at offset sp - 32 is the top
+    uint8_t pc[2];        // next instruction
+    uint8_t i[2];         // I + CHIP8_WINDOW
+    uint8_t sp;           // offset of the top stack entry in this struct; 30 when empty
+    uint8_t dt;           // delay timer
+    uint8_t st;           // sound timer
+    uint8_t rng;          // LFSR state for CXNN, never 0
+} chip8_state_t;
+
+/**
+ * A CHIP-8 machine. The display is 32 rows of 8 bytes, bit 7 of byte 0 being the top left pixel.
+ */
+typedef struct chip8 {
+    uint8_t* mem;             // 256-byte aligned
+    uint32_t mem_size;        // at most CHIP8_MEM_SIZE
+    uint8_t* display;         // 256 bytes, 256-byte aligned
+    chip8_state_t* state;     // 256-byte aligned
+} chip8_t;
+
+/**
+ * Tables for build_chip8(); they don't depend on the machine.
+ */
+typedef struct chip8_engine {
+    const digit_luts_t* luts;
+    const uint8_t* alu;         // 5x256, [op][a:b] digit ops with the op number above the carry
+    const uint8_t* to_alu;      // digit result -> page of alu for the next digit of the same op
+    const uint8_t* ident;       // setup_add_const(0); the page after it is inc
+    const uint8_t* inc;         // setup_add_const(1)
+    const uint8_t* dec;         // setup_decrement()
+    const uint8_t* add2;        // setup_add_const(2)
+    const uint8_t* carry2;      // v -> page of inc if v + 2 carries, else of ident
+    const uint8_t* carry_row;   // ALU top digit -> page of inc if it carried, else of ident
+    const uint8_t* flag;        // ALU top digit -> carry out, 0 or 1
+    const uint8_t* dispatch;    // first opcode byte -> offset of its handler in the jump page
+    const uint8_t* group8;      // second opcode byte -> offset of its 8XYN handler
+    const uint8_t* misc;        // second opcode byte -> offset of its 0NNN / EXNN / FXNN handler
+    const uint8_t* zero;        // v -> offset of the nonzero or zero target
+    const uint8_t* lo_nibble;
+    const uint8_t* hi_nibble;
+    const uint8_t* shr;         // 2x256, [b][v] -> (v >> 1) | (b << 7); row 0 is a plain shift
+    const uint8_t* to_shr;      // v -> page of shr for v & 1
+    const uint8_t* shift;       // x -> offset of the entry into the sprite shift for x & 7
+    const uint8_t* row;         // y -> offset of display row y & 31
+    const uint8_t* column;      // x -> byte of x & 63 within its display row
+    const uint8_t* next_byte;   // display offset -> offset of the next byte in the row, wrapping
+    const uint8_t* add8;        // setup_add_const(8), the next display row
+    const uint8_t* lfsr;
+    const uint8_t* font;        // v -> low byte of the font sprite for digit v & 15, + 16
+    const uint8_t* hundreds;    // v -> v / 100
+    const uint8_t* tens_ones;   // v -> ((v / 10) % 10) << 4 | (v % 10)
+} chip8_engine_t;
+
+#define CHIP8_ENGINE_SIZE (31 * 256)
+#define CHIP8_SCRATCH     (3 * 256)
+#define CHIP8_DESCS       (310 + (8 * DIGITS_PER_BYTE) + (4 * (DIGITS_PER_BYTE - 1)))
+
+void setup_chip8_engine(chip8_engine_t* eng, const digit_luts_t* luts, uint8_t* mem);
+void chip8_init(chip8_t* c8,
+                uint8_t* mem,
+                uint32_t mem_size,
+                uint8_t* display,
+                chip8_state_t* state);
+int chip8_load(chip8_t* c8, const uint8_t* prog, uint32_t len);
+void chip8_run(chip8_t* c8, uint32_t steps);
+DmacDescriptor* build_chip8(DmacDescriptor* descs,
+                            const chip8_engine_t* eng,
+                            chip8_t* c8,
+                            uint8_t steps,
+                            uint8_t* scratch);
+
+#endif
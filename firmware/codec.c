@@ -0,0 +1,332 @@
+/**
+ * Hex and base64 encoding and decoding.
+ *
+ * Every output byte is one lookup, or two when it depends on two input bytes: the first lookup
+ * turns one input byte into the page of a 2D table and the second indexes that page with the
+ * other. The lookups are laid out in evenly spaced blocks so that input bytes can be copied into
+ * them by a couple of stepped descriptors per pass instead of one per byte; see codec_t.
+ *
+ * Bit-field extraction and the character map are baked into the same table. Hex encoding, for
+ * instance, is setup_high_nybble_to_low_nybble() and setup_low_nybble_to_low_nybble() with every
+ * entry run through the digit map.
+ *
+ * Decoders don't check their input. Characters outside the alphabet decode as if they were 0, and
+ * so does base64's '=' padding; the caller knows from the padding how many of the decoded bytes
+ * to keep.
+ */
+
+#include "codec.h"
+#include "dmainstrs.h"
+
+static const char hex_digits[16] = "0123456789abcdef";
+static const char base64_alphabet[64] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const uint8_t pad_chars[3] = { '=', '=', '=' };
+
+static uint8_t hex_value(uint32_t c)
+{
+    if ((c >= '0') && (c <= '9')) return c - '0';
+    if ((c >= 'a') && (c <= 'f')) return c - 'a' + 10;
+    if ((c >= 'A') && (c <= 'F')) return c - 'A' + 10;
+    return 0;
+}
+
+static uint8_t base64_value(uint32_t c)
+{
+    if ((c >= 'A') && (c <= 'Z')) return c - 'A';
+    if ((c >= 'a') && (c <= 'z')) return c - 'a' + 26;
+    if ((c >= '0') && (c <= '9')) return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return 0;
+}
+
+static void set_slot(codec_t* codec, uint32_t i, const uint8_t* table, int8_t out, uint8_t slot)
+{
+    codec->slots[i].table = table;
+    codec->slots[i].out = out;
+    codec->slots[i].slot = slot;
+}
+
+/**
+ * One byte in, two lowercase hex digits out. 'mem' is HEX_ENCODER_SIZE bytes, 256-byte aligned.
+ */
+void setup_hex_encoder(codec_t* codec, uint8_t* mem)
+{
+    uint8_t* hi = &mem[0 * 256];
+    uint8_t* lo = &mem[1 * 256];
+
+    setup_high_nybble_to_low_nybble(hi);
+    setup_low_nybble_to_low_nybble(lo);
+    for (uint32_t count = 0; count < 256; count++) {
+        hi[count] = hex_digits[hi[count]];
+        lo[count] = hex_digits[lo[count]];
+    }
+
+    codec->in_bytes = 1;
+    codec->out_bytes = 2;
+    codec->nslots = 2;
+    codec->nscatters = 2;
+    codec->scatter[0] = 0;
+    codec->scatter[1] = 1;
+    codec->pad = 0;
+    set_slot(codec, 0, hi, 0, 0);
+    set_slot(codec, 1, lo, 1, 0);
+}
+
+/**
+ * Two hex digits (either case) in, one byte out. 'mem' is HEX_DECODER_SIZE bytes, 256-byte
+ * aligned.
+ */
+void setup_hex_decoder(codec_t* codec, uint8_t* mem)
+{
+    uint8_t* page = &mem[0];         // first digit -> page of 'merge'
+    uint8_t* merge = &mem[256];      // [first digit][second digit char] -> byte
+
+    for (uint32_t count = 0; count < 256; count++) {
+        page[count] = lut_page(merge) + hex_value(count);
+        for (uint32_t row = 0; row < 16; row++) {
+            merge[(row * 256) + count] = (row << 4) | hex_value(count);
+        }
+    }
+
+    codec->in_bytes = 2;
+    codec->out_bytes = 1;
+    codec->nslots = 2;
+    codec->nscatters = 1;
+    codec->scatter[0] = 0;
+    codec->pad = 0;
+    set_slot(codec, 0, page, CODEC_SLOT_PAGE, 1);
+    set_slot(codec, 1, merge, 0, 0);
+}
+
+/**
+ * Three bytes in, four base64 characters out, with the last group padded with '='. 'mem' is
+ * BASE64_ENCODER_SIZE bytes, 256-byte aligned.
+ */
+void setup_base64_encoder(codec_t* codec, uint8_t* mem)
+{
+    uint8_t* c0 = &mem[0 * 256];       // b0 -> char of b0[7:2]
+    uint8_t* page1 = &mem[1 * 256];    // b0 -> page of c1 for b0[1:0]
+    uint8_t* page2 = &mem[2 * 256];    // b1 -> page of c2 for b1[3:0]
+    uint8_t* c3 = &mem[3 * 256];       // b2 -> char of b2[5:0]
+    uint8_t* c1 = &mem[4 * 256];       // [b0[1:0]][b1] -> char of b0[1:0]:b1[7:4]
+    uint8_t* c2 = &mem[8 * 256];       // [b1[3:0]][b2] -> char of b1[3:0]:b2[7:6]
+
+    for (uint32_t count = 0; count < 256; count++) {
+        c0[count] = base64_alphabet[count >> 2];
+        page1[count] = lut_page(c1) + (count & 0x03);
+        page2[count] = lut_page(c2) + (count & 0x0f);
+        c3[count] = base64_alphabet[count & 0x3f];
+        for (uint32_t row = 0; row < 4; row++) {
+            c1[(row * 256) + count] = base64_alphabet[(row << 4) | (count >> 4)];
+        }
+        for (uint32_t row = 0; row < 16; row++) {
+            c2[(row * 256) + count] = base64_alphabet[(row << 2) | (count >> 6)];
+        }
+    }
+
+    codec->in_bytes = 3;
+    codec->out_bytes = 4;
+    codec->nslots = 6;
+    codec->nscatters = 2;
+    codec->scatter[0] = 0;
+    codec->scatter[1] = 1;
+    codec->pad = 1;
+    set_slot(codec, 0, c0, 0, 0);
+    set_slot(codec, 1, page1, CODEC_SLOT_PAGE, 2);
+    set_slot(codec, 2, c1, 1, 0);
+    set_slot(codec, 3, page2, CODEC_SLOT_PAGE, 4);
+    set_slot(codec, 4, c2, 2, 0);
+    set_slot(codec, 5, c3, 3, 0);
+}
+
+/**
+ * Four base64 characters in, three bytes out. 'mem' is BASE64_DECODER_SIZE bytes, 256-byte
+ * aligned.
+ *
+ * b0 is indexed by c0 but gets its page from c1, so c1 has to land in an earlier slot than c0. With
+ * 2 slots per character, the first scatter puts character k in slot 2k and the second one in slot
+ * 2k + 3, which gives the order below and leaves 2 slots that are only there for the spacing.
+ */
+void setup_base64_decoder(codec_t* codec, uint8_t* mem)
+{
+    uint8_t* page0 = &mem[0 * 256];    // c1 -> page of b0 for v1[5:4]
+    uint8_t* page1 = &mem[1 * 256];    // c1 -> page of b1 for v1[3:0]
+    uint8_t* page2 = &mem[2 * 256];    // c2 -> page of b2 for v2[1:0]
+    uint8_t* b0 = &mem[3 * 256];       // [v1[5:4]][c0] -> v0:v1[5:4]
+    uint8_t* b2 = &mem[7 * 256];       // [v2[1:0]][c3] -> v2[1:0]:v3
+    uint8_t* b1 = &mem[11 * 256];      // [v1[3:0]][c2] -> v1[3:0]:v2[5:2]
+
+    for (uint32_t count = 0; count < 256; count++) {
+        const uint8_t v = base64_value(count);
+        page0[count] = lut_page(b0) + (v >> 4);
+        page1[count] = lut_page(b1) + (v & 0x0f);
+        page2[count] = lut_page(b2) + (v & 0x03);
+        for (uint32_t row = 0; row < 4; row++) {
+            b0[(row * 256) + count] = (v << 2) | row;
+            b2[(row * 256) + count] = (row << 6) | v;
+        }
+        for (uint32_t row = 0; row < 16; row++) {
+            b1[(row * 256) + count] = (row << 4) | (v >> 2);
+        }
+    }
+
+    codec->in_bytes = 4;
+    codec->out_bytes = 3;
+    codec->nslots = 8;
+    codec->nscatters = 2;
+    codec->scatter[0] = 0;
+    codec->scatter[1] = 3;
+    codec->pad = 0;
+    set_slot(codec, 0, page0, CODEC_SLOT_DISCARD, 0);    // c0
+    set_slot(codec, 1, page0, CODEC_SLOT_DISCARD, 0);    // c3 of the group before
+    set_slot(codec, 2, page0, CODEC_SLOT_PAGE, 3);       // c1
+    set_slot(codec, 3, b0, 0, 0);                        // c0
+    set_slot(codec, 4, page2, CODEC_SLOT_PAGE, 6);       // c2
+    set_slot(codec, 5, page1, CODEC_SLOT_PAGE, 7);       // c1
+    set_slot(codec, 6, b2, 2, 0);                        // c3
+    set_slot(codec, 7, b1, 1, 0);                        // c2
+}
+
+/**
+ * Encodes or decodes ngroups groups from 'in' to 'out': the scatters, then the slots of every
+ * group, then however many spare slots the scatters run into past the last group.
+ */
+static DmacDescriptor* build_codec_groups(DmacDescriptor* descs,
+                                          const codec_t* codec,
+                                          const volatile uint8_t* in,
+                                          uint32_t ngroups,
+                                          volatile uint8_t* out,
+                                          volatile uint8_t* discard)
+{
+    const uint32_t per_byte = codec->nslots / codec->in_bytes;
+    const uint16_t stepsize = (per_byte == 1) ? DMAC_BTCTRL_STEPSIZE_X16 : DMAC_BTCTRL_STEPSIZE_X32;
+
+    // The last input byte goes to slot scatter[i] + (per_byte * (ngroups * in_bytes - 1)).
+    uint32_t spare = 0;
+    for (uint32_t i = 0; i < codec->nscatters; i++) {
+        const uint32_t past = codec->scatter[i] + 1;
+        if (past > (per_byte + spare)) { spare = past - per_byte; }
+    }
+
+    DmacDescriptor* d = descs;
+    DmacDescriptor* slots = descs + codec->nscatters;
+    for (uint32_t i = 0; i < codec->nscatters; i++) {
+        dma_desc_set(d, (stepsize |
+                         DMAC_BTCTRL_STEPSEL_DST |
+                         DMAC_BTCTRL_DSTINC |
+                         DMAC_BTCTRL_SRCINC |
+                         DMAC_BTCTRL_BEATSIZE_BYTE),
+                     ngroups * codec->in_bytes, in, desc_src_byte(&slots[codec->scatter[i]], 0),
+                     d + 1);
+        d++;
+    }
+
+    for (uint32_t g = 0; g < ngroups; g++) {
+        DmacDescriptor* group = &slots[g * codec->nslots];
+        for (uint32_t i = 0; i < codec->nslots; i++) {
+            const codec_slot_t* slot = &codec->slots[i];
+            volatile uint8_t* dst = discard;
+            if (slot->out >= 0) {
+                dst = &out[(g * codec->out_bytes) + slot->out];
+            } else if (slot->out == CODEC_SLOT_PAGE) {
+                dst = desc_src_byte(&group[slot->slot], 1);
+            }
+            dma_desc_set(d, DMAC_BTCTRL_BEATSIZE_BYTE, 1, slot->table, dst, d + 1);
+            d++;
+        }
+    }
+
+    for (uint32_t i = 0; i < spare; i++) {
+        dma_desc_set(d, DMAC_BTCTRL_BEATSIZE_BYTE, 1, codec->slots[0].table, discard, d + 1);
+        d++;
+    }
+    return d;
+}
+
+/**
+ * At most CODEC_DESCS(unroll) descriptors. Encodes or decodes the n bytes at 'in' into 'out',
+ * which gets as many bytes as the matching _ENCODED_LEN or _DECODED_LEN macro says. 'out' can be
+ * anything a byte can be written to, like the buffer that a UART's TX channel sends from.
+ *
+ * 'unroll' groups (at most CODEC_MAX_UNROLL) are done per loop pass, which costs up to 18
+ * descriptors on top of the lookups; whatever is left over is done after the loop. For decoders, n
+ * has to be a multiple of the group size. There must be fewer than 256 passes, and neither buffer
+ * may cross a 64KiB boundary.
+ *
+ * 'scratch' is CODEC_SCRATCH bytes that must start on a 256-byte boundary and be private to this
+ * instance. It's filled in here.
+ */
+DmacDescriptor* build_codec(DmacDescriptor* descs,
+                            const codec_t* codec,
+                            const volatile uint8_t* in,
+                            uint32_t n,
+                            volatile uint8_t* out,
+                            uint32_t unroll,
+                            uint8_t* scratch)
+{
+    const uint32_t ngroups = n / codec->in_bytes;
+    const uint32_t npasses = ngroups / unroll;
+    const uint32_t rest = ngroups % unroll;
+    const uint32_t partial = codec->pad ? (n % codec->in_bytes) : 0;
+    const uint32_t in_block = unroll * codec->in_bytes;
+    const uint32_t out_block = unroll * codec->out_bytes;
+
+    // targets has to be at the start of a page, since the branch table isn't biased.
+    DmacDescriptor** targets = (DmacDescriptor**)&scratch[0];
+    uint8_t* count = &scratch[8];
+    uint8_t* passes = &scratch[9];
+    uint8_t* discard = &scratch[10];
+    uint8_t* last = &scratch[12];
+    uint8_t* in_stage = &scratch[32];
+    uint8_t* out_stage = &scratch[128];
+    uint8_t* in_lo = &scratch[1 * 256];
+    uint8_t* in_hi = &scratch[2 * 256];
+    uint8_t* out_lo = &scratch[3 * 256];
+    uint8_t* out_hi = &scratch[4 * 256];
+    uint8_t* dec = &scratch[5 * 256];
+    uint8_t* branch = &scratch[6 * 256];
+
+    DmacDescriptor* d = descs;
+
+    if (npasses > 0) {
+        // Pass p does block p; the counter runs from npasses down to 1, and both the input and the
+        // output copy want the address just past their block.
+        *passes = npasses;
+        setup_index_to_addr(in_lo, in_hi, in, -(int32_t)in_block, (npasses + 1) * in_block);
+        setup_index_to_addr(out_lo, out_hi, out, -(int32_t)out_block, (npasses + 1) * out_block);
+        setup_decrement(dec);
+        setup_branch_if_zero(branch);
+
+        d = build_copy(d, passes, count, 1);
+        DmacDescriptor* body = d;
+        d = build_indexed_copy(d, in, in_lo, in_hi, count, in_stage, in_block);
+        d = build_codec_groups(d, codec, in_stage, unroll, out_stage, discard);
+        d = build_indexed_store(d, out, out_lo, out_hi, count, out_stage, out_block);
+        d = build_lookup(d, dec, count, count);
+
+        DmacDescriptor* exit = build_branch(d, branch, count, targets);
+        targets[0] = body;
+        targets[1] = exit;
+
+        // The branch's last descriptor isn't linked, so something has to follow the loop.
+        d = ((rest > 0) || (partial > 0)) ? exit : build_nop(exit);
+    }
+
+    if (rest > 0) {
+        d = build_codec_groups(d, codec, &in[npasses * in_block], rest, &out[npasses * out_block],
+                               discard);
+    }
+
+    // A short last group is encoded from a copy with zeros after the input, and the characters
+    // that only hold those zeros are then overwritten with padding.
+    if (partial > 0) {
+        volatile uint8_t* tail = &out[ngroups * codec->out_bytes];
+        for (uint32_t i = 0; i < codec->in_bytes; i++) { last[i] = 0; }
+        d = build_copy(d, &in[n - partial], last, partial);
+        d = build_codec_groups(d, codec, last, 1, tail, discard);
+        d = build_copy(d, pad_chars, &tail[partial + 1], codec->out_bytes - partial - 1);
+    }
+    return d;
+}
@@ -0,0 +1,69 @@
+#ifndef _CODEC_H
+#define _CODEC_H
+
+#include <stdint.h>
+#include "dma.h"
+
+#define CODEC_MAX_SLOTS 8
+
+// Values of codec_slot_t.out that aren't output bytes.
+#define CODEC_SLOT_PAGE    (-1)    // picks the table page of another slot of the group
+#define CODEC_SLOT_DISCARD (-2)    // only there to keep the slots evenly spaced
+
+/**
+ * One lookup descriptor of a group: table[input byte] goes to 'out'.
+ */
+typedef struct codec_slot {
+    const uint8_t* table;
+    int8_t out;      // byte of the group's output, or one of the CODEC_SLOT_ values
+    uint8_t slot;    // for CODEC_SLOT_PAGE, the slot whose table page this one writes
+} codec_slot_t;
+
+/**
+ * A text encoding, done a group of input bytes at a time; see build_codec().
+ *
+ * Every input byte is copied into the low source address byte of one or two slots by "scatters":
+ * descriptors that step their destination by 16 or 32 bytes, so that each input byte lands in the
+ * same place of its own 1- or 2-descriptor block. Scatter i copies byte 0 of a group into slot
+ * scatter[i] and each later input byte into the slot nslots / in_bytes further along, even if that
+ * goes past the end of the group. Slots run in order, so a slot that picks another slot's page has
+ * to come first.
+ */
+typedef struct codec {
+    uint8_t in_bytes;      // input bytes per group
+    uint8_t out_bytes;     // output bytes per group
+    uint8_t nslots;        // 1 or 2 per input byte
+    uint8_t nscatters;
+    uint8_t scatter[2];
+    uint8_t pad;           // 1 if a short last group is padded out with '='
+    codec_slot_t slots[CODEC_MAX_SLOTS];
+} codec_t;
+
+#define HEX_ENCODER_SIZE    (2 * 256)
+#define HEX_DECODER_SIZE    (17 * 256)
+#define BASE64_ENCODER_SIZE (24 * 256)
+#define BASE64_DECODER_SIZE (27 * 256)
+
+#define HEX_ENCODED_LEN(n)    (2 * (n))
+#define HEX_DECODED_LEN(n)    ((n) / 2)
+#define BASE64_ENCODED_LEN(n) (4 * (((n) + 2) / 3))
+#define BASE64_DECODED_LEN(n) (3 * ((n) / 4))
+
+#define CODEC_MAX_UNROLL 24
+#define CODEC_SCRATCH    (7 * 256)
+#define CODEC_DESCS(unroll) (32 + (16 * (unroll)))
+
+void setup_hex_encoder(codec_t* codec, uint8_t* mem);
+void setup_hex_decoder(codec_t* codec, uint8_t* mem);
+void setup_base64_encoder(codec_t* codec, uint8_t* mem);
+void setup_base64_decoder(codec_t* codec, uint8_t* mem);
+
+DmacDescriptor* build_codec(DmacDescriptor* descs,
+                            const codec_t* codec,
+                            const volatile uint8_t* in,
+                            uint32_t n,
+                            volatile uint8_t* out,
+                            uint32_t unroll,
+                            uint8_t* scratch);
+
+#endif
@@ -0,0 +1,466 @@
+/**
+ * Regex -> DFA compiler, and a descriptor loop that runs a DFA over a buffer.
+ *
+ * One DFA step is next = table[state][byte], i.e. a 2D lookup where the byte patches byte 0 of a
+ * descriptor's SRCADDR and the state (a page number) patches byte 1. The loop in build_dfa_run()
+ * keeps the state inside the descriptors themselves: every step writes its result straight into
+ * byte 1 of the next step.
+ *
+ * Supported regex syntax:
+ *     c          literal byte
+ *     .          any byte
+ *     [abc]      byte class; ranges (a-z) and negation ([^...]) are allowed
+ *     \d \w \s   digit, word and whitespace classes
+ *     \n \r \t   control characters; \ before anything else makes it literal
+ *     ( ) |      grouping and alternation
+ *     * + ?      repetition
+ *
+ * Compilation runs on the CPU: the regex becomes a Thompson NFA of at most DFA_MAX_NFA_NODES
+ * nodes, which is turned into a DFA by subset construction. The DFA is not minimized.
+ */
+
+#include "dfa.h"
+#include "dmainstrs.h"
+
+#define DFA_MAX_NFA_NODES 64
+#define DFA_MAX_SETS      24
+#define DFA_MAX_STATES    64
+
+#define NFA_EPSILON 0xff
+#define NFA_NONE    0xff
+
+typedef struct nfa_node {
+    uint8_t set;       // index into sets[], or NFA_EPSILON
+    uint8_t out[2];    // following nodes, or NFA_NONE
+} nfa_node_t;
+
+// A piece of NFA under construction. 'end' is always an epsilon node with nothing after it yet.
+typedef struct nfa_frag {
+    uint8_t start;
+    uint8_t end;
+} nfa_frag_t;
+
+static nfa_node_t nodes[DFA_MAX_NFA_NODES];
+static uint8_t sets[DFA_MAX_SETS][32];
+static uint64_t dstates[DFA_MAX_STATES];
+static uint32_t nnodes, nsets;
+static const char* pos;
+static int error;
+
+////////////////////////////////////////////////////////////////////////////////
+// Parser
+
+static uint8_t new_node(uint8_t set)
+{
+    if (nnodes >= DFA_MAX_NFA_NODES) {
+        error = DFA_ERR_TOO_BIG;
+        return 0;
+    }
+    nodes[nnodes].set = set;
+    nodes[nnodes].out[0] = NFA_NONE;
+    nodes[nnodes].out[1] = NFA_NONE;
+    return nnodes++;
+}
+
+static void link_node(uint8_t from, uint8_t to)
+{
+    if (nodes[from].out[0] == NFA_NONE) nodes[from].out[0] = to; else nodes[from].out[1] = to;
+}
+
+static uint8_t new_set(void)
+{
+    if (nsets >= DFA_MAX_SETS) {
+        error = DFA_ERR_TOO_BIG;
+        return 0;
+    }
+    for (uint32_t i = 0; i < 32; i++) { sets[nsets][i] = 0; }
+    return nsets++;
+}
+
+static void set_add_range(uint8_t set, uint32_t lo, uint32_t hi)
+{
+    for (uint32_t c = lo; c <= hi; c++) { sets[set][c >> 3] |= (1 << (c & 7)); }
+}
+
+/**
+ * Adds the byte(s) named by the escape sequence that starts after the '\' at pos. Returns the
+ * byte itself if it's a single byte, or -1 if it's a class.
+ */
+static int32_t parse_escape(uint8_t set)
+{
+    const char c = *pos++;
+    switch (c) {
+        case 'd': set_add_range(set, '0', '9'); return -1;
+        case 'w':
+            set_add_range(set, '0', '9');
+            set_add_range(set, 'a', 'z');
+            set_add_range(set, 'A', 'Z');
+            set_add_range(set, '_', '_');
+            return -1;
+        case 's':
+            set_add_range(set, ' ', ' ');
+            set_add_range(set, '\t', '\r');
+            return -1;
+        case 'n': set_add_range(set, '\n', '\n'); return '\n';
+        case 'r': set_add_range(set, '\r', '\r'); return '\r';
+        case 't': set_add_range(set, '\t', '\t'); return '\t';
+        case '\0': error = DFA_ERR_SYNTAX; pos--; return -1;
+        default: set_add_range(set, (uint8_t)c, (uint8_t)c); return (uint8_t)c;
+    }
+}
+
+static void parse_class(uint8_t set)
+{
+    const int negate = (*pos == '^');
+    if (negate) pos++;
+
+    // A ']' right at the start is a member, not the end of the class.
+    int first = 1;
+    while ((*pos != ']') || first) {
+        int32_t lo;
+        first = 0;
+        if (*pos == '\0') { error = DFA_ERR_SYNTAX; return; }
+        if (*pos == '\\') {
+            pos++;
+            lo = parse_escape(set);
+        } else {
+            lo = (uint8_t)*pos++;
+            set_add_range(set, lo, lo);
+        }
+
+        if ((lo >= 0) && (pos[0] == '-') && (pos[1] != ']') && (pos[1] != '\0')) {
+            int32_t hi;
+            pos++;
+            if (*pos == '\\') { pos++; hi = parse_escape(set); } else { hi = (uint8_t)*pos++; }
+            if (hi < lo) { error = DFA_ERR_SYNTAX; return; }
+            set_add_range(set, lo, hi);
+        }
+    }
+    pos++;
+
+    if (negate) {
+        for (uint32_t i = 0; i < 32; i++) { sets[set][i] = ~sets[set][i]; }
+    }
+}
+
+static nfa_frag_t parse_alt(void);
+
+static nfa_frag_t parse_atom(void)
+{
+    nfa_frag_t f;
+
+    if (*pos == '(') {
+        pos++;
+        f = parse_alt();
+        if (*pos != ')') { error = DFA_ERR_SYNTAX; } else { pos++; }
+        return f;
+    }
+
+    uint8_t set = new_set();
+    switch (*pos) {
+        case '[':  pos++; parse_class(set);             break;
+        case '.':  pos++; set_add_range(set, 0, 255);   break;
+        case '\\': pos++; parse_escape(set);            break;
+        case '\0': case ')': case '|': case '*': case '+': case '?':
+            error = DFA_ERR_SYNTAX;
+            break;
+        default:   set_add_range(set, (uint8_t)*pos, (uint8_t)*pos); pos++; break;
+    }
+
+    f.start = new_node(set);
+    f.end = new_node(NFA_EPSILON);
+    link_node(f.start, f.end);
+    return f;
+}
+
+static nfa_frag_t parse_repeat(void)
+{
+    nfa_frag_t f = parse_atom();
+
+    while (!error && ((*pos == '*') || (*pos == '+') || (*pos == '?'))) {
+        const char op = *pos++;
+        uint8_t end = new_node(NFA_EPSILON);
+        if (op == '+') {
+            link_node(f.end, f.start);
+            link_node(f.end, end);
+        } else {
+            uint8_t start = new_node(NFA_EPSILON);
+            link_node(start, f.start);
+            link_node(start, end);
+            if (op == '*') link_node(f.end, f.start);
+            link_node(f.end, end);
+            f.start = start;
+        }
+        f.end = end;
+    }
+    return f;
+}
+
+static nfa_frag_t parse_concat(void)
+{
+    nfa_frag_t f;
+
+    f.start = f.end = new_node(NFA_EPSILON);
+    while (!error && (*pos != '\0') && (*pos != '|') && (*pos != ')')) {
+        nfa_frag_t next = parse_repeat();
+        link_node(f.end, next.start);
+        f.end = next.end;
+    }
+    return f;
+}
+
+static nfa_frag_t parse_alt(void)
+{
+    nfa_frag_t f = parse_concat();
+
+    while (!error && (*pos == '|')) {
+        pos++;
+        nfa_frag_t other = parse_concat();
+        uint8_t start = new_node(NFA_EPSILON);
+        uint8_t end = new_node(NFA_EPSILON);
+        link_node(start, f.start);
+        link_node(start, other.start);
+        link_node(f.end, end);
+        link_node(other.end, end);
+        f.start = start;
+        f.end = end;
+    }
+    return f;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Subset construction
+
+static uint64_t nfa_closure(uint64_t s)
+{
+    uint64_t prev;
+    do {
+        prev = s;
+        for (uint32_t i = 0; i < nnodes; i++) {
+            if (!(s & (1ull << i)) || (nodes[i].set != NFA_EPSILON)) continue;
+            for (uint32_t k = 0; k < 2; k++) {
+                if (nodes[i].out[k] != NFA_NONE) { s |= (1ull << nodes[i].out[k]); }
+            }
+        }
+    } while (s != prev);
+    return s;
+}
+
+static uint64_t nfa_move(uint64_t s, uint8_t c)
+{
+    uint64_t next = 0;
+    for (uint32_t i = 0; i < nnodes; i++) {
+        if (!(s & (1ull << i)) || (nodes[i].set == NFA_EPSILON)) continue;
+        if (sets[nodes[i].set][c >> 3] & (1 << (c & 7))) { next |= (1ull << nodes[i].out[0]); }
+    }
+    return next;
+}
+
+/**
+ * Compiles 'regex' into a DFA whose tables are placed in 'mem', which must start on a 256-byte
+ * boundary and must not cross a 64KiB boundary. A DFA with n states takes (n + 1) * 256 bytes.
+ *
+ * Returns the number of states, DFA_ERR_SYNTAX if the regex can't be parsed, or DFA_ERR_TOO_BIG if
+ * it needs more NFA nodes, byte classes or DFA states than are available.
+ *
+ * In DFA_SEARCH mode, accepting states are sticky, so after running over some input the DFA is in
+ * an accepting state iff the regex matched some substring of the input.
+ */
+int dfa_compile(dfa_t* dfa, const char* regex, dfa_mode_t mode, uint8_t* mem, uint32_t memsize)
+{
+    nnodes = 0;
+    nsets = 0;
+    pos = regex;
+    error = 0;
+
+    nfa_frag_t f = parse_alt();
+    if (!error && (*pos != '\0')) error = DFA_ERR_SYNTAX;    // unbalanced ')'
+    if (error) return error;
+
+    const uint64_t accept = (1ull << f.end);
+    const uint64_t start = nfa_closure(1ull << f.start);
+    uint8_t* accept_table = &mem[0];
+    uint8_t* table = &mem[256];
+    const uint8_t page = lut_page(table);
+    uint32_t nstates = 1;
+
+    dstates[0] = start;
+    for (uint32_t s = 0; s < nstates; s++) {
+        if (((s + 2) * 256) > memsize) return DFA_ERR_TOO_BIG;
+
+        const int accepting = ((dstates[s] & accept) != 0);
+        for (uint32_t c = 0; c < 256; c++) {
+            uint32_t next = s;
+            if (!accepting || (mode != DFA_SEARCH)) {
+                uint64_t u = nfa_closure(nfa_move(dstates[s], c));
+                if (mode == DFA_SEARCH) u |= start;
+
+                for (next = 0; (next < nstates) && (dstates[next] != u); next++);
+                if (next == nstates) {
+                    if (nstates == DFA_MAX_STATES) return DFA_ERR_TOO_BIG;
+                    dstates[nstates++] = u;
+                }
+            }
+            table[(s * 256) + c] = page + next;
+        }
+    }
+
+    for (uint32_t count = 0; count < 256; count++) { accept_table[count] = 0; }
+    for (uint32_t s = 0; s < nstates; s++) {
+        accept_table[(uint8_t)(page + s)] = ((dstates[s] & accept) != 0);
+    }
+
+    dfa->accept = accept_table;
+    dfa->table = table;
+    dfa->nstates = nstates;
+    dfa->start = page;
+    return nstates;
+}
+
+/**
+ * Runs the DFA over buf on the CPU, starting from 'state', and returns the state it ends up in.
+ */
+uint8_t dfa_step(const dfa_t* dfa, uint8_t state, const uint8_t* buf, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; i++) {
+        state = dfa->table[((uint32_t)(uint8_t)(state - dfa->start) * 256) + buf[i]];
+    }
+    return state;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Running a DFA with the DMAC
+
+/**
+ * 'n' consecutive steps, starting at descs: step i does next = table[state][byte] with the byte
+ * and the state already patched into its SRCADDR, and writes the next state into byte 1 of step
+ * i + 1. The last step writes to 'last'.
+ */
+static DmacDescriptor* build_dfa_steps(DmacDescriptor* descs,
+                                       const dfa_t* dfa,
+                                       uint32_t n,
+                                       volatile uint8_t* last)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        volatile uint8_t* next = (i == (n - 1)) ? last : desc_src_byte(&descs[i + 1], 1);
+        dma_desc_set(&descs[i], DMAC_BTCTRL_BEATSIZE_BYTE, 1, dfa->table, next, &descs[i + 1]);
+    }
+    return &descs[n];
+}
+
+/**
+ * 1 descriptor. Scatters n bytes of src into byte 0 of the SRCADDRs of the n consecutive
+ * descriptors starting at 'steps'.
+ */
+static DmacDescriptor* build_dfa_scatter(DmacDescriptor* descs,
+                                         const volatile uint8_t* src,
+                                         DmacDescriptor* steps,
+                                         uint32_t n)
+{
+    // consecutive descriptors are 16 bytes apart
+    dma_desc_set(descs, (DMAC_BTCTRL_STEPSIZE_X16 |
+                         DMAC_BTCTRL_STEPSEL_DST |
+                         DMAC_BTCTRL_DSTINC |
+                         DMAC_BTCTRL_SRCINC |
+                         DMAC_BTCTRL_BEATSIZE_BYTE),
+                 n, src, desc_src_byte(steps, 0), descs + 1);
+    return descs + 1;
+}
+
+/**
+ * 3 descriptors. Feeds the single byte *byte to the DFA: *state = table[*state][*byte]. For running
+ * a DFA inside some other loop, e.g. on bytes as they arrive.
+ */
+DmacDescriptor* build_dfa_feed(DmacDescriptor* descs,
+                               const dfa_t* dfa,
+                               const volatile uint8_t* byte,
+                               volatile uint8_t* state)
+{
+    DmacDescriptor* d = descs;
+    d = build_copy(d, byte, desc_src_byte(&descs[2], 0), 1);
+    d = build_copy(d, state, desc_src_byte(&descs[2], 1), 1);
+    return build_dfa_steps(d, dfa, 1, state);
+}
+
+/**
+ * At most DFA_RUN_DESCS(unroll) descriptors. Runs the DFA over the len bytes of buf, starting from
+ * *state and leaving the final state in *state. If 'match' isn't NULL, *match is set to 1 if the
+ * final state accepts and 0 otherwise.
+ *
+ * Feeding a stream through the same DFA a piece at a time just means leaving *state alone between
+ * runs; set it to dfa->start to start over.
+ *
+ * The buffer is consumed 'unroll' bytes per loop pass: one descriptor scatters the bytes into
+ * 'unroll' consecutive lookups, and the address of the next block comes from tables indexed by the
+ * loop counter. That's 'unroll' + 11 descriptors per pass, and the leftover len % unroll bytes are
+ * done after the loop. len / unroll must be less than 256, and buf must not cross a 64KiB boundary.
+ *
+ * 'scratch' is DFA_RUN_SCRATCH bytes of memory that must start on a 256-byte boundary and be
+ * private to this instance. It's filled in here.
+ */
+DmacDescriptor* build_dfa_run(DmacDescriptor* descs,
+                              const dfa_t* dfa,
+                              const volatile uint8_t* buf,
+                              uint32_t len,
+                              uint32_t unroll,
+                              volatile uint8_t* state,
+                              volatile uint8_t* match,
+                              uint8_t* scratch)
+{
+    const uint32_t npasses = len / unroll;
+    const uint32_t tail = len % unroll;
+
+    // targets has to be at the start of a page, since the branch table isn't biased.
+    DmacDescriptor** targets = (DmacDescriptor**)&scratch[0];
+    uint8_t* count = &scratch[8];
+    uint8_t* passes = &scratch[9];
+    uint8_t* lo = &scratch[1 * 256];
+    uint8_t* hi = &scratch[2 * 256];
+    uint8_t* dec = &scratch[3 * 256];
+    uint8_t* branch = &scratch[4 * 256];
+
+    DmacDescriptor* d = descs;
+    const volatile uint8_t* cur = state;    // where the current state is kept
+
+    if (npasses > 0) {
+        DmacDescriptor* body = d + 2;
+        DmacDescriptor* steps = body + 5;
+
+        // Pass p reads buf[p * unroll] onwards; the counter runs from npasses down to 1, and the
+        // scatter wants the address just past the block.
+        *passes = npasses;
+        setup_index_to_addr(lo, hi, buf, -(int32_t)unroll, (npasses + 1) * unroll);
+        setup_decrement(dec);
+        setup_branch_if_zero(branch);
+
+        d = build_copy(d, state, desc_src_byte(steps, 1), 1);
+        d = build_copy(d, passes, count, 1);
+
+        d = build_lookup(d, lo, count, desc_src_byte(d + 4, 0));
+        d = build_lookup(d, hi, count, desc_src_byte(d + 2, 1));
+        d = build_dfa_scatter(d, buf, steps, unroll);
+        d = build_dfa_steps(d, dfa, unroll, desc_src_byte(steps, 1));
+        d = build_lookup(d, dec, count, count);
+
+        DmacDescriptor* exit = build_branch(d, branch, count, targets);
+        targets[0] = body;
+        targets[1] = exit;
+
+        d = exit;
+        cur = desc_src_byte(steps, 1);
+    }
+
+    if (tail > 0) {
+        DmacDescriptor* steps = d + 2;
+        d = build_copy(d, cur, desc_src_byte(steps, 1), 1);
+        d = build_dfa_scatter(d, &buf[len - tail], steps, tail);
+        d = build_dfa_steps(d, dfa, tail, state);
+    } else if (cur != state) {
+        d = build_copy(d, cur, state, 1);
+    }
+
+    if (match) {
+        d = build_lookup(d, dfa->accept, state, match);
+    }
+    return d;
+}
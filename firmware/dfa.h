@@ -0,0 +1,51 @@
+#ifndef _DFA_H
+#define _DFA_H
+
+#include <stdint.h>
+#include "dma.h"
+
+/**
+ * A compiled DFA. States are named by the page number of their row of 'table', so that a state
+ * can be patched straight into byte 1 of a lookup descriptor's SRCADDR.
+ */
+typedef struct dfa {
+    const uint8_t* accept;    // 1x256, [state] -> 1 if the state accepts, else 0
+    const uint8_t* table;     // nstates x 256, [state][byte] -> next state
+    uint8_t nstates;
+    uint8_t start;
+} dfa_t;
+
+typedef enum dfa_mode {
+    DFA_SEARCH,       // accept once the regex has matched anywhere in the input so far
+    DFA_FULLMATCH     // accept only if all of the input so far matches the regex
+} dfa_mode_t;
+
+#define DFA_ERR_SYNTAX  (-1)
+#define DFA_ERR_TOO_BIG (-2)
+
+// scratch space needed by build_dfa_run()
+#define DFA_RUN_SCRATCH (5 * 256)
+
+// descriptors needed by build_dfa_run()
+#define DFA_RUN_DESCS(unroll) ((2 * (unroll)) + 20)
+
+// descriptors needed by build_dfa_feed()
+#define DFA_FEED_DESCS 3
+
+int dfa_compile(dfa_t* dfa, const char* regex, dfa_mode_t mode, uint8_t* mem, uint32_t memsize);
+uint8_t dfa_step(const dfa_t* dfa, uint8_t state, const uint8_t* buf, uint32_t len);
+
+DmacDescriptor* build_dfa_feed(DmacDescriptor* descs,
+                               const dfa_t* dfa,
+                               const volatile uint8_t* byte,
+                               volatile uint8_t* state);
+DmacDescriptor* build_dfa_run(DmacDescriptor* descs,
+                              const dfa_t* dfa,
+                              const volatile uint8_t* buf,
+                              uint32_t len,
+                              uint32_t unroll,
+                              volatile uint8_t* state,
+                              volatile uint8_t* match,
+                              uint8_t* scratch);
+
+#endif
@@ -0,0 +1,164 @@
+/**
+ * This file contains the bits of DMAC setup needed to actually run the descriptor chains that
+ * dmainstrs.c builds.
+ *
+ * Every chain is run as a single software-triggered transaction, so once it's started, the DMAC
+ * walks the whole linked list (including any branches and loops that the chain makes for itself)
+ * without any help from the CPU.
+ */
+
+#include "samd21g18a.h"
+#include "dmac.h"
+
+// The DMAC fetches the first descriptor of each channel from the base section, and saves the state
+// of each channel to the writeback section whenever it moves on to another descriptor.
+static DmacDescriptor base_descs[DMAC_CH_NUM] __attribute__((aligned(16)));
+static DmacDescriptor writeback_descs[DMAC_CH_NUM] __attribute__((aligned(16)));
+
+static struct {
+    dmac_handler_t handler;
+    void* ctx;
+    uint8_t intflags;
+} handlers[DMAC_CH_NUM];
+
+void dmac_init(void)
+{
+    // enable the DMAC's AHB and APB clocks
+    PM->AHBMASK.reg  |= (1 << 5);
+    PM->APBBMASK.reg |= (1 << 4);
+
+    DMAC->CTRL.reg &= ~DMAC_CTRL_DMAENABLE;
+    DMAC->CTRL.reg = DMAC_CTRL_SWRST;
+    while (DMAC->CTRL.reg & DMAC_CTRL_SWRST);
+
+    DMAC->BASEADDR.reg = (uint32_t)base_descs;
+    DMAC->WRBADDR.reg  = (uint32_t)writeback_descs;
+
+    // Channels on the same level take turns rather than the lowest-numbered one always winning,
+    // so that a channel spinning on a flag can't starve the channel that's meant to set it.
+    DMAC->PRICTRL0.reg = (DMAC_PRICTRL0_RRLVLEN0 | DMAC_PRICTRL0_RRLVLEN1 |
+                          DMAC_PRICTRL0_RRLVLEN2 | DMAC_PRICTRL0_RRLVLEN3);
+
+    // enable the DMAC with all 4 priority levels
+    DMAC->CTRL.reg = DMAC_CTRL_DMAENABLE | DMAC_CTRL_LVLEN(0xf);
+}
+
+/**
+ * Loads 'chain' into 'channel' and enables the channel with the given CHCTRLB settings (trigger
+ * source and action, event input / output). The chain doesn't run until the channel is triggered.
+ *
+ * The first descriptor is copied into the channel's base descriptor; every other descriptor is
+ * used in place. This means that a chain which loops back to its own first descriptor will see any
+ * patches made to chain[0], but the very first pass will not.
+ *
+ * Resetting the channel clears its interrupt enables, so the ones from dmac_set_handler() are put
+ * back before it's enabled.
+ */
+void dmac_enable(uint8_t channel, const DmacDescriptor* chain, uint32_t chctrlb)
+{
+    base_descs[channel].BTCTRL.reg   = chain->BTCTRL.reg;
+    base_descs[channel].BTCNT.reg    = chain->BTCNT.reg;
+    base_descs[channel].SRCADDR.reg  = chain->SRCADDR.reg;
+    base_descs[channel].DSTADDR.reg  = chain->DSTADDR.reg;
+    base_descs[channel].DESCADDR.reg = chain->DESCADDR.reg;
+
+    DMAC->CHID.reg = channel;
+    DMAC->CHCTRLA.reg &= ~DMAC_CHCTRLA_ENABLE;
+    DMAC->CHCTRLA.reg = DMAC_CHCTRLA_SWRST;
+    while (DMAC->CHCTRLA.reg & DMAC_CHCTRLA_SWRST);
+
+    DMAC->CHCTRLB.reg = chctrlb;
+    DMAC->CHINTENSET.reg = handlers[channel].intflags;
+    DMAC->CHCTRLA.reg = DMAC_CHCTRLA_ENABLE;
+}
+
+void dmac_trigger(uint8_t channel)
+{
+    DMAC->SWTRIGCTRL.reg |= (1ul << channel);
+}
+
+/**
+ * Starts 'chain' running on 'channel' and returns right away.
+ */
+void dmac_start(uint8_t channel, const DmacDescriptor* chain)
+{
+    // software trigger; one trigger runs the whole linked list.
+    dmac_enable(channel, chain, (DMAC_CHCTRLB_TRIGACT_TRANSACTION |
+                                 DMAC_CHCTRLB_TRIGSRC(0) |
+                                 DMAC_CHCTRLB_LVL(0)));
+    dmac_trigger(channel);
+}
+
+/**
+ * Disables 'channel', abandoning whatever it was doing.
+ */
+void dmac_stop(uint8_t channel)
+{
+    DMAC->CHID.reg = channel;
+    DMAC->CHCTRLA.reg &= ~DMAC_CHCTRLA_ENABLE;
+    while (DMAC->CHCTRLA.reg & DMAC_CHCTRLA_ENABLE);
+}
+
+/**
+ * The DMAC disables a channel by itself once it has finished the last descriptor of its chain.
+ */
+int dmac_busy(uint8_t channel)
+{
+    DMAC->CHID.reg = channel;
+    return (DMAC->CHCTRLA.reg & DMAC_CHCTRLA_ENABLE) ? 1 : 0;
+}
+
+void dmac_run(uint8_t channel, const DmacDescriptor* chain)
+{
+    dmac_start(channel, chain);
+    while (dmac_busy(channel));
+}
+
+/**
+ * Resumes 'channel' if a descriptor with BLOCKACT_SUSPEND has suspended it.
+ */
+void dmac_resume(uint8_t channel)
+{
+    DMAC->CHID.reg = channel;
+    DMAC->CHCTRLB.reg = (DMAC->CHCTRLB.reg & ~DMAC_CHCTRLB_CMD_Msk) | DMAC_CHCTRLB_CMD_RESUME;
+}
+
+/**
+ * Calls 'handler' from the DMAC interrupt whenever one of 'intflags' (DMAC_CHINTENSET_*) gets set
+ * on 'channel'. A NULL handler turns the channel's interrupts off again.
+ *
+ * This can be done before or after the channel is started: flags that are already set aren't
+ * cleared, so one that was set in the meantime still gets to the handler.
+ */
+void dmac_set_handler(uint8_t channel, uint8_t intflags, dmac_handler_t handler, void* ctx)
+{
+    NVIC_DisableIRQ(DMAC_IRQn);
+    handlers[channel].handler = handler;
+    handlers[channel].ctx = ctx;
+    handlers[channel].intflags = handler ? intflags : 0;
+
+    DMAC->CHID.reg = channel;
+    DMAC->CHINTENCLR.reg = DMAC_CHINTENCLR_MASK;
+    DMAC->CHINTENSET.reg = handlers[channel].intflags;
+    NVIC_EnableIRQ(DMAC_IRQn);
+}
+
+void DMAC_Handler(void)
+{
+    // CHID selects the channel for everything else too, so put back whatever was interrupted.
+    const uint8_t chid = DMAC->CHID.reg;
+    uint32_t pending = DMAC->INTSTATUS.reg;
+
+    while (pending) {
+        const uint8_t channel = __builtin_ctz(pending);
+        pending &= pending - 1;
+
+        DMAC->CHID.reg = channel;
+        const uint8_t flags = DMAC->CHINTFLAG.reg;
+        DMAC->CHINTFLAG.reg = flags;
+        if (handlers[channel].handler) {
+            handlers[channel].handler(channel, flags, handlers[channel].ctx);
+        }
+    }
+    DMAC->CHID.reg = chid;
+}
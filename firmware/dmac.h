@@ -0,0 +1,32 @@
+#ifndef _DMAC_H
+#define _DMAC_H
+
+#include <stdint.h>
+#include "dma.h"
+
+// Which DMAC channel does what. Sorting networks and split histograms spread over channels 0 to
+// (at most) 3, and the benchmarks run on 0, all one at a time; the rest here can stay running
+// alongside them and each other, so none of them share a channel. DMAC events only exist on
+// channels 0 - 3, which the RX pipeline needs.
+#define UART_RX_CHANNEL         0    // moves received bytes into the ring
+#define UART_RX_COMPUTE_CHANNEL 1    // runs the RX compute chain
+#define UART_TX_CHANNEL         2    // feeds SERCOM0's transmitter
+#define JOBQ_CHANNEL            4    // runs the job queue's dispatcher
+
+/**
+ * Called from the DMAC interrupt with the channel's interrupt flags that were set (and have been
+ * cleared).
+ */
+typedef void (*dmac_handler_t)(uint8_t channel, uint8_t flags, void* ctx);
+
+void dmac_init(void);
+void dmac_enable(uint8_t channel, const DmacDescriptor* chain, uint32_t chctrlb);
+void dmac_trigger(uint8_t channel);
+void dmac_start(uint8_t channel, const DmacDescriptor* chain);
+void dmac_stop(uint8_t channel);
+int dmac_busy(uint8_t channel);
+void dmac_run(uint8_t channel, const DmacDescriptor* chain);
+void dmac_resume(uint8_t channel);
+void dmac_set_handler(uint8_t channel, uint8_t intflags, dmac_handler_t handler, void* ctx);
+
+#endif
@@ -88,7 +88,7 @@ void setup_low_nybble_low_nybble_to_byte(uint8_t* base)
  */
 void setup_low_nybble_to_low_nybble(uint8_t* base)
 {
-    for (uint8_t count = 0; count < 256; count++) { base[count] = (count << 0) & 0x0f; }
+    for (uint32_t count = 0; count < 256; count++) { base[count] = (count << 0) & 0x0f; }
 }
 
 /**
@@ -97,7 +97,7 @@ void setup_low_nybble_to_low_nybble(uint8_t* base)
  */
 void setup_low_nybble_to_high_nybble(uint8_t* base)
 {
-    for (uint8_t count = 0; count < 256; count++) { base[count] = (count << 4) & 0xf0; }
+    for (uint32_t count = 0; count < 256; count++) { base[count] = (count << 4) & 0xf0; }
 }
 
 /**
@@ -106,7 +106,7 @@ void setup_low_nybble_to_high_nybble(uint8_t* base)
  */
 void setup_high_nybble_to_high_nybble(uint8_t* base)
 {
-    for (uint8_t count = 0; count < 256; count++) { base[count] = (count << 0) & 0xf0; }
+    for (uint32_t count = 0; count < 256; count++) { base[count] = (count << 0) & 0xf0; }
 }
 
 /**
@@ -115,7 +115,7 @@ void setup_high_nybble_to_high_nybble(uint8_t* base)
  */
 void setup_high_nybble_to_low_nybble(uint8_t* base)
 {
-    for (uint8_t count = 0; count < 256; count++) { base[count] = (count >> 4) & 0x0f; }
+    for (uint32_t count = 0; count < 256; count++) { base[count] = (count >> 4) & 0x0f; }
 }
 
 /**
@@ -124,7 +124,7 @@ void setup_high_nybble_to_low_nybble(uint8_t* base)
  */
 void setup_nybble_add_no_carryin(uint8_t* base)
 {
-    for (uint8_t count = 0; count < 256; count++) {
+    for (uint32_t count = 0; count < 256; count++) {
         base[count] = (((count >> 4) & 0x0f) + (count & 0x0f)) & 0x0f;
     }
 }
@@ -135,27 +135,29 @@ void setup_nybble_add_no_carryin(uint8_t* base)
  */
 void setup_nybble_add_with_carryin(uint8_t* base)
 {
-    for (uint8_t count = 0; count < 256; count++) {
+    for (uint32_t count = 0; count < 256; count++) {
         base[count] = (((count >> 4) & 0x0f) + (count & 0x0f) + 1) & 0x0f;
     }
 }
 
 /**
  * 16x16 table.
+ * table[0byyyy_xxxx] maps to the carry bit of xxxx + yyyy.
  */
-void setup_nybble_add_no_carryin(uint8_t* base)
+void setup_nybble_carryout_no_carryin(uint8_t* base)
 {
-    for (uint8_t count = 0; count < 256; count++) {
+    for (uint32_t count = 0; count < 256; count++) {
         base[count] = ((((count >> 4) & 0x0f) + (count & 0x0f)) & 0x10) >> 4;
     }
 }
 
 /**
  * 16x16 table.
+ * table[0byyyy_xxxx] maps to the carry bit of 1 + xxxx + yyyy.
  */
-void setup_nybble_add_with_carryin(uint8_t* base)
+void setup_nybble_carryout_with_carryin(uint8_t* base)
 {
-    for (uint8_t count = 0; count < 256; count++) {
+    for (uint32_t count = 0; count < 256; count++) {
         base[count] = ((((count >> 4) & 0x0f) + (count & 0x0f) + 1) & 0x10) >> 4;
     }
 }
@@ -166,11 +168,359 @@ void setup_nybble_add_with_carryin(uint8_t* base)
  */
 void setup_nybble_compare_equal(uint8_t* base, uint8_t a, uint8_t b)
 {
-    for (uint8_t count = 0; count < 256; count++) {
+    for (uint32_t count = 0; count < 256; count++) {
         base[count] = ((count & 0x0f) == ((count >> 4) & 0x0f)) ? a : b;
     }
 }
 
+/**
+ * Adds 'bias' to every entry of an n-byte table.
+ *
+ * Two-dimensional LUTs are indexed by patching both byte 0 and byte 1 of a descriptor's SRCADDR, so
+ * whatever gets written into byte 1 has to already be the page number (address bits 15:8) of the
+ * selected row. Biasing a table by lut_page(other_table) turns its outputs into row numbers of
+ * other_table.
+ */
+void lut_add_bias(uint8_t* base, uint32_t n, uint8_t bias)
+{
+    for (uint32_t count = 0; count < n; count++) { base[count] += bias; }
+}
+
+/**
+ * DIGIT_VALUES x 256 table.
+ * table[row][col] maps to ((col << DIGIT_BITS) | row) & 0xff.
+ *
+ * This is the digit-width-generic replacement for low_nybble_low_nybble_to_byte. It's used two
+ * ways:
+ *     * merge[b digit][a digit] gives the 0b(a)(b) index into a digit op table. The whole byte a
+ *       can be used as the column without masking: the shift drops its top bits, and of those
+ *       that are left, the op tables only look at its bottom digit.
+ *     * repeatedly doing acc = merge[digit][acc], from the most significant digit down, packs
+ *       digits back into a byte.
+ */
+void setup_digit_merge(uint8_t* base)
+{
+    for (uint32_t row = 0; row < DIGIT_VALUES; row++) {
+        for (uint32_t col = 0; col < 256; col++) {
+            base[(row * 256) + col] = (uint8_t)(((col << DIGIT_BITS) | row) & 0xff);
+        }
+    }
+}
+
+/**
+ * 1x256 table.
+ * table[v] maps to digit 'digit' of v, shifted down to bits (DIGIT_BITS-1):0.
+ */
+void setup_digit_extract(uint8_t* base, uint32_t digit)
+{
+    for (uint32_t count = 0; count < 256; count++) {
+        base[count] = (count >> (digit * DIGIT_BITS)) & DIGIT_MASK;
+    }
+}
+
+/**
+ * 1x256 table.
+ * table[v] maps to page + (v >> DIGIT_BITS).
+ *
+ * Turns the flags (carry, borrow, overflow class) that the digit op tables leave above the result
+ * digit into the row number of a table that starts on 'page'.
+ */
+void setup_flags_to_page(uint8_t* base, uint8_t page)
+{
+    for (uint32_t count = 0; count < 256; count++) { base[count] = page + (count >> DIGIT_BITS); }
+}
+
+/**
+ * 2 x 256 table.
+ * table[cin][a << DIGIT_BITS | b] maps to a + b + cin, with the sum in the low DIGIT_BITS bits and
+ * the carry in the bit above.
+ */
+void setup_digit_addc(uint8_t* base)
+{
+    for (uint32_t cin = 0; cin < 2; cin++) {
+        for (uint32_t count = 0; count < 256; count++) {
+            uint32_t a = (count >> DIGIT_BITS) & DIGIT_MASK;
+            uint32_t b = count & DIGIT_MASK;
+            base[(cin * 256) + count] = (a + b + cin) & ((DIGIT_MASK << 1) | 1);
+        }
+    }
+}
+
+/**
+ * 2 x 256 table.
+ * table[bin][a << DIGIT_BITS | b] maps to a - b - bin, with the difference in the low DIGIT_BITS
+ * bits and the borrow in the bit above.
+ */
+void setup_digit_subc(uint8_t* base)
+{
+    for (uint32_t bin = 0; bin < 2; bin++) {
+        for (uint32_t count = 0; count < 256; count++) {
+            uint32_t a = (count >> DIGIT_BITS) & DIGIT_MASK;
+            uint32_t b = count & DIGIT_MASK;
+            base[(bin * 256) + count] = (a - b - bin) & ((DIGIT_MASK << 1) | 1);
+        }
+    }
+}
+
+/**
+ * Signed overflow classes reported above the result digit by the *_signed_msd tables.
+ */
+#define OVERFLOW_NONE 0
+#define OVERFLOW_POS  1
+#define OVERFLOW_NEG  2
+
+static int32_t sign_extend_digit(uint32_t d)
+{
+    return (d & (1 << (DIGIT_BITS - 1))) ? ((int32_t)d - DIGIT_VALUES) : (int32_t)d;
+}
+
+static uint8_t signed_msd_result(int32_t full)
+{
+    const int32_t max = (DIGIT_VALUES / 2) - 1;
+    const int32_t min = -(DIGIT_VALUES / 2);
+    uint8_t cls = (full > max) ? OVERFLOW_POS : ((full < min) ? OVERFLOW_NEG : OVERFLOW_NONE);
+    return (uint8_t)((cls << DIGIT_BITS) | (full & DIGIT_MASK));
+}
+
+/**
+ * 2 x 256 table for the most significant digit of a signed add.
+ * table[cin][a << DIGIT_BITS | b] maps to a + b + cin (as signed digits), with the sum in the low
+ * DIGIT_BITS bits and the overflow class (OVERFLOW_NONE / _POS / _NEG) above it.
+ */
+void setup_digit_addc_signed_msd(uint8_t* base)
+{
+    for (uint32_t cin = 0; cin < 2; cin++) {
+        for (uint32_t count = 0; count < 256; count++) {
+            int32_t full = (sign_extend_digit((count >> DIGIT_BITS) & DIGIT_MASK) +
+                            sign_extend_digit(count & DIGIT_MASK) + (int32_t)cin);
+            base[(cin * 256) + count] = signed_msd_result(full);
+        }
+    }
+}
+
+/**
+ * 2 x 256 table for the most significant digit of a signed subtract.
+ * table[bin][a << DIGIT_BITS | b] maps to a - b - bin (as signed digits), with the difference in
+ * the low DIGIT_BITS bits and the overflow class above it.
+ */
+void setup_digit_subc_signed_msd(uint8_t* base)
+{
+    for (uint32_t bin = 0; bin < 2; bin++) {
+        for (uint32_t count = 0; count < 256; count++) {
+            int32_t full = (sign_extend_digit((count >> DIGIT_BITS) & DIGIT_MASK) -
+                            sign_extend_digit(count & DIGIT_MASK) - (int32_t)bin);
+            base[(bin * 256) + count] = signed_msd_result(full);
+        }
+    }
+}
+
+/**
+ * (1 + nclamp)x256 table.
+ * table[0][r] maps to r; table[f][r] maps to clamp[f - 1] for f > 0.
+ *
+ * Used to apply saturation after an add: the row is selected by the carry / overflow class.
+ */
+void setup_clamp(uint8_t* base, const uint8_t* clamp, uint32_t nclamp)
+{
+    for (uint32_t count = 0; count < 256; count++) { base[count] = count; }
+    for (uint32_t f = 0; f < nclamp; f++) {
+        for (uint32_t count = 0; count < 256; count++) { base[((f + 1) * 256) + count] = clamp[f]; }
+    }
+}
+
+/**
+ * 2x256 table.
+ * table[c][r] maps to ((c * 256) + r) mod n, for any (c * 256) + r < 2n.
+ *
+ * Used after an add of two values that are already reduced mod n.
+ */
+void setup_mod_reduce(uint8_t* base, uint8_t n)
+{
+    for (uint32_t count = 0; count < 512; count++) {
+        base[count] = (count >= n) ? (count - n) : count;
+    }
+}
+
+static uint8_t lane2_op(lane2_op_t op, uint32_t x, uint32_t y)
+{
+    switch (op) {
+        case LANE2_ADD:     return (x + y) & 0x03;
+        case LANE2_ADD_SAT: return ((x + y) > 3) ? 3 : (x + y);
+        case LANE2_SUB:     return (x - y) & 0x03;
+        case LANE2_EQ:      return (x == y) ? 3 : 0;
+        case LANE2_LT:      return (x < y) ? 3 : 0;
+        case LANE2_MIN:     return (x < y) ? x : y;
+        case LANE2_MAX:     return (x > y) ? x : y;
+        case LANE2_AND:     return x & y;
+        case LANE2_OR:      return x | y;
+        case LANE2_XOR:     return x ^ y;
+        default:            return 0;
+    }
+}
+
+/**
+ * 16x16 table of two independent 2-bit ops.
+ * table[0bwwxx_yyzz] maps to 0b0000_(ww op yy)(xx op zz).
+ *
+ * Indexed with combine[row][col] like any other nybble op, but each nybble carries two 2-bit
+ * lanes, so every lookup does two ops. Compare ops produce 0b11 for true and 0b00 for false so
+ * that their results can be used as lane masks.
+ */
+void setup_dual_lane2_op(uint8_t* base, lane2_op_t op)
+{
+    for (uint32_t count = 0; count < 256; count++) {
+        uint32_t x = (count >> 4) & 0x0f;
+        uint32_t y = (count >> 0) & 0x0f;
+        base[count] = ((lane2_op(op, (x >> 2) & 0x03, (y >> 2) & 0x03) << 2) |
+                       (lane2_op(op, (x >> 0) & 0x03, (y >> 0) & 0x03) << 0));
+    }
+}
+
+/**
+ * 1x256 table.
+ * table[v] maps to v - 1 (mod 256). Used for loop counters.
+ */
+void setup_decrement(uint8_t* base)
+{
+    for (uint32_t count = 0; count < 256; count++) { base[count] = (count - 1) & 0xff; }
+}
+
+/**
+ * 1x256 table for build_branch().
+ * table[v] maps to 4 if v == 0 and to 0 otherwise, i.e. the byte offset of the selected entry in a
+ * { nonzero target, zero target } array.
+ */
+void setup_branch_if_zero(uint8_t* base)
+{
+    for (uint32_t count = 0; count < 256; count++) { base[count] = (count == 0) ? 4 : 0; }
+}
+
+/**
+ * Two 1x256 tables for build_indexed_copy().
+ * lo[i] and hi[i] map to bytes 0 and 1 of the address (base + (i * stride) + offset).
+ *
+ * The array that's being indexed must not cross a 64KiB boundary, since bytes 2 and 3 of the
+ * address never change.
+ */
+void setup_index_to_addr(uint8_t* lo, uint8_t* hi, const volatile void* base, int32_t stride,
+                         int32_t offset)
+{
+    for (uint32_t count = 0; count < 256; count++) {
+        uint32_t addr = (uint32_t)base + (uint32_t)((int32_t)count * stride) + (uint32_t)offset;
+        lo[count] = (addr >> 0) & 0xff;
+        hi[count] = (addr >> 8) & 0xff;
+    }
+}
+
+/**
+ * 3x256 table, for comparing numbers one digit at a time from the most significant digit down.
+ * table[state][a << DIGIT_BITS | b] maps to the state after looking at digits a and b: 0x00 while
+ * everything so far has been equal, and then 0x01 (a > b) or 0xff (a < b) for good. Page 0 is
+ * the "equal so far" state, page 1 is 0x01 and page 2 is 0xff.
+ */
+void setup_digit_compare(uint8_t* base)
+{
+    for (uint32_t count = 0; count < 256; count++) {
+        uint32_t a = (count >> DIGIT_BITS) & DIGIT_MASK;
+        uint32_t b = count & DIGIT_MASK;
+        base[(0 * 256) + count] = (a > b) ? 0x01 : ((a < b) ? 0xff : 0x00);
+        base[(1 * 256) + count] = 0x01;
+        base[(2 * 256) + count] = 0xff;
+    }
+}
+
+/**
+ * 1x256 table.
+ * table[v] maps the result of setup_digit_compare() to page + (0, 1 or 2).
+ */
+void setup_compare_to_page(uint8_t* base, uint8_t page)
+{
+    for (uint32_t count = 0; count < 256; count++) {
+        base[count] = page + ((count == 0x01) ? 1 : ((count == 0xff) ? 2 : 0));
+    }
+}
+
+/**
+ * 1x256 table.
+ * table[a << DIGIT_BITS | b] maps to the low digit of a * b.
+ */
+void setup_digit_mul_lo(uint8_t* base)
+{
+    for (uint32_t count = 0; count < 256; count++) {
+        uint32_t a = (count >> DIGIT_BITS) & DIGIT_MASK;
+        uint32_t b = count & DIGIT_MASK;
+        base[count] = (a * b) & DIGIT_MASK;
+    }
+}
+
+/**
+ * 1x256 table.
+ * table[a << DIGIT_BITS | b] maps to the high digit of a * b.
+ */
+void setup_digit_mul_hi(uint8_t* base)
+{
+    for (uint32_t count = 0; count < 256; count++) {
+        uint32_t a = (count >> DIGIT_BITS) & DIGIT_MASK;
+        uint32_t b = count & DIGIT_MASK;
+        base[count] = ((a * b) >> DIGIT_BITS) & DIGIT_MASK;
+    }
+}
+
+/**
+ * 1x256 table.
+ * table[v] maps to (v + 1) mod n. Used for indices into ring buffers of n entries.
+ */
+void setup_increment_mod(uint8_t* base, uint32_t n)
+{
+    for (uint32_t count = 0; count < 256; count++) { base[count] = (count + 1) % n; }
+}
+
+/**
+ * 1x256 table.
+ * table[v] maps to (v + n) mod 256.
+ */
+void setup_add_const(uint8_t* base, uint8_t n)
+{
+    for (uint32_t count = 0; count < 256; count++) { base[count] = (count + n) & 0xff; }
+}
+
+/**
+ * 1x256 table.
+ * table[v] maps to carry_page if v + n carries out of the byte and to no_carry_page otherwise.
+ */
+void setup_carry_to_page(uint8_t* base, uint8_t n, uint8_t carry_page, uint8_t no_carry_page)
+{
+    for (uint32_t count = 0; count < 256; count++) {
+        base[count] = ((count + n) > 0xff) ? carry_page : no_carry_page;
+    }
+}
+
+/**
+ * 1x256 table.
+ * table[a << DIGIT_BITS | b] maps to a ^ b.
+ */
+void setup_digit_xor(uint8_t* base)
+{
+    for (uint32_t count = 0; count < 256; count++) {
+        base[count] = ((count >> DIGIT_BITS) ^ count) & DIGIT_MASK;
+    }
+}
+
+/**
+ * 1x256 table for a byte-at-a-time, MSB-first CRC-8 with polynomial 'poly': the new CRC is
+ * table[crc ^ byte].
+ */
+void setup_crc8(uint8_t* base, uint8_t poly)
+{
+    for (uint32_t count = 0; count < 256; count++) {
+        uint8_t crc = count;
+        for (uint32_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? ((crc << 1) ^ poly) : (crc << 1);
+        }
+        base[count] = crc;
+    }
+}
+
 /**
  * Builds a 65,536 entry table that holds the results of additions.
  *
@@ -195,85 +545,1174 @@ void build_lut8_add(uint8_t* base)
 }
 
 
+////////////////////////////////////////////////////////////////////////////////
+// Descriptor building helpers
+//
+// Unless otherwise noted, the build_* functions below lay their descriptors out back-to-back
+// starting at 'descs', link the last one to the slot right after it, and return a pointer to that
+// slot. This lets chains be composed by just calling one builder after another:
+//
+//     DmacDescriptor* d = descs;
+//     d = build_bswap32(d, &in, &out);
+//     d = build_bswap32(d, &in2, &out2);
+//     dma_chain_terminate(d - 1);
+
+/**
+ * Fills out a single descriptor that moves 'btcnt' beats from 'src' to 'dst' and then continues
+ * to 'next' (NULL to stop).
+ *
+ * 'src' and 'dst' are the addresses of the first beat. When an address is incremented, the DMAC
+ * wants the address just past the last beat instead; that conversion is done here so that callers
+ * never have to think about it.
+ */
+void dma_desc_set(DmacDescriptor* desc,
+                  uint16_t btctrl,
+                  uint16_t btcnt,
+                  const volatile void* src,
+                  volatile void* dst,
+                  const DmacDescriptor* next)
+{
+    const uint32_t beat = 1ul << ((btctrl & DMAC_BTCTRL_BEATSIZE_Msk) >> DMAC_BTCTRL_BEATSIZE_Pos);
+    const uint32_t step = 1ul << ((btctrl & DMAC_BTCTRL_STEPSIZE_Msk) >> DMAC_BTCTRL_STEPSIZE_Pos);
+    const uint32_t src_step = (btctrl & DMAC_BTCTRL_STEPSEL) ? step : 1;
+    const uint32_t dst_step = (btctrl & DMAC_BTCTRL_STEPSEL) ? 1 : step;
+
+    uint32_t srcaddr = (uint32_t)src;
+    uint32_t dstaddr = (uint32_t)dst;
+    if (btctrl & DMAC_BTCTRL_SRCINC) { srcaddr += btcnt * beat * src_step; }
+    if (btctrl & DMAC_BTCTRL_DSTINC) { dstaddr += btcnt * beat * dst_step; }
+
+    desc->BTCTRL.reg   = btctrl | DMAC_BTCTRL_VALID;
+    desc->BTCNT.reg    = btcnt;
+    desc->SRCADDR.reg  = srcaddr;
+    desc->DSTADDR.reg  = dstaddr;
+    desc->DESCADDR.reg = (uint32_t)next;
+}
+
+/**
+ * Makes 'last' the final descriptor of its chain.
+ */
+void dma_chain_terminate(DmacDescriptor* last)
+{
+    last->DESCADDR.reg = 0;
+}
+
+/**
+ * Returns the widest beat size that 'src', 'dst' and 'nbytes' are all aligned to.
+ */
+static uint16_t widest_beatsize(const volatile void* src, const volatile void* dst, uint32_t nbytes)
+{
+    const uint32_t align = (uint32_t)src | (uint32_t)dst | nbytes;
+    if ((align & 0x03) == 0) return DMAC_BTCTRL_BEATSIZE_WORD;
+    if ((align & 0x01) == 0) return DMAC_BTCTRL_BEATSIZE_HWORD;
+    return DMAC_BTCTRL_BEATSIZE_BYTE;
+}
+
+/**
+ * 1 descriptor. Plain memcpy of 'nbytes' bytes from 'src' to 'dst', using the widest beats that
+ * the alignment of the arguments allows.
+ */
+DmacDescriptor* build_copy(DmacDescriptor* descs,
+                           const volatile void* src,
+                           volatile void* dst,
+                           uint16_t nbytes)
+{
+    const uint16_t beatsize = widest_beatsize(src, dst, nbytes);
+    const uint16_t beats = nbytes >> (beatsize >> DMAC_BTCTRL_BEATSIZE_Pos);
+
+    dma_desc_set(&descs[0], beatsize | DMAC_BTCTRL_SRCINC | DMAC_BTCTRL_DSTINC, beats,
+                 src, dst, &descs[1]);
+    return &descs[1];
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Byte order manipulation
+//
+// The DMAC can only ever increment addresses, so any single descriptor preserves the order of the
+// bytes that it moves. Reversing n bytes one byte per descriptor costs n descriptors; instead, the
+// functions below lean on the address step size: a descriptor that steps its source by L bytes
+// 'gathers' one byte lane out of a whole array of L-byte elements, and a descriptor that steps its
+// destination by L bytes 'scatters' a lane back. Gathering lane k and scattering it to lane
+// (L - 1 - k) reverses the bytes of every element at once, for 2 * L descriptors regardless of how
+// many elements there are.
+
+/**
+ * 2 descriptors. *dst = byteswap(*src) for a 16-bit value. src and dst must not overlap.
+ */
+DmacDescriptor* build_bswap16(DmacDescriptor* descs, const volatile void* src, volatile void* dst)
+{
+    const volatile uint8_t* s = src;
+    volatile uint8_t* d = dst;
+
+    dma_desc_set(&descs[0], DMAC_BTCTRL_BEATSIZE_BYTE, 1, &s[1], &d[0], &descs[1]);
+    dma_desc_set(&descs[1], DMAC_BTCTRL_BEATSIZE_BYTE, 1, &s[0], &d[1], &descs[2]);
+    return &descs[2];
+}
+
+/**
+ * 4 descriptors. *dst = byteswap(*src) for a 32-bit value. src and dst must not overlap.
+ *
+ * For more than one word, build_reverse_lanes() with lanes = 4 is cheaper.
+ */
+DmacDescriptor* build_bswap32(DmacDescriptor* descs, const volatile void* src, volatile void* dst)
+{
+    const volatile uint8_t* s = src;
+    volatile uint8_t* d = dst;
+
+    for (int i = 0; i < 4; i++) {
+        dma_desc_set(&descs[i], DMAC_BTCTRL_BEATSIZE_BYTE, 1, &s[i], &d[3 - i], &descs[i + 1]);
+    }
+    return &descs[4];
+}
+
+/**
+ * 2 * lanes descriptors. Reverses the order of the bytes inside each of the 'count' consecutive
+ * 'lanes'-byte elements of src, writing the result to dst. With lanes = 2 or 4, this byteswaps an
+ * array of 16- or 32-bit values.
+ *
+ * 'lanes' must be a power of 2 no larger than 128 (the largest address step the DMAC supports).
+ * 'plane' is scratch space of lanes * count bytes. dst may be the same as src.
+ */
+DmacDescriptor* build_reverse_lanes(DmacDescriptor* descs,
+                                    const volatile void* src,
+                                    volatile void* dst,
+                                    uint8_t* plane,
+                                    uint32_t lanes,
+                                    uint16_t count)
+{
+    const volatile uint8_t* s = src;
+    volatile uint8_t* d = dst;
+
+    uint16_t log2_lanes = 0;
+    while ((1ul << log2_lanes) < lanes) log2_lanes++;
+
+    // gather: plane[k][i] = src[i][k]
+    const uint16_t gather_btctrl = (DMAC_BTCTRL_STEPSIZE(log2_lanes) |
+                                    DMAC_BTCTRL_STEPSEL_SRC |
+                                    DMAC_BTCTRL_DSTINC |
+                                    DMAC_BTCTRL_SRCINC |
+                                    DMAC_BTCTRL_BEATSIZE_BYTE);
+
+    // scatter: dst[i][lanes - 1 - k] = plane[k][i]
+    const uint16_t scatter_btctrl = (DMAC_BTCTRL_STEPSIZE(log2_lanes) |
+                                     DMAC_BTCTRL_STEPSEL_DST |
+                                     DMAC_BTCTRL_DSTINC |
+                                     DMAC_BTCTRL_SRCINC |
+                                     DMAC_BTCTRL_BEATSIZE_BYTE);
+
+    // All gathers have to happen before any scatters so that dst can alias src.
+    for (uint32_t k = 0; k < lanes; k++) {
+        dma_desc_set(&descs[k], gather_btctrl, count,
+                     &s[k], &plane[k * count], &descs[k + 1]);
+    }
+    for (uint32_t k = 0; k < lanes; k++) {
+        dma_desc_set(&descs[lanes + k], scatter_btctrl, count,
+                     &plane[k * count], &d[lanes - 1 - k], &descs[lanes + k + 1]);
+    }
+    return &descs[2 * lanes];
+}
+
+/**
+ * (nbytes / lanes) + (2 * lanes) descriptors. Reverses the nbytes-long buffer src into dst.
+ *
+ * The buffer is treated as (nbytes / lanes) blocks of 'lanes' bytes: first the order of the blocks
+ * is reversed with one block copy per block, then the bytes within every block are reversed with
+ * build_reverse_lanes(). The descriptor count is smallest for lanes near sqrt(nbytes / 2), e.g. a
+ * 4KiB buffer with lanes = 64 takes 192 descriptors instead of 4096.
+ *
+ * 'lanes' must be a power of 2 no larger than 128 that divides nbytes. 'tmp' and 'plane' are each
+ * nbytes bytes of scratch space. dst may be the same as src.
+ */
+DmacDescriptor* build_reverse_buffer(DmacDescriptor* descs,
+                                     const volatile void* src,
+                                     volatile void* dst,
+                                     uint8_t* tmp,
+                                     uint8_t* plane,
+                                     uint32_t lanes,
+                                     uint16_t nbytes)
+{
+    const volatile uint8_t* s = src;
+    const uint16_t blocks = nbytes / lanes;
+
+    DmacDescriptor* d = descs;
+    for (uint16_t b = 0; b < blocks; b++) {
+        d = build_copy(d, &s[b * lanes], &tmp[(blocks - 1 - b) * lanes], lanes);
+    }
+    return build_reverse_lanes(d, tmp, dst, plane, lanes, blocks);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Table lookups
+
+/**
+ * 2 descriptors. *result = table[*index].
+ *
+ * 'table' must start on a 256-byte boundary. 'result' can be a byte of a later descriptor (see
+ * desc_src_byte()), which is how lookups are chained together.
+ */
+DmacDescriptor* build_lookup(DmacDescriptor* descs,
+                             const uint8_t* table,
+                             const volatile uint8_t* index,
+                             volatile uint8_t* result)
+{
+    dma_desc_set(&descs[0], DMAC_BTCTRL_BEATSIZE_BYTE, 1, index, desc_src_byte(&descs[1], 0),
+                 &descs[1]);
+    dma_desc_set(&descs[1], DMAC_BTCTRL_BEATSIZE_BYTE, 1, table, result, &descs[2]);
+    return &descs[2];
+}
+
+/**
+ * 3 descriptors. *result = table[*row][*col].
+ *
+ * 'table' must start on a 256-byte boundary and *row must already be a page number of 'table' (see
+ * lut_add_bias()).
+ */
+DmacDescriptor* build_lookup2(DmacDescriptor* descs,
+                              const uint8_t* table,
+                              const volatile uint8_t* row,
+                              const volatile uint8_t* col,
+                              volatile uint8_t* result)
+{
+    dma_desc_set(&descs[0], DMAC_BTCTRL_BEATSIZE_BYTE, 1, col, desc_src_byte(&descs[2], 0),
+                 &descs[1]);
+    dma_desc_set(&descs[1], DMAC_BTCTRL_BEATSIZE_BYTE, 1, row, desc_src_byte(&descs[2], 1),
+                 &descs[2]);
+    dma_desc_set(&descs[2], DMAC_BTCTRL_BEATSIZE_BYTE, 1, table, result, &descs[3]);
+    return &descs[3];
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Control flow
+//
+// The DMAC has no notion of a branch, but the next descriptor is whatever the current one's
+// DESCADDR says, and DESCADDR can be written by an earlier descriptor just like SRCADDR can. A
+// branch is then a lookup that produces a byte offset into an array of jump targets, followed by a
+// word copy of the chosen target into the DESCADDR of a descriptor further down the chain.
+
+static uint8_t nop_byte;
+
+/**
+ * 4 descriptors. Continues at targets[table[*index] / 4].
+ *
+ * 'table' produces byte offsets into 'targets' (see setup_branch_if_zero()). The offsets replace
+ * the low byte of the address of 'targets', so if targets isn't 256-byte aligned, the table has to
+ * be biased by its low byte with lut_add_bias(). Either way, 'targets' must not cross a 256-byte
+ * boundary.
+ *
+ * Unlike the other builders, the last descriptor isn't linked to the next slot; put the slot in
+ * 'targets' if fall-through is wanted.
+ */
+DmacDescriptor* build_branch(DmacDescriptor* descs,
+                             const uint8_t* table,
+                             const volatile uint8_t* index,
+                             DmacDescriptor* const* targets)
+{
+    build_lookup(&descs[0], table, index, desc_src_byte(&descs[2], 0));
+    dma_desc_set(&descs[2], DMAC_BTCTRL_BEATSIZE_WORD, 1, targets, &descs[3].DESCADDR.reg,
+                 &descs[3]);
+    dma_desc_set(&descs[3], DMAC_BTCTRL_BEATSIZE_BYTE, 1, &nop_byte, &nop_byte, 0);
+    return &descs[4];
+}
+
+/**
+ * 1 descriptor that does nothing. A loop that isn't followed by anything exits onto one of these,
+ * so that the chain can still be continued or terminated like after any other builder.
+ */
+DmacDescriptor* build_nop(DmacDescriptor* descs)
+{
+    dma_desc_set(&descs[0], DMAC_BTCTRL_BEATSIZE_BYTE, 1, &nop_byte, &nop_byte, &descs[1]);
+    return &descs[1];
+}
+
+/**
+ * 5 descriptors. Copies element *index of 'array' to dst.
+ *
+ * 'lo' and 'hi' come from setup_index_to_addr(). Because the descriptor doing the copy increments
+ * its source address, the tables have to give the address just past the element: for an array of
+ * nbytes-long elements, use stride = nbytes and offset = nbytes.
+ */
+DmacDescriptor* build_indexed_copy(DmacDescriptor* descs,
+                                   const volatile void* array,
+                                   const uint8_t* lo,
+                                   const uint8_t* hi,
+                                   const volatile uint8_t* index,
+                                   volatile void* dst,
+                                   uint16_t nbytes)
+{
+    DmacDescriptor* copy = &descs[4];
+
+    build_lookup(&descs[0], lo, index, desc_src_byte(copy, 0));
+    build_lookup(&descs[2], hi, index, desc_src_byte(copy, 1));
+
+    // Only the top 2 bytes of the source address survive the patching above.
+    dma_desc_set(copy, DMAC_BTCTRL_BEATSIZE_BYTE | DMAC_BTCTRL_SRCINC | DMAC_BTCTRL_DSTINC, nbytes,
+                 array, dst, &descs[5]);
+    return &descs[5];
+}
+
+/**
+ * 5 descriptors. Copies nbytes from src to element *index of 'array'. The tables work the same way
+ * as for build_indexed_copy(), since the copy increments its destination address.
+ */
+DmacDescriptor* build_indexed_store(DmacDescriptor* descs,
+                                    volatile void* array,
+                                    const uint8_t* lo,
+                                    const uint8_t* hi,
+                                    const volatile uint8_t* index,
+                                    const volatile void* src,
+                                    uint16_t nbytes)
+{
+    DmacDescriptor* copy = &descs[4];
+
+    build_lookup(&descs[0], lo, index, desc_dst_byte(copy, 0));
+    build_lookup(&descs[2], hi, index, desc_dst_byte(copy, 1));
+
+    // Only the top 2 bytes of the destination address survive the patching above.
+    dma_desc_set(copy, DMAC_BTCTRL_BEATSIZE_BYTE | DMAC_BTCTRL_SRCINC | DMAC_BTCTRL_DSTINC, nbytes,
+                 src, array, &descs[5]);
+    return &descs[5];
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// 8-bit add generator
+//
+// Bytes are added one DIGIT_BITS-wide digit at a time, least significant first, so that the tables
+// involved are small enough to live in SRAM. For each digit:
+//     * the digit of b is looked up as a row of the merge table, the digit of a as a column
+//     * merge[row][col] gives the 0b(a)(b) index into the digit op table
+//     * the flags out of the previous digit pick the page (carry-in) of the digit op table
+// Then the result digits are merged back into a byte. Engines that saturate or reduce do one more
+// 2D lookup, selecting the row from the flags left in the top digit's result.
+//
+// With DIGIT_BITS == 2 the merge result is below 16, so only the first 16 bytes of each digit op
+// table page are ever read. The digit results are biased by ADD8_RESULT_BIAS, which lets the
+// tables indexed by a digit result sit in the unused part of those pages instead of taking pages
+// of their own.
+
+/**
+ * Fills out the tables shared by everything that works on digits. 'mem' must start on a 256-byte
+ * boundary and have room for DIGIT_LUTS_SIZE bytes.
+ */
+void setup_digit_luts(digit_luts_t* luts, uint8_t* mem)
+{
+    uint8_t* p = mem;
+
+    luts->merge = p;
+    setup_digit_merge(p);
+    p += DIGIT_VALUES * 256;
+
+    for (uint32_t i = 0; i < DIGITS_PER_BYTE; i++) {
+        luts->row[i] = p;
+        setup_digit_extract(p, i);
+        lut_add_bias(p, 256, lut_page(luts->merge));
+        p += 256;
+    }
+
+    // The merge table shifts the column up by a digit, which throws away the top bits of the
+    // column for free when there are only 2 digits.
+    for (uint32_t i = 0; i < DIGITS_PER_BYTE; i++) {
+        if ((i == 0) && (DIGITS_PER_BYTE == 2)) {
+            luts->col[i] = 0;
+            continue;
+        }
+        luts->col[i] = p;
+        setup_digit_extract(p, i);
+        p += 256;
+    }
+}
+
+/**
+ * Sets up a digit result -> page table for setup_add8_engine() and returns it. With
+ * DIGIT_BITS == 2 it goes ADD8_RESULT_BIAS bytes into the next digit op table page at *slot;
+ * otherwise it takes the page at *p.
+ */
+static uint8_t* setup_result_to_page(uint8_t** p, uint8_t** slot, uint8_t page)
+{
+#if DIGIT_BITS == 2
+    uint8_t* table = *slot;
+    for (uint32_t r = 0; r < 16; r++) { table[ADD8_RESULT_BIAS + r] = page + (r >> DIGIT_BITS); }
+    *slot += 256;
+#else
+    uint8_t* table = *p;
+    setup_flags_to_page(table, page);
+    *p += 256;
+#endif
+    return table;
+}
+
+/**
+ * Fills out the tables for one add engine. 'mem' must start on a 256-byte boundary and have room
+ * for ADD8_ENGINE_SIZE bytes. 'n' is the modulus for ADD8_MOD_N and is ignored otherwise.
+ *
+ * Returns the number of bytes of 'mem' actually used.
+ */
+uint32_t setup_add8_engine(add8_engine_t* eng,
+                           const digit_luts_t* luts,
+                           add8_kind_t kind,
+                           uint8_t n,
+                           uint8_t* mem)
+{
+    static const uint8_t clamp_max[]    = { 0xff };
+    static const uint8_t clamp_min[]    = { 0x00 };
+    static const uint8_t clamp_signed[] = { 0x7f, 0x80 };    // OVERFLOW_POS, OVERFLOW_NEG
+
+    const int is_sub = ((kind == SUB8_WRAP) || (kind == SUB8_SAT_U) || (kind == SUB8_SAT_S));
+    const int is_signed = ((kind == ADD8_SAT_S) || (kind == SUB8_SAT_S));
+    uint8_t* p = mem;
+    uint8_t* slot = mem;    // the digit op tables come first, and are contiguous
+
+    eng->luts = luts;
+
+    eng->lo_op = p;
+    if (is_sub) setup_digit_subc(p); else setup_digit_addc(p);
+    lut_add_bias(p, 512, ADD8_RESULT_BIAS);
+    p += 512;
+
+    if (is_signed) {
+        eng->hi_op = p;
+        if (is_sub) setup_digit_subc_signed_msd(p); else setup_digit_addc_signed_msd(p);
+        lut_add_bias(p, 512, ADD8_RESULT_BIAS);
+        p += 512;
+    } else {
+        eng->hi_op = eng->lo_op;
+    }
+
+    eng->to_lo_op = setup_result_to_page(&p, &slot, lut_page(eng->lo_op));
+    if (is_signed) {
+        eng->to_hi_op = setup_result_to_page(&p, &slot, lut_page(eng->hi_op));
+    } else {
+        eng->to_hi_op = eng->to_lo_op;
+    }
+
+    eng->fixup = 0;
+    eng->to_fixup = 0;
+    if (kind != ADD8_WRAP && kind != SUB8_WRAP) {
+        uint8_t* fixup = p;
+        switch (kind) {
+            case ADD8_SAT_U: setup_clamp(p, clamp_max, 1);    p += 2 * 256; break;
+            case SUB8_SAT_U: setup_clamp(p, clamp_min, 1);    p += 2 * 256; break;
+            case ADD8_SAT_S:
+            case SUB8_SAT_S: setup_clamp(p, clamp_signed, 2); p += 3 * 256; break;
+            case ADD8_MOD_N: setup_mod_reduce(p, n);          p += 2 * 256; break;
+            default: break;
+        }
+        eng->fixup = fixup;
+        eng->to_fixup = setup_result_to_page(&p, &slot, lut_page(fixup));
+    }
+
+    return (uint32_t)(p - mem);
+}
+
+/**
+ * *out = op[page(op) + flags][a_digit:b_digit], where the digits are pulled out of *a and *b with
+ * 'col_table' and 'row_table'.
+ *
+ * If col_table is NULL, *a is used as the merge column as-is. If row_table is NULL, the row of the
+ * merge lookup is left alone: it's digit 0 unless something else patches it. If 'carry' is NULL
+ * the op uses the first page of 'op'; otherwise 'carry_page' maps *carry (typically the result of
+ * the previous digit) to a page of 'op'.
+ */
+static DmacDescriptor* build_merge_op(DmacDescriptor* d,
+                                      const digit_luts_t* luts,
+                                      const uint8_t* row_table,
+                                      const volatile uint8_t* b,
+                                      const uint8_t* col_table,
+                                      const volatile uint8_t* a,
+                                      const uint8_t* carry_page,
+                                      const volatile uint8_t* carry,
+                                      const uint8_t* op,
+                                      volatile uint8_t* out)
+{
+    DmacDescriptor* merge  = d + (row_table ? 2 : 0) + (col_table ? 2 : 1);
+    DmacDescriptor* lookup = merge + 1 + (carry ? 2 : 0);
+
+    if (row_table) {
+        d = build_lookup(d, row_table, b, desc_src_byte(merge, 1));
+    }
+    if (col_table) {
+        d = build_lookup(d, col_table, a, desc_src_byte(merge, 0));
+    } else {
+        d = build_copy(d, a, desc_src_byte(merge, 0), 1);
+    }
+
+    dma_desc_set(merge, DMAC_BTCTRL_BEATSIZE_BYTE, 1, luts->merge, desc_src_byte(lookup, 0),
+                 merge + 1);
+    d = merge + 1;
+
+    if (carry) {
+        d = build_lookup(d, carry_page, carry, desc_src_byte(lookup, 1));
+    }
+
+    dma_desc_set(lookup, DMAC_BTCTRL_BEATSIZE_BYTE, 1, op, out, lookup + 1);
+    return lookup + 1;
+}
+
+/**
+ * At most 8 descriptors. One digit of a digit-serial op on bytes:
+ * *out = op[page(op) + flags][a_digit:b_digit], where the digits are digit number 'digit' of *a
+ * and *b, and flags come from *carry through 'carry_page' as for build_merge_op().
+ */
+DmacDescriptor* build_digit_op(DmacDescriptor* d,
+                               const digit_luts_t* luts,
+                               uint32_t digit,
+                               const volatile uint8_t* a,
+                               const volatile uint8_t* b,
+                               const uint8_t* carry_page,
+                               const volatile uint8_t* carry,
+                               const uint8_t* op,
+                               volatile uint8_t* out)
+{
+    return build_merge_op(d, luts, luts->row[digit], b, luts->col[digit], a, carry_page, carry, op,
+                          out);
+}
+
+/**
+ * 4 * (DIGITS_PER_BYTE - 1) descriptors. Packs the low digits of digits[0..DIGITS_PER_BYTE-1]
+ * (least significant first) into *out. Anything above the low digit is ignored.
+ */
+DmacDescriptor* build_merge_digits(DmacDescriptor* d,
+                                   const digit_luts_t* luts,
+                                   uint8_t* digits,
+                                   volatile uint8_t* out)
+{
+    const volatile uint8_t* acc = &digits[DIGITS_PER_BYTE - 1];
+
+    for (int i = DIGITS_PER_BYTE - 2; i >= 0; i--) {
+        // acc = merge[row[0][digits[i]]][acc]; the last merge goes straight to 'out'.
+        volatile uint8_t* next = (i == 0) ? out : &digits[i];
+        DmacDescriptor* merge = d + 3;
+        d = build_lookup(d, luts->row[0], &digits[i], desc_src_byte(merge, 1));
+        d = build_copy(d, acc, desc_src_byte(merge, 0), 1);
+        dma_desc_set(merge, DMAC_BTCTRL_BEATSIZE_BYTE, 1, luts->merge, next, merge + 1);
+        d = merge + 1;
+        acc = next;
+    }
+    return d;
+}
+
+/**
+ * At most ADD8_DESCS descriptors. *result = op(*opa, *opb), where op is whatever 'eng' was set up
+ * as.
+ *
+ * 'scratch' is ADD8_SCRATCH bytes of working space that must be private to this instance. If
+ * 'carry_out' is not NULL, it gets the raw top digit result, which holds the carry (or borrow /
+ * overflow class) out of the op above the low DIGIT_BITS bits, plus ADD8_RESULT_BIAS.
+ */
+DmacDescriptor* build_add8(DmacDescriptor* descs,
+                           const add8_engine_t* eng,
+                           const volatile uint8_t* opa,
+                           const volatile uint8_t* opb,
+                           volatile uint8_t* result,
+                           volatile uint8_t* carry_out,
+                           uint8_t* scratch)
+{
+    const digit_luts_t* luts = eng->luts;
+    uint8_t* s = scratch;                        // one result per digit
+    DmacDescriptor* d = descs;
+
+    for (uint32_t i = 0; i < DIGITS_PER_BYTE; i++) {
+        const int top = (i == (DIGITS_PER_BYTE - 1));
+        d = build_digit_op(d, luts, i, opa, opb,
+                           top ? eng->to_hi_op : eng->to_lo_op, (i == 0) ? 0 : &s[i - 1],
+                           top ? eng->hi_op : eng->lo_op, &s[i]);
+    }
+
+    // build_merge_digits() overwrites the lower digit results, but leaves the top one alone.
+    const uint8_t* top = &s[DIGITS_PER_BYTE - 1];
+    if (carry_out) {
+        d = build_copy(d, top, carry_out, 1);
+    }
+
+    if (eng->fixup) {
+        // result = fixup[to_fixup[top]][r]
+        DmacDescriptor* fixup = d + 2 + (4 * (DIGITS_PER_BYTE - 1));
+        d = build_lookup(d, eng->to_fixup, top, desc_src_byte(fixup, 1));
+        d = build_merge_digits(d, luts, s, desc_src_byte(fixup, 0));
+        dma_desc_set(fixup, DMAC_BTCTRL_BEATSIZE_BYTE, 1, eng->fixup, result, fixup + 1);
+        d = fixup + 1;
+    } else {
+        d = build_merge_digits(d, luts, s, result);
+    }
+
+    return d;
+}
+
+
+#if DIGIT_BITS == 4
+////////////////////////////////////////////////////////////////////////////////
+// Dual 2-bit lane ops
+//
+// Narrow values are stored two to a byte, in lanes 1 (bits 3:2) and 0 (bits 1:0). The high nybble
+// of such a byte is ignored. One merge + one dual op lookup then does the work of two separate
+// nybble ops: 5 descriptors per pair instead of 5 per op, plus whatever it takes to get values in
+// and out of their lanes. That's cheapest when results stay packed for the ops that use them.
+//
+// These depend on the digit tables working on nybbles, so they only exist when DIGIT_BITS is 4.
+
+/**
+ * 5 descriptors. *result = table[*x][*y] for two pairs of 2-bit lanes; see setup_dual_lane2_op().
+ */
+DmacDescriptor* build_dual_lane2_op(DmacDescriptor* descs,
+                                    const digit_luts_t* luts,
+                                    const uint8_t* table,
+                                    const volatile uint8_t* x,
+                                    const volatile uint8_t* y,
+                                    volatile uint8_t* result)
+{
+    return build_digit_op(descs, luts, 0, x, y, 0, 0, table, result);
+}
+
+/**
+ * Fills out the tables for build_packed_lane2_ops(). 'mem' must start on a 256-byte boundary and
+ * have room for LANE2_LUTS_SIZE bytes.
+ */
+void setup_lane2_luts(lane2_luts_t* luts, const digit_luts_t* digits, uint8_t* mem)
+{
+    uint8_t* pack     = &mem[0 * 256];
+    uint8_t* pack_row = &mem[1 * 256];
+    uint8_t* lane0    = &mem[2 * 256];
+    uint8_t* lane1    = &mem[3 * 256];
+
+    for (uint32_t count = 0; count < 256; count++) {
+        pack[count] = (((count >> 4) & 0x03) << 2) | (count & 0x03);
+        pack_row[count] = pack[count] + lut_page(digits->merge);
+        lane0[count] = (count >> 0) & 0x03;
+        lane1[count] = (count >> 2) & 0x03;
+    }
+
+    luts->digits   = digits;
+    luts->pack     = pack;
+    luts->pack_row = pack_row;
+    luts->lane[0]  = lane0;
+    luts->lane[1]  = lane1;
+}
+
+// Index of the op before ops[i] that writes 'var', or -1 if it's an input to the batch.
+static int32_t lane2_producer(const lane2_instr_t* ops, uint32_t i, uint16_t var)
+{
+    for (int32_t j = (int32_t)i - 1; j >= 0; j--) {
+        if (ops[j].r == var) return j;
+    }
+    return -1;
+}
+
 /**
- * Setup a chain of dma ucode instructions to add 2 8-bit memory locations.
- * Once the first DMA transfer starts executing, the result location will contain the result
- * after the DMA transfer is complete
+ * At most LANE2_OPS_DESCS(nops) descriptors. Packing pass for a batch of 2-bit ops.
+ *
+ * ops[] refers to variables by number: variable v is vars[v], which holds a value from 0 to 3. An
+ * op may use the result of an earlier op in the batch, but it can't write a variable that an
+ * earlier op has already read or written. Ops are placed in order into 'slots', each of which is
+ * one build_dual_lane2_op() on a byte of 'regs' (nops bytes, private to this chain). A slot is
+ * shared by two ops that use the same table, as long as neither depends on the other.
  *
- * descs is the target location where the 128 Bytes(?) worth of DMA descriptors will be dumped.
+ * The chain packs the operands of each slot into lanes itself: an operand pair that is already
+ * sitting in the lanes of an earlier slot's result is used as it is, and anything else costs a
+ * merge and a pack lookup (5 descriptors). Each result is then looked up out of its lane into
+ * vars[r] (2 descriptors). A slot with one op needs no packing.
+ *
+ * There can be at most LANE2_MAX_OPS ops. Returns NULL if the batch breaks any of the rules above,
+ * otherwise the next free descriptor.
+ */
+DmacDescriptor* build_packed_lane2_ops(DmacDescriptor* descs,
+                                       const lane2_luts_t* luts,
+                                       const lane2_instr_t* ops,
+                                       uint32_t nops,
+                                       volatile uint8_t* vars,
+                                       uint8_t* regs)
+{
+    const digit_luts_t* digits = luts->digits;
+    uint32_t nslots = 0;
+    const uint8_t* slot_table[LANE2_MAX_OPS];
+    int8_t slot_op[LANE2_MAX_OPS][2];    // op in each lane, -1 if the lane is free
+    uint8_t op_slot[LANE2_MAX_OPS];
+    uint8_t op_lane[LANE2_MAX_OPS];
+
+    if (nops > LANE2_MAX_OPS) return 0;
+
+    for (uint32_t i = 0; i < nops; i++) {
+        // The slot has to come after the ones that produce the operands.
+        uint32_t first = 0;
+        for (uint32_t j = 0; j < i; j++) {
+            if ((ops[j].a == ops[i].r) || (ops[j].b == ops[i].r) || (ops[j].r == ops[i].r)) {
+                return 0;
+            }
+            if ((ops[j].r == ops[i].a) || (ops[j].r == ops[i].b)) {
+                if (first < (uint32_t)op_slot[j] + 1) first = op_slot[j] + 1;
+            }
+        }
+
+        uint32_t slot = first;
+        while ((slot < nslots) && !((slot_table[slot] == ops[i].table) &&
+                                    (slot_op[slot][1] < 0))) {
+            slot++;
+        }
+        if (slot == nslots) {
+            slot_table[nslots] = ops[i].table;
+            slot_op[nslots][0] = -1;
+            slot_op[nslots][1] = -1;
+            nslots++;
+        }
+        op_lane[i] = (slot_op[slot][0] < 0) ? 0 : 1;
+        op_slot[i] = slot;
+        slot_op[slot][op_lane[i]] = i;
+    }
+
+    DmacDescriptor* d = descs;
+    for (uint32_t slot = 0; slot < nslots; slot++) {
+        const int32_t lo = slot_op[slot][0];
+        const int32_t hi = slot_op[slot][1];
+        const int32_t top = (hi < 0) ? lo : hi;
+        int32_t src[2];
+
+        // src[k] is the slot whose result already has operand k of both ops in the right lanes.
+        for (int k = 0; k < 2; k++) {
+            const int32_t p_lo = lane2_producer(ops, lo, (k == 0) ? ops[lo].a : ops[lo].b);
+            const int32_t p_hi = lane2_producer(ops, top, (k == 0) ? ops[top].a : ops[top].b);
+
+            src[k] = -1;
+            if ((p_lo >= 0) && (op_lane[p_lo] == 0) &&
+                ((hi < 0) || ((p_hi >= 0) && (op_lane[p_hi] == 1) &&
+                              (op_slot[p_hi] == op_slot[p_lo])))) {
+                src[k] = op_slot[p_lo];
+            }
+        }
+
+        // x (the column of the merge) is used as it is; y has to be turned into a row.
+        const int pack_x = (hi >= 0) && (src[0] < 0);
+        const int pack_y = (hi >= 0) && (src[1] < 0);
+        DmacDescriptor* merge = d + (pack_x ? 5 : 1) + (pack_y ? 5 : 2);
+        DmacDescriptor* lookup = merge + 1;
+
+        if (pack_x) {
+            d = build_merge_op(d, digits, digits->row[0], &vars[ops[lo].a], 0, &vars[ops[hi].a],
+                               0, 0, luts->pack, desc_src_byte(merge, 0));
+        } else {
+            d = build_copy(d, (src[0] >= 0) ? &regs[src[0]] : &vars[ops[lo].a],
+                           desc_src_byte(merge, 0), 1);
+        }
+        if (pack_y) {
+            d = build_merge_op(d, digits, digits->row[0], &vars[ops[lo].b], 0, &vars[ops[hi].b],
+                               0, 0, luts->pack_row, desc_src_byte(merge, 1));
+        } else {
+            d = build_lookup(d, digits->row[0], (src[1] >= 0) ? &regs[src[1]] : &vars[ops[lo].b],
+                             desc_src_byte(merge, 1));
+        }
+
+        dma_desc_set(merge, DMAC_BTCTRL_BEATSIZE_BYTE, 1, digits->merge, desc_src_byte(lookup, 0),
+                     lookup);
+        dma_desc_set(lookup, DMAC_BTCTRL_BEATSIZE_BYTE, 1, slot_table[slot], &regs[slot],
+                     lookup + 1);
+        d = lookup + 1;
+
+        d = build_lookup(d, luts->lane[0], &regs[slot], &vars[ops[lo].r]);
+        if (hi >= 0) {
+            d = build_lookup(d, luts->lane[1], &regs[slot], &vars[ops[hi].r]);
+        }
+    }
+    return d;
+}
+#endif
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Carry-save accumulation
+//
+// Summing many values with repeated ripple adds means splitting every term into digits, rippling a
+// carry through all of them and merging the digits back into bytes, once per term. A carry-save
+// accumulator instead stays in digit form between adds: each digit position holds one addc result,
+// i.e. a sum digit plus the carry that it produced. Adding a term feeds every position its own sum
+// digit, the term's digit and the carry saved by the position below - a 3:2 compression, done with
+// the same addc table that build_add8() uses - and that carry goes no further until the next add.
+// Carries are only propagated all the way once, by build_csa_resolve().
+//
+// An accumulator for an nbytes-long sum is nbytes * DIGITS_PER_BYTE bytes of digits, least
+// significant first, and has to be zeroed before the first add. Carries out of the top digit are
+// dropped, so it has to be wide enough for the whole sum.
+
+/**
+ * Fills out the tables for carry-save accumulation. 'mem' must start on a 256-byte boundary and
+ * have room for CSA_ENGINE_SIZE bytes.
+ */
+void setup_csa_engine(csa_engine_t* eng, const digit_luts_t* luts, uint8_t* mem)
+{
+    eng->luts    = luts;
+    eng->addc    = &mem[0];
+    eng->to_addc = &mem[512];
+    eng->to_row  = &mem[768];
+
+    setup_digit_addc(&mem[0]);
+    setup_flags_to_page(&mem[512], lut_page(eng->addc));
+    setup_flags_to_page(&mem[768], lut_page(luts->merge));
+}
+
+/**
+ * At most CSA_DIGIT_DESCS * nbytes * DIGITS_PER_BYTE descriptors. acc += *x, where x is xbytes
+ * long and xbytes <= nbytes.
+ */
+DmacDescriptor* build_csa_accumulate(DmacDescriptor* descs,
+                                     const csa_engine_t* eng,
+                                     uint8_t* acc,
+                                     uint32_t nbytes,
+                                     const volatile uint8_t* x,
+                                     uint32_t xbytes)
+{
+    const digit_luts_t* luts = eng->luts;
+    DmacDescriptor* d = descs;
+
+    // Work from the top down, so that every position still sees the carry that the position below
+    // saved during the previous add rather than the one it's about to save now.
+    for (int32_t i = (nbytes * DIGITS_PER_BYTE) - 1; i >= 0; i--) {
+        const int in_x = (i < (int32_t)(xbytes * DIGITS_PER_BYTE));
+        d = build_merge_op(d, luts,
+                           in_x ? luts->row[i % DIGITS_PER_BYTE] : 0, in_x ? &x[i / DIGITS_PER_BYTE] : 0,
+                           luts->col[0], &acc[i],
+                           eng->to_addc, (i > 0) ? &acc[i - 1] : 0,
+                           eng->addc, &acc[i]);
+    }
+    return d;
+}
+
+/**
+ * Propagates all of the saved carries in acc and packs the sum into the nbytes-long result.
+ * acc is used as scratch space, so it has to be zeroed again before it's reused.
+ */
+DmacDescriptor* build_csa_resolve(DmacDescriptor* descs,
+                                  const csa_engine_t* eng,
+                                  uint8_t* acc,
+                                  uint32_t nbytes,
+                                  volatile uint8_t* result)
+{
+    const digit_luts_t* luts = eng->luts;
+    const uint32_t n = nbytes * DIGITS_PER_BYTE;
+    const uint32_t col_descs = luts->col[0] ? 2 : 1;
+    DmacDescriptor* ripple = descs + (2 * (n - 1));
+    DmacDescriptor* d = descs;
+
+    // The carry saved by each position becomes the b digit of the position above it. These lookups
+    // have to be done up front, since the ripple below overwrites acc as it goes.
+    for (uint32_t i = 1; i < n; i++) {
+        DmacDescriptor* merge = ripple + (col_descs + 2) + ((i - 1) * (col_descs + 4)) + col_descs;
+        d = build_lookup(d, eng->to_row, &acc[i - 1], desc_src_byte(merge, 1));
+    }
+
+    // acc[i] = addc[carry out of acc[i - 1]][sum digit i : saved carry i]
+    for (uint32_t i = 0; i < n; i++) {
+        d = build_merge_op(d, luts, 0, 0, luts->col[0], &acc[i],
+                           eng->to_addc, (i > 0) ? &acc[i - 1] : 0, eng->addc, &acc[i]);
+    }
+
+    for (uint32_t b = 0; b < nbytes; b++) {
+        d = build_merge_digits(d, luts, &acc[b * DIGITS_PER_BYTE], &result[b]);
+    }
+    return d;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Multi-precision arithmetic
+//
+// Numbers are little-endian arrays of bytes of any length (BN128_BYTES and BN256_BYTES are just
+// the common sizes). Add, subtract and compare run digit-serially over the whole number, passing
+// the carry from digit to digit and byte to byte through the page of the next digit op, so each
+// byte is split and merged exactly once no matter how long the number is.
+//
+// Multiplication is a descriptor loop with one pass per digit of b. Each pass adds a * b_j into a
+// carry-save accumulator (see above) with two sweeps - low digits of the digit products, then high
+// digits - and then shifts the finished digits, the accumulator and the unused digits of b, which
+// share one buffer, down by a digit with a single multi-beat copy. When the code for one digit
+// position is exactly 8 descriptors (128 bytes) long, the row selected by b_j is broadcast into
+// every position with a single strided descriptor.
+
+static const uint8_t zero_byte = 0;
+
+/**
+ * Fills out the tables for multi-precision arithmetic. 'mem' must start on a 256-byte boundary and
+ * have room for BN_ENGINE_SIZE bytes.
  */
-void build_add8_using_nybbles(DmacDescriptor* descs,
-                              uint8_t* opa,
-                              uint8_t* opb,
-                              uint8_t* result)
+void setup_bn_engine(bn_engine_t* eng, const digit_luts_t* luts, uint8_t* mem)
+{
+    eng->luts    = luts;
+    eng->addc    = &mem[0 * 256];
+    eng->subc    = &mem[2 * 256];
+    eng->cmp     = &mem[4 * 256];
+    eng->to_addc = &mem[7 * 256];
+    eng->to_subc = &mem[8 * 256];
+    eng->to_cmp  = &mem[9 * 256];
+    eng->mul_lo  = &mem[10 * 256];
+    eng->mul_hi  = &mem[11 * 256];
+    eng->dec     = &mem[12 * 256];
+    eng->branch  = &mem[13 * 256];
+
+    setup_digit_addc(&mem[0 * 256]);
+    setup_digit_subc(&mem[2 * 256]);
+    setup_digit_compare(&mem[4 * 256]);
+    setup_flags_to_page(&mem[7 * 256], lut_page(eng->addc));
+    setup_flags_to_page(&mem[8 * 256], lut_page(eng->subc));
+    setup_compare_to_page(&mem[9 * 256], lut_page(eng->cmp));
+    setup_digit_mul_lo(&mem[10 * 256]);
+    lut_add_bias(&mem[10 * 256], 256, lut_page(luts->merge));
+    setup_digit_mul_hi(&mem[11 * 256]);
+    lut_add_bias(&mem[11 * 256], 256, lut_page(luts->merge));
+    setup_decrement(&mem[12 * 256]);
+    setup_branch_if_zero(&mem[13 * 256]);
+
+    // The multiplier's accumulator shares the addc table.
+    eng->csa.luts    = luts;
+    eng->csa.addc    = eng->addc;
+    eng->csa.to_addc = eng->to_addc;
+    eng->csa.to_row  = &mem[14 * 256];
+    setup_flags_to_page(&mem[14 * 256], lut_page(luts->merge));
+}
+
+static DmacDescriptor* build_bn_addsub(DmacDescriptor* descs,
+                                       const bn_engine_t* eng,
+                                       const uint8_t* op,
+                                       const uint8_t* to_op,
+                                       const volatile uint8_t* a,
+                                       const volatile uint8_t* b,
+                                       volatile uint8_t* result,
+                                       uint32_t nbytes,
+                                       const volatile uint8_t* carry_in,
+                                       volatile uint8_t* carry_out,
+                                       uint8_t* scratch)
 {
-    // default
-    const uint16_t default_btctrl = ((0 << 13) |  // addr increment long step size: don't care
-                                     (0 << 12) |  // src/dest select for addr inc step: don't care
-                                     (0 << 11) |  // dest increment: disable
-                                     (0 << 10) |  // src  increment: disable
-                                     (0 <<  8) |  // beat size: byte
-                                     (0 <<  3) |  // action on block xfer complete: none
-                                     (0 <<  1) |  // no event on xfer complt
-                                     (1 <<  0));  // descriptor valid
+    const digit_luts_t* luts = eng->luts;
+    const volatile uint8_t* carry = carry_in;
+    DmacDescriptor* d = descs;
+
+    for (uint32_t byte = 0; byte < nbytes; byte++) {
+        for (uint32_t i = 0; i < DIGITS_PER_BYTE; i++) {
+            d = build_digit_op(d, luts, i, &a[byte], &b[byte], to_op, carry, op, &scratch[i]);
+            carry = &scratch[i];
+        }
+
+        // The top digit result survives the merge and carries into the next byte.
+        d = build_merge_digits(d, luts, scratch, &result[byte]);
+    }
 
-    static uint8_t scratch[4];
+    if (carry_out) {
+        d = build_copy(d, carry, carry_out, 1);
+    }
+    return d;
+}
+
+/**
+ * At most BN_ADD_DESCS(nbytes) descriptors. result = a + b + carry, all nbytes long.
+ *
+ * 'carry_in' and 'carry_out' are raw top digit results, as in build_add8(): the carry out of one
+ * add can be fed straight into the next to build longer numbers. Either can be NULL. 'scratch' is
+ * BN_ADD_SCRATCH bytes that must be private to this instance. result may be the same as a or b.
+ */
+DmacDescriptor* build_bn_add(DmacDescriptor* descs,
+                             const bn_engine_t* eng,
+                             const volatile uint8_t* a,
+                             const volatile uint8_t* b,
+                             volatile uint8_t* result,
+                             uint32_t nbytes,
+                             const volatile uint8_t* carry_in,
+                             volatile uint8_t* carry_out,
+                             uint8_t* scratch)
+{
+    return build_bn_addsub(descs, eng, eng->addc, eng->to_addc, a, b, result, nbytes,
+                           carry_in, carry_out, scratch);
+}
 
-    ////////////////////////////////////////
-    // do a single 4-bit add, storing the result in byte nibs_result[0] and carry_result
-    // need to perform an index low_nybble_to_low_nybble[*opa] --> 'nibs_a'
-    descs[0].BTCTRL = default_btctrl;
-    descs[0].BTCNT  = 1;
-    descs[0].SRCADDR = *opa;          // <<< watch out for this one... need another xfer to set ths up.
-    //descs[0].DSTADDR = &nibs_a;
-    descs[0].DSTADDR = &descs[2].SRCADDR;
-    descs[0].DESCADDR = &descs[1];
+/**
+ * At most BN_ADD_DESCS(nbytes) descriptors. result = a - b - borrow, all nbytes long. Same
+ * arguments as build_bn_add(), with borrows in place of carries.
+ */
+DmacDescriptor* build_bn_sub(DmacDescriptor* descs,
+                             const bn_engine_t* eng,
+                             const volatile uint8_t* a,
+                             const volatile uint8_t* b,
+                             volatile uint8_t* result,
+                             uint32_t nbytes,
+                             const volatile uint8_t* borrow_in,
+                             volatile uint8_t* borrow_out,
+                             uint8_t* scratch)
+{
+    return build_bn_addsub(descs, eng, eng->subc, eng->to_subc, a, b, result, nbytes,
+                           borrow_in, borrow_out, scratch);
+}
 
-    // need to perform an index low_nybble_to_low_nybble[*opb] --> 'nibs_b'
-    descs[1].BTCTRL = default_btctrl;
-    descs[1].BTCNT  = 1;
-    descs[1].SRCADDR = *opb;          // <<< need another xfer to set this one up.
-    descs[1].DSTADDR = &descs[2].SRCADDR + 1;
-    descs[1].DESCADDR = &descs[2];
+/**
+ * At most BN_CMP_DESCS(nbytes) descriptors. Compares the unsigned, nbytes-long numbers a and b;
+ * *result is 0x00 if they're equal, 0x01 if a > b and 0xff if a < b.
+ */
+DmacDescriptor* build_bn_cmp(DmacDescriptor* descs,
+                             const bn_engine_t* eng,
+                             const volatile uint8_t* a,
+                             const volatile uint8_t* b,
+                             uint32_t nbytes,
+                             volatile uint8_t* result)
+{
+    const digit_luts_t* luts = eng->luts;
+    DmacDescriptor* d = descs;
 
-    // need to perform an index low_nybble_low_nybble_to_byte[nibs_a][nibs_b] --> nibs_a_b.
-    // SRCADDR field is filled out by previous xfers. Assumes that low_nybble_low_nybble_to_byte is
-    // located on a 64k boundary.
-    descs[2].BTCTRL = default_btctrl;
-    descs[2].BTCNT  = 2;
-    //descs[2].SRCADDR = ();
-    descs[2].DSTADDR = &scratch[2];
-    descs[2].DESCADDR = &descs[2];
+    // The state lives in *result itself; the first digit starts out on the "equal" page.
+    for (int32_t byte = nbytes - 1; byte >= 0; byte--) {
+        for (int32_t i = DIGITS_PER_BYTE - 1; i >= 0; i--) {
+            const int first = ((byte == (int32_t)(nbytes - 1)) && (i == (DIGITS_PER_BYTE - 1)));
+            d = build_digit_op(d, luts, i, &a[byte], &b[byte],
+                               eng->to_cmp, first ? 0 : result, eng->cmp, result);
+        }
+    }
+    return d;
+}
 
+/**
+ * At most BN_MUL_DESCS(abytes, bbytes) descriptors. result = a * b, where result is
+ * abytes + bbytes long.
+ *
+ * 'scratch' is BN_MUL_SCRATCH(abytes, bbytes) bytes that must start on a 256-byte boundary and be
+ * private to this instance; some of it is filled in here. bbytes * DIGITS_PER_BYTE must be less
+ * than 256. a and b are only read at the start of the chain, so result may overlap either one.
+ */
+DmacDescriptor* build_bn_mul(DmacDescriptor* descs,
+                             const bn_engine_t* eng,
+                             const volatile uint8_t* a,
+                             uint32_t abytes,
+                             const volatile uint8_t* b,
+                             uint32_t bbytes,
+                             volatile uint8_t* result,
+                             uint8_t* scratch)
+{
+    const digit_luts_t* luts = eng->luts;
+    const uint32_t na = abytes * DIGITS_PER_BYTE;
+    const uint32_t nb = bbytes * DIGITS_PER_BYTE;
+    const uint32_t col_descs = luts->col[0] ? 2 : 1;
 
-    // need to perform an index nybble_add_no_carryin[nibs_a_b] --> nibs_result[0]
+    // Per position: M (merge b_j with a_k), a copy of M's result for the high digit sweep, L (low
+    // digit of the product, as a merge row) and the accumulating merge op.
+    const uint32_t lo_block = 3 + col_descs + 4;
+    const int broadcast = (lo_block * sizeof(DmacDescriptor) == 128);
+    const uint32_t lo_stride = lo_block + (broadcast ? 0 : 1);
+    const uint32_t hi_block = 1 + col_descs + 4;
 
+    // targets has to be at the start of a page, since eng->branch isn't biased.
+    DmacDescriptor** targets = (DmacDescriptor**)&scratch[0];
+    uint8_t* count = &scratch[8];
+    uint8_t* npasses = &scratch[9];
+    uint8_t* out  = &scratch[16];    // nb finished digits, newest last
+    uint8_t* acc  = &out[nb];        // na + 1 digits of carry-save accumulator
+    uint8_t* brow = &acc[na + 1];    // the digits of b that haven't been used yet, as merge rows
 
-    // need to perform an index nybble_carryout_no_carryin[nibs_a_b] --> carry_result
+    DmacDescriptor* d = descs;
+    *npasses = nb;
 
+    // Work out where the loop body's descriptors will be, so that they can be patched ahead of time.
+    DmacDescriptor* body = d + 2 + (2 * nb);
+    for (uint32_t k = 0; k < na; k++) { body += luts->col[k % DIGITS_PER_BYTE] ? 2 : 1; }
+    DmacDescriptor* lo_first = body + (broadcast ? 1 : 0) + (col_descs + 4);
+    DmacDescriptor* hi_first = lo_first + (na * lo_stride) - 2;
 
-    ////////////////////////////////////////
-    // do a single 4-bit add, storing the result in byte nibs_result[1] and carry_result
-    // need to perform an index low_nybble_to_low_nybble[*opa] --> 'nibs_a'
+    dma_desc_set(d, DMAC_BTCTRL_BEATSIZE_BYTE | DMAC_BTCTRL_DSTINC, na + 1, &zero_byte, acc, d + 1);
+    d = build_copy(d + 1, npasses, count, 1);
+    for (uint32_t j = 0; j < nb; j++) {
+        d = build_lookup(d, luts->row[j % DIGITS_PER_BYTE], &b[j / DIGITS_PER_BYTE], &brow[j]);
+    }
 
+    // The column of every M is a digit of a, which stays the same for every pass.
+    for (uint32_t k = 0; k < na; k++) {
+        DmacDescriptor* m = lo_first + ((na - 1 - k) * lo_stride) + (broadcast ? 0 : 1);
+        const uint8_t* col = luts->col[k % DIGITS_PER_BYTE];
+        if (col) {
+            d = build_lookup(d, col, &a[k / DIGITS_PER_BYTE], desc_src_byte(m, 0));
+        } else {
+            d = build_copy(d, &a[k / DIGITS_PER_BYTE], desc_src_byte(m, 0), 1);
+        }
+    }
 
-    // need to perform an index low_nybble_to_low_nybble[*opb] --> 'nibs_b'
+    // loop body: acc += a * b_j
+    if (broadcast) {
+        dma_desc_set(d, (DMAC_BTCTRL_STEPSIZE_X128 |
+                         DMAC_BTCTRL_STEPSEL_DST |
+                         DMAC_BTCTRL_DSTINC |
+                         DMAC_BTCTRL_BEATSIZE_BYTE),
+                     na, brow, desc_src_byte(lo_first, 1), d + 1);
+        d++;
+    }
 
+    // Low digit sweep, top down. Position na has no product digit, but still has to take the carry
+    // that position na - 1 saved.
+    d = build_merge_op(d, luts, 0, 0, luts->col[0], &acc[na],
+                       eng->to_addc, &acc[na - 1], eng->addc, &acc[na]);
+    for (int32_t k = na - 1; k >= 0; k--) {
+        if (!broadcast) {
+            d = build_copy(d, brow, desc_src_byte(d + 1, 1), 1);
+        }
+        DmacDescriptor* m = d;
+        DmacDescriptor* l = m + 2;
+        DmacDescriptor* l_hi = hi_first + ((na - (k + 1)) * hi_block);
 
-    // need to perform an index low_nybble_low_nybble_to_byte[nibs_a][nibs_b] --> nibs_a_b.
+        dma_desc_set(m, DMAC_BTCTRL_BEATSIZE_BYTE, 1, luts->merge, desc_src_byte(l, 0), m + 1);
+        build_copy(m + 1, desc_src_byte(l, 0), desc_src_byte(l_hi, 0), 1);
+        dma_desc_set(l, DMAC_BTCTRL_BEATSIZE_BYTE, 1, eng->mul_lo,
+                     desc_src_byte(l + 1 + col_descs, 1), l + 1);
+        d = build_merge_op(l + 1, luts, 0, 0, luts->col[0], &acc[k],
+                           eng->to_addc, (k > 0) ? &acc[k - 1] : 0, eng->addc, &acc[k]);
+    }
 
+    // High digit sweep, top down. Position 0 has no product digit and its carry was just taken by
+    // position 1, so it's left alone; whatever flags it still has are ignored from here on.
+    for (uint32_t k = na; k >= 1; k--) {
+        DmacDescriptor* l = d;
+        dma_desc_set(l, DMAC_BTCTRL_BEATSIZE_BYTE, 1, eng->mul_hi,
+                     desc_src_byte(l + 1 + col_descs, 1), l + 1);
+        d = build_merge_op(l + 1, luts, 0, 0, luts->col[0], &acc[k],
+                           eng->to_addc, &acc[k - 1], eng->addc, &acc[k]);
+    }
 
-    // need to perform an index nybble_add[carry_result][nibs_a_b] --> nibs_result[1]
+    // acc[0] is final. Shift it onto the end of out, shift acc down a digit and move on to the
+    // next digit of b, all in one copy. acc[na] picks up a used digit of b and has to be cleared.
+    d = build_copy(d, &out[1], &out[0], (2 * nb) + na);
+    d = build_copy(d, &zero_byte, &acc[na], 1);
+    d = build_lookup(d, eng->dec, count, count);
+    DmacDescriptor* exit = build_branch(d, eng->branch, count, targets);
+    targets[0] = body;
+    targets[1] = exit;
 
+    // after the loop
+    d = exit;
+    for (uint32_t i = 0; i < bbytes; i++) {
+        d = build_merge_digits(d, luts, &out[i * DIGITS_PER_BYTE], &result[i]);
+    }
+    return build_csa_resolve(d, &eng->csa, acc, abytes, &result[bbytes]);
+}
 
-    // need to perform an index nybble_carryout[carry_result][nibs_a_b] --> carry_result
 
+////////////////////////////////////////////////////////////////////////////////
+// Checksums
 
-    ////////////////////////////////////////
-    // combine nibs_result[0] and nibs_result[1].
-    // low_nybble_low_nybble_to_byte[nibs_result[1]][nibs_result[0]] --> *result
+/**
+ * At most CRC8_UPDATE_DESCS descriptors. Folds *byte into the CRC-8 in *crc:
+ * *crc = crc_table[*crc ^ *byte].
+ *
+ * 'xor_table' comes from setup_digit_xor() and 'crc_table' from setup_crc8(). 'scratch' is
+ * DIGITS_PER_BYTE bytes that must be private to this instance.
+ */
+DmacDescriptor* build_crc8_update(DmacDescriptor* descs,
+                                  const digit_luts_t* luts,
+                                  const uint8_t* xor_table,
+                                  const uint8_t* crc_table,
+                                  const volatile uint8_t* byte,
+                                  volatile uint8_t* crc,
+                                  uint8_t* scratch)
+{
+    DmacDescriptor* d = descs;
 
+    for (uint32_t i = 0; i < DIGITS_PER_BYTE; i++) {
+        d = build_digit_op(d, luts, i, crc, byte, 0, 0, xor_table, &scratch[i]);
+    }
 
+    DmacDescriptor* lookup = d + (4 * (DIGITS_PER_BYTE - 1));
+    d = build_merge_digits(d, luts, scratch, desc_src_byte(lookup, 0));
+    dma_desc_set(lookup, DMAC_BTCTRL_BEATSIZE_BYTE, 1, crc_table, crc, lookup + 1);
+    return lookup + 1;
 }
 
 
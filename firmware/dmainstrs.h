@@ -4,4 +4,387 @@
 #include <stdint.h>
 #include "dma.h"
 
+/**
+ * Width in bits of the digits that the table-driven arithmetic works on: 2 or 4.
+ *
+ *   * 4 (nybbles) is the default.
+ *   * 2 needs 12 pages of shared tables instead of 19, and an add engine packs its small tables
+ *     into 7 pages instead of 10, in exchange for about twice as many descriptors per op.
+ *
+ * Whole bytes (a 64KiB table per op) would need tables generated ahead of time into flash, which
+ * the build doesn't do.
+ */
+#ifndef DIGIT_BITS
+#define DIGIT_BITS 4
+#endif
+
+#if (DIGIT_BITS != 2) && (DIGIT_BITS != 4)
+#error "DIGIT_BITS must be 2 or 4"
+#endif
+
+#define DIGITS_PER_BYTE (8 / DIGIT_BITS)
+#define DIGIT_VALUES    (1 << DIGIT_BITS)
+#define DIGIT_MASK      (DIGIT_VALUES - 1)
+
+typedef enum add8_kind {
+    ADD8_WRAP,      // a + b mod 256
+    ADD8_SAT_U,     // a + b, clamped to 0xff
+    ADD8_SAT_S,     // a + b as int8_t, clamped to [-128, 127]
+    SUB8_WRAP,      // a - b mod 256
+    SUB8_SAT_U,     // a - b, clamped to 0
+    SUB8_SAT_S,     // a - b as int8_t, clamped to [-128, 127]
+    ADD8_MOD_N      // a + b mod n, for a, b < n
+} add8_kind_t;
+
+typedef enum lane2_op {
+    LANE2_ADD,
+    LANE2_ADD_SAT,
+    LANE2_SUB,
+    LANE2_EQ,
+    LANE2_LT,
+    LANE2_MIN,
+    LANE2_MAX,
+    LANE2_AND,
+    LANE2_OR,
+    LANE2_XOR
+} lane2_op_t;
+
+////////////////////////////////////////////////////////////////////////////////
+// LUT building functions
+
+/**
+ * Page number (address bits 15:8) of a LUT; this is what gets patched into byte 1 of a descriptor's
+ * SRCADDR to select a row of a 2D table.
+ */
+static inline uint8_t lut_page(const void* base) { return (uint8_t)(((uint32_t)base >> 8) & 0xff); }
+
+void setup_low_nybble_low_nybble_to_byte(uint8_t* base);
+void setup_low_nybble_to_low_nybble(uint8_t* base);
+void setup_low_nybble_to_high_nybble(uint8_t* base);
+void setup_high_nybble_to_high_nybble(uint8_t* base);
+void setup_high_nybble_to_low_nybble(uint8_t* base);
+void setup_nybble_add_no_carryin(uint8_t* base);
+void setup_nybble_add_with_carryin(uint8_t* base);
+void setup_nybble_carryout_no_carryin(uint8_t* base);
+void setup_nybble_carryout_with_carryin(uint8_t* base);
+void setup_nybble_compare_equal(uint8_t* base, uint8_t a, uint8_t b);
+void lut_add_bias(uint8_t* base, uint32_t n, uint8_t bias);
+void setup_digit_merge(uint8_t* base);
+void setup_digit_extract(uint8_t* base, uint32_t digit);
+void setup_flags_to_page(uint8_t* base, uint8_t page);
+void setup_digit_addc(uint8_t* base);
+void setup_digit_subc(uint8_t* base);
+void setup_digit_addc_signed_msd(uint8_t* base);
+void setup_digit_subc_signed_msd(uint8_t* base);
+void setup_clamp(uint8_t* base, const uint8_t* clamp, uint32_t nclamp);
+void setup_mod_reduce(uint8_t* base, uint8_t n);
+void setup_dual_lane2_op(uint8_t* base, lane2_op_t op);
+void setup_decrement(uint8_t* base);
+void setup_branch_if_zero(uint8_t* base);
+void setup_index_to_addr(uint8_t* lo, uint8_t* hi, const volatile void* base, int32_t stride,
+                         int32_t offset);
+void setup_digit_compare(uint8_t* base);
+void setup_compare_to_page(uint8_t* base, uint8_t page);
+void setup_digit_mul_lo(uint8_t* base);
+void setup_digit_mul_hi(uint8_t* base);
+void setup_increment_mod(uint8_t* base, uint32_t n);
+void setup_add_const(uint8_t* base, uint8_t n);
+void setup_carry_to_page(uint8_t* base, uint8_t n, uint8_t carry_page, uint8_t no_carry_page);
+void setup_digit_xor(uint8_t* base);
+void setup_crc8(uint8_t* base, uint8_t poly);
+
+////////////////////////////////////////////////////////////////////////////////
+// Descriptor building helpers
+void dma_desc_set(DmacDescriptor* desc,
+                  uint16_t btctrl,
+                  uint16_t btcnt,
+                  const volatile void* src,
+                  volatile void* dst,
+                  const DmacDescriptor* next);
+void dma_chain_terminate(DmacDescriptor* last);
+
+/**
+ * Address of byte n of a descriptor's SRCADDR. Writing to it from another descriptor is how
+ * table lookups are done.
+ */
+static inline volatile uint8_t* desc_src_byte(DmacDescriptor* desc, int n)
+{
+    return (volatile uint8_t*)&desc->SRCADDR.reg + n;
+}
+
+/**
+ * Address of byte n of a descriptor's DSTADDR, for patching where a later descriptor writes to.
+ */
+static inline volatile uint8_t* desc_dst_byte(DmacDescriptor* desc, int n)
+{
+    return (volatile uint8_t*)&desc->DSTADDR.reg + n;
+}
+
+DmacDescriptor* build_copy(DmacDescriptor* descs,
+                           const volatile void* src,
+                           volatile void* dst,
+                           uint16_t nbytes);
+
+////////////////////////////////////////////////////////////////////////////////
+// Byte order manipulation
+DmacDescriptor* build_bswap16(DmacDescriptor* descs, const volatile void* src, volatile void* dst);
+DmacDescriptor* build_bswap32(DmacDescriptor* descs, const volatile void* src, volatile void* dst);
+DmacDescriptor* build_reverse_lanes(DmacDescriptor* descs,
+                                    const volatile void* src,
+                                    volatile void* dst,
+                                    uint8_t* plane,
+                                    uint32_t lanes,
+                                    uint16_t count);
+DmacDescriptor* build_reverse_buffer(DmacDescriptor* descs,
+                                     const volatile void* src,
+                                     volatile void* dst,
+                                     uint8_t* tmp,
+                                     uint8_t* plane,
+                                     uint32_t lanes,
+                                     uint16_t nbytes);
+
+////////////////////////////////////////////////////////////////////////////////
+// Table lookups
+DmacDescriptor* build_lookup(DmacDescriptor* descs,
+                             const uint8_t* table,
+                             const volatile uint8_t* index,
+                             volatile uint8_t* result);
+DmacDescriptor* build_lookup2(DmacDescriptor* descs,
+                              const uint8_t* table,
+                              const volatile uint8_t* row,
+                              const volatile uint8_t* col,
+                              volatile uint8_t* result);
+
+////////////////////////////////////////////////////////////////////////////////
+// Control flow
+DmacDescriptor* build_branch(DmacDescriptor* descs,
+                             const uint8_t* table,
+                             const volatile uint8_t* index,
+                             DmacDescriptor* const* targets);
+DmacDescriptor* build_nop(DmacDescriptor* descs);
+DmacDescriptor* build_indexed_copy(DmacDescriptor* descs,
+                                   const volatile void* array,
+                                   const uint8_t* lo,
+                                   const uint8_t* hi,
+                                   const volatile uint8_t* index,
+                                   volatile void* dst,
+                                   uint16_t nbytes);
+DmacDescriptor* build_indexed_store(DmacDescriptor* descs,
+                                    volatile void* array,
+                                    const uint8_t* lo,
+                                    const uint8_t* hi,
+                                    const volatile uint8_t* index,
+                                    const volatile void* src,
+                                    uint16_t nbytes);
+
+////////////////////////////////////////////////////////////////////////////////
+// 8-bit add generator
+
+/**
+ * Tables shared by everything that works on digits.
+ */
+typedef struct digit_luts {
+    const uint8_t* merge;                   // DIGIT_VALUES x 256, see setup_digit_merge()
+    const uint8_t* row[DIGITS_PER_BYTE];    // digit i -> row of merge
+    const uint8_t* col[DIGITS_PER_BYTE];    // digit i -> low bits; NULL if the byte can be used as-is
+} digit_luts_t;
+
+/**
+ * An "engine" is the set of tables that makes build_add8() compute one particular kind of add.
+ */
+typedef struct add8_engine {
+    const digit_luts_t* luts;
+    const uint8_t* lo_op;       // 2x256, [carry in][a:b] -> (digit | flags << DIGIT_BITS) + bias
+    const uint8_t* hi_op;       // 2x256, same as lo_op except for signed engines
+    const uint8_t* to_lo_op;    // digit result -> page of lo_op
+    const uint8_t* to_hi_op;    // digit result -> page of hi_op
+    const uint8_t* fixup;       // Nx256, [flags][result] -> final result. NULL if not needed.
+    const uint8_t* to_fixup;    // top digit result -> page of fixup
+} add8_engine_t;
+
+#if DIGIT_BITS == 2
+#define DIGIT_LUTS_SIZE  (12 * 256)
+#define ADD8_ENGINE_SIZE (7 * 256)
+#define ADD8_DESCS       46
+#define ADD8_RESULT_BIAS 16    // where the result-indexed tables sit in the digit op table pages
+#else
+#define DIGIT_LUTS_SIZE  (19 * 256)
+#define ADD8_ENGINE_SIZE (10 * 256)
+#define ADD8_DESCS       21
+#define ADD8_RESULT_BIAS 0
+#endif
+
+#define ADD8_SCRATCH DIGITS_PER_BYTE
+
+void setup_digit_luts(digit_luts_t* luts, uint8_t* mem);
+uint32_t setup_add8_engine(add8_engine_t* eng,
+                           const digit_luts_t* luts,
+                           add8_kind_t kind,
+                           uint8_t n,
+                           uint8_t* mem);
+DmacDescriptor* build_add8(DmacDescriptor* descs,
+                           const add8_engine_t* eng,
+                           const volatile uint8_t* opa,
+                           const volatile uint8_t* opb,
+                           volatile uint8_t* result,
+                           volatile uint8_t* carry_out,
+                           uint8_t* scratch);
+DmacDescriptor* build_digit_op(DmacDescriptor* d,
+                               const digit_luts_t* luts,
+                               uint32_t digit,
+                               const volatile uint8_t* a,
+                               const volatile uint8_t* b,
+                               const uint8_t* carry_page,
+                               const volatile uint8_t* carry,
+                               const uint8_t* op,
+                               volatile uint8_t* out);
+DmacDescriptor* build_merge_digits(DmacDescriptor* d,
+                                   const digit_luts_t* luts,
+                                   uint8_t* digits,
+                                   volatile uint8_t* out);
+
+#if DIGIT_BITS == 4
+////////////////////////////////////////////////////////////////////////////////
+// Dual 2-bit lane ops
+
+#define LANE2_MAX_OPS 64    // per call to build_packed_lane2_ops()
+
+#define LANE2_LUTS_SIZE        (4 * 256)
+#define LANE2_OPS_DESCS(nops)  (8 * (nops))
+
+/**
+ * One narrow op for build_packed_lane2_ops(): r = a op b, where a, b and r are variable numbers.
+ */
+typedef struct lane2_instr {
+    const uint8_t* table;    // from setup_dual_lane2_op()
+    uint16_t a, b, r;
+} lane2_instr_t;
+
+/**
+ * Tables for getting values in and out of lanes; see setup_lane2_luts().
+ */
+typedef struct lane2_luts {
+    const digit_luts_t* digits;
+    const uint8_t* pack;        // merge result (hi << 4 | lo) -> hi << 2 | lo
+    const uint8_t* pack_row;    // the same, as a row of the merge table
+    const uint8_t* lane[2];     // packed byte -> the value in lane i
+} lane2_luts_t;
+
+void setup_lane2_luts(lane2_luts_t* luts, const digit_luts_t* digits, uint8_t* mem);
+DmacDescriptor* build_dual_lane2_op(DmacDescriptor* descs,
+                                    const digit_luts_t* luts,
+                                    const uint8_t* table,
+                                    const volatile uint8_t* x,
+                                    const volatile uint8_t* y,
+                                    volatile uint8_t* result);
+DmacDescriptor* build_packed_lane2_ops(DmacDescriptor* descs,
+                                       const lane2_luts_t* luts,
+                                       const lane2_instr_t* ops,
+                                       uint32_t nops,
+                                       volatile uint8_t* vars,
+                                       uint8_t* regs);
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Carry-save accumulation
+typedef struct csa_engine {
+    const digit_luts_t* luts;
+    const uint8_t* addc;       // setup_digit_addc()
+    const uint8_t* to_addc;    // digit result -> page of addc, for the carry in
+    const uint8_t* to_row;     // digit result -> row of merge, for the saved carry
+} csa_engine_t;
+
+#define CSA_ENGINE_SIZE (4 * 256)
+#define CSA_DIGIT_DESCS ((DIGITS_PER_BYTE == 2) ? 7 : 8)
+
+void setup_csa_engine(csa_engine_t* eng, const digit_luts_t* luts, uint8_t* mem);
+DmacDescriptor* build_csa_accumulate(DmacDescriptor* descs,
+                                     const csa_engine_t* eng,
+                                     uint8_t* acc,
+                                     uint32_t nbytes,
+                                     const volatile uint8_t* x,
+                                     uint32_t xbytes);
+DmacDescriptor* build_csa_resolve(DmacDescriptor* descs,
+                                  const csa_engine_t* eng,
+                                  uint8_t* acc,
+                                  uint32_t nbytes,
+                                  volatile uint8_t* result);
+
+////////////////////////////////////////////////////////////////////////////////
+// Multi-precision arithmetic
+#define BN128_BYTES 16
+#define BN256_BYTES 32
+
+typedef struct bn_engine {
+    const digit_luts_t* luts;
+    const uint8_t* addc;       // setup_digit_addc()
+    const uint8_t* subc;       // setup_digit_subc()
+    const uint8_t* cmp;        // setup_digit_compare()
+    const uint8_t* to_addc;    // digit result -> page of addc
+    const uint8_t* to_subc;    // digit result -> page of subc
+    const uint8_t* to_cmp;     // compare state -> page of cmp
+    const uint8_t* mul_lo;     // [a:b] -> row of merge for the low digit of a * b
+    const uint8_t* mul_hi;     // [a:b] -> row of merge for the high digit of a * b
+    const uint8_t* dec;        // loop counter for build_bn_mul()
+    const uint8_t* branch;     // setup_branch_if_zero(), unbiased
+    csa_engine_t csa;          // accumulator for build_bn_mul()
+} bn_engine_t;
+
+#define BN_ENGINE_SIZE (15 * 256)
+
+#define BN_ADD_SCRATCH DIGITS_PER_BYTE
+#define BN_ADD_DESCS(nbytes) (((nbytes) * ((8 * DIGITS_PER_BYTE) + (4 * (DIGITS_PER_BYTE - 1)))) + 1)
+#define BN_CMP_DESCS(nbytes) ((nbytes) * 8 * DIGITS_PER_BYTE)
+
+#define BN_MUL_SCRATCH(abytes, bbytes) (16 + (((abytes) + (2 * (bbytes))) * DIGITS_PER_BYTE) + 1)
+#define BN_MUL_DESCS(abytes, bbytes)                                         \
+    (17 + (((27 * (abytes)) + (2 * (bbytes))) * DIGITS_PER_BYTE) +           \
+     (4 * (DIGITS_PER_BYTE - 1) * ((abytes) + (bbytes))))
+
+void setup_bn_engine(bn_engine_t* eng, const digit_luts_t* luts, uint8_t* mem);
+DmacDescriptor* build_bn_add(DmacDescriptor* descs,
+                             const bn_engine_t* eng,
+                             const volatile uint8_t* a,
+                             const volatile uint8_t* b,
+                             volatile uint8_t* result,
+                             uint32_t nbytes,
+                             const volatile uint8_t* carry_in,
+                             volatile uint8_t* carry_out,
+                             uint8_t* scratch);
+DmacDescriptor* build_bn_sub(DmacDescriptor* descs,
+                             const bn_engine_t* eng,
+                             const volatile uint8_t* a,
+                             const volatile uint8_t* b,
+                             volatile uint8_t* result,
+                             uint32_t nbytes,
+                             const volatile uint8_t* borrow_in,
+                             volatile uint8_t* borrow_out,
+                             uint8_t* scratch);
+DmacDescriptor* build_bn_cmp(DmacDescriptor* descs,
+                             const bn_engine_t* eng,
+                             const volatile uint8_t* a,
+                             const volatile uint8_t* b,
+                             uint32_t nbytes,
+                             volatile uint8_t* result);
+DmacDescriptor* build_bn_mul(DmacDescriptor* descs,
+                             const bn_engine_t* eng,
+                             const volatile uint8_t* a,
+                             uint32_t abytes,
+                             const volatile uint8_t* b,
+                             uint32_t bbytes,
+                             volatile uint8_t* result,
+                             uint8_t* scratch);
+
+////////////////////////////////////////////////////////////////////////////////
+// Checksums
+#define CRC8_UPDATE_DESCS (2 + (8 * DIGITS_PER_BYTE) + (4 * (DIGITS_PER_BYTE - 1)))
+
+DmacDescriptor* build_crc8_update(DmacDescriptor* descs,
+                                  const digit_luts_t* luts,
+                                  const uint8_t* xor_table,
+                                  const uint8_t* crc_table,
+                                  const volatile uint8_t* byte,
+                                  volatile uint8_t* crc,
+                                  uint8_t* scratch);
+
 #endif
@@ -0,0 +1,206 @@
+/**
+ * SECDED error correction for 8- to 32-bit words, with a check byte per word.
+ *
+ * The code is an extended Hamming code: data bit j of the word sits at the j-th position (counting
+ * from 1) that isn't a power of two, the low 6 bits of the check byte are the XOR of the positions
+ * of the set data bits, and bit 7 makes the parity of the whole codeword even. Bit 6 is unused and
+ * stored as 0. Narrower words use the same code with the missing bytes taken as 0, so every width
+ * shares the tables.
+ *
+ * The check byte is linear in the data, so it's an XOR of one table lookup per data byte, and so
+ * is the syndrome, the check byte recomputed from the loaded word XORed with the stored one. The
+ * parity of the syndrome is the parity of the number of flipped bits, and its low 6 bits are the
+ * XOR of their positions (bits 6 and 7 of the check byte have none), so a single flip gives an odd
+ * syndrome that says where it is, and two give an even one that isn't 0. Correcting is then a
+ * lookup of the syndrome per data byte, for the bit to flip in it, and another XOR.
+ */
+
+#include "ecc.h"
+
+#define ECC_PARITY 0x80
+#define ECC_POSITION 0x3f
+
+static uint32_t parity(uint32_t v)
+{
+    v ^= v >> 4;
+    v ^= v >> 2;
+    v ^= v >> 1;
+    return v & 1;
+}
+
+/**
+ * Position of data bit j, from 3 up.
+ */
+static uint32_t position(uint32_t j)
+{
+    uint32_t p = 2;
+
+    for (uint32_t count = 0; count <= j; count++) {
+        do { p++; } while ((p & (p - 1)) == 0);
+    }
+    return p;
+}
+
+/**
+ * What a syndrome means; shared by the tables and ecc_correct().
+ */
+static ecc_status_t classify(uint8_t syndrome)
+{
+    const uint32_t h = syndrome & ECC_POSITION;
+
+    if (syndrome == 0) { return ECC_OK; }
+    if (!parity(syndrome)) { return ECC_UNCORRECTABLE; }
+
+    // A check bit, or a data bit that exists in the widest word.
+    const int check_bit = (h & (h - 1)) == 0;
+    return (check_bit || (h <= position((8 * ECC_MAX_WIDTH) - 1))) ? ECC_CORRECTED
+                                                                   : ECC_UNCORRECTABLE;
+}
+
+/**
+ * Fills out the tables. 'mem' must start on a 256-byte boundary and have room for ECC_ENGINE_SIZE
+ * bytes.
+ */
+void setup_ecc_engine(ecc_engine_t* eng, const digit_luts_t* luts, uint8_t* mem)
+{
+    uint8_t* xor = &mem[0 * 256];
+    uint8_t* status = &mem[9 * 256];
+
+    eng->luts = luts;
+    eng->xor = xor;
+    eng->status = status;
+    setup_digit_xor(xor);
+
+    for (uint32_t k = 0; k < ECC_MAX_WIDTH; k++) {
+        uint8_t* check = &mem[(1 + k) * 256];
+        uint8_t* fix = &mem[(5 + k) * 256];
+        eng->check[k] = check;
+        eng->fix[k] = fix;
+
+        for (uint32_t count = 0; count < 256; count++) {
+            uint32_t h = 0;
+            for (uint32_t b = 0; b < 8; b++) {
+                if (count & (1 << b)) { h ^= position((8 * k) + b); }
+            }
+            check[count] = h | ((parity(count) ^ parity(h)) ? ECC_PARITY : 0);
+
+            fix[count] = 0;
+            if (classify(count) == ECC_CORRECTED) {
+                for (uint32_t b = 0; b < 8; b++) {
+                    if (position((8 * k) + b) == (count & ECC_POSITION)) { fix[count] = 1 << b; }
+                }
+            }
+        }
+    }
+
+    for (uint32_t count = 0; count < 256; count++) { status[count] = classify(count); }
+}
+
+/**
+ * The check byte for word[0..width-1], on the CPU.
+ */
+uint8_t ecc_check(const uint8_t* word, uint32_t width)
+{
+    uint32_t h = 0;
+    uint32_t ones = 0;
+
+    for (uint32_t j = 0; j < 8 * width; j++) {
+        if (word[j / 8] & (1 << (j % 8))) {
+            h ^= position(j);
+            ones++;
+        }
+    }
+    return h | (((ones & 1) ^ parity(h)) ? ECC_PARITY : 0);
+}
+
+/**
+ * Checks word[0..width-1] against its check byte on the CPU, the same as build_ecc_load(), and
+ * corrects it in place if it can.
+ */
+ecc_status_t ecc_correct(uint8_t* word, uint8_t check, uint32_t width)
+{
+    const uint8_t syndrome = ecc_check(word, width) ^ check;
+    const ecc_status_t status = classify(syndrome);
+
+    // A bit past the end of a narrow word can only come from three or more flips, but like the
+    // tables, it's taken as one that needs no correcting.
+    if (status == ECC_CORRECTED) {
+        for (uint32_t j = 0; j < 8 * width; j++) {
+            if (position(j) == (syndrome & ECC_POSITION)) { word[j / 8] ^= 1 << (j % 8); }
+        }
+    }
+    return status;
+}
+
+/**
+ * At most ECC_XOR_LOOKUP_DESCS descriptors. *x = table[*index] ^ *y. 'scratch' is ECC_SCRATCH
+ * bytes.
+ */
+static DmacDescriptor* build_xor_lookup(DmacDescriptor* d,
+                                        const ecc_engine_t* eng,
+                                        const uint8_t* table,
+                                        const volatile uint8_t* index,
+                                        const volatile uint8_t* y,
+                                        volatile uint8_t* x,
+                                        uint8_t* scratch)
+{
+    uint8_t* t = &scratch[DIGITS_PER_BYTE];
+
+    d = build_lookup(d, table, index, t);
+    for (uint32_t i = 0; i < DIGITS_PER_BYTE; i++) {
+        d = build_digit_op(d, eng->luts, i, y, t, 0, 0, eng->xor, &scratch[i]);
+    }
+    return build_merge_digits(d, eng->luts, scratch, x);
+}
+
+/**
+ * At most ECC_STORE_DESCS(width) descriptors. Stores src[0..width-1] to word[0..width-1] and its
+ * check byte to *check. 'scratch' is ECC_SCRATCH bytes that must be private to this instance.
+ */
+DmacDescriptor* build_ecc_store(DmacDescriptor* descs,
+                                const ecc_engine_t* eng,
+                                uint32_t width,
+                                const volatile uint8_t* src,
+                                volatile uint8_t* word,
+                                volatile uint8_t* check,
+                                uint8_t* scratch)
+{
+    DmacDescriptor* d = descs;
+
+    d = build_copy(d, src, word, width);
+    d = build_lookup(d, eng->check[0], &src[0], check);
+    for (uint32_t k = 1; k < width; k++) {
+        d = build_xor_lookup(d, eng, eng->check[k], &src[k], check, check, scratch);
+    }
+    return d;
+}
+
+/**
+ * At most ECC_LOAD_DESCS(width) descriptors. Loads word[0..width-1] into dst[0..width-1],
+ * correcting a single flipped bit against *check, and sets *status to an ecc_status_t. 'scratch'
+ * is ECC_SCRATCH bytes that must be private to this instance.
+ */
+DmacDescriptor* build_ecc_load(DmacDescriptor* descs,
+                               const ecc_engine_t* eng,
+                               uint32_t width,
+                               const volatile uint8_t* word,
+                               const volatile uint8_t* check,
+                               volatile uint8_t* dst,
+                               volatile uint8_t* status,
+                               uint8_t* scratch)
+{
+    uint8_t* syndrome = &scratch[DIGITS_PER_BYTE + 1];
+    DmacDescriptor* d = descs;
+
+    // Everything after the copy works on dst, so the word is only read once.
+    d = build_copy(d, word, dst, width);
+    d = build_xor_lookup(d, eng, eng->check[0], &dst[0], check, syndrome, scratch);
+    for (uint32_t k = 1; k < width; k++) {
+        d = build_xor_lookup(d, eng, eng->check[k], &dst[k], syndrome, syndrome, scratch);
+    }
+
+    for (uint32_t k = 0; k < width; k++) {
+        d = build_xor_lookup(d, eng, eng->fix[k], syndrome, &dst[k], &dst[k], scratch);
+    }
+    return build_lookup(d, eng->status, syndrome, status);
+}
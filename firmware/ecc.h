@@ -0,0 +1,55 @@
+#ifndef _ECC_H
+#define _ECC_H
+
+#include <stdint.h>
+#include "dma.h"
+#include "dmainstrs.h"
+
+/**
+ * What a checked load found. Anything uncorrectable leaves the loaded word as it was in memory.
+ */
+typedef enum ecc_status {
+    ECC_OK,
+    ECC_CORRECTED,          // one bit was flipped, in the word or its check byte
+    ECC_UNCORRECTABLE       // two bits (or more) were flipped
+} ecc_status_t;
+
+/**
+ * Tables shared by every protected word. See ecc.c for the code.
+ */
+typedef struct ecc_engine {
+    const digit_luts_t* luts;
+    const uint8_t* xor;         // setup_digit_xor()
+    const uint8_t* check[4];    // byte k of a word -> its part of the check byte
+    const uint8_t* fix[4];      // syndrome -> bit to flip in byte k of the word, if any
+    const uint8_t* status;      // syndrome -> ecc_status_t
+} ecc_engine_t;
+
+#define ECC_MAX_WIDTH 4
+#define ECC_ENGINE_SIZE (10 * 256)
+#define ECC_SCRATCH     (DIGITS_PER_BYTE + 2)
+
+#define ECC_XOR_LOOKUP_DESCS  (2 + (8 * DIGITS_PER_BYTE) + (4 * (DIGITS_PER_BYTE - 1)))
+#define ECC_STORE_DESCS(width) (3 + (((width) - 1) * ECC_XOR_LOOKUP_DESCS))
+#define ECC_LOAD_DESCS(width)  (3 + (2 * (width) * ECC_XOR_LOOKUP_DESCS))
+
+void setup_ecc_engine(ecc_engine_t* eng, const digit_luts_t* luts, uint8_t* mem);
+uint8_t ecc_check(const uint8_t* word, uint32_t width);
+ecc_status_t ecc_correct(uint8_t* word, uint8_t check, uint32_t width);
+DmacDescriptor* build_ecc_store(DmacDescriptor* descs,
+                                const ecc_engine_t* eng,
+                                uint32_t width,
+                                const volatile uint8_t* src,
+                                volatile uint8_t* word,
+                                volatile uint8_t* check,
+                                uint8_t* scratch);
+DmacDescriptor* build_ecc_load(DmacDescriptor* descs,
+                               const ecc_engine_t* eng,
+                               uint32_t width,
+                               const volatile uint8_t* word,
+                               const volatile uint8_t* check,
+                               volatile uint8_t* dst,
+                               volatile uint8_t* status,
+                               uint8_t* scratch);
+
+#endif
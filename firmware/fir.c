@@ -0,0 +1,124 @@
+/**
+ * FIR filters with fixed coefficients.
+ *
+ * Every coefficient gets its own pair of tables mapping a sample to the low and high byte of
+ * coefficient * sample, so a tap is one lookup per byte of the product and no multiplication is
+ * done at run time. Samples and coefficients are signed bytes; the tables hold the product as a
+ * 16-bit two's complement number, which is sign-extended to 24 bits on its way into a carry-save
+ * accumulator. Sums wrap modulo 2^24 and come out right as long as they fit in 24 signed bits,
+ * which they always do with FIR_MAX_TAPS taps.
+ *
+ * The delay line is a shift register in scratch memory, newest sample last: one multi-beat copy
+ * moves everything down by a sample, and every tap then reads from a fixed address. Because it's
+ * kept between runs, a long stream can be filtered one block at a time by rerunning the chain on
+ * each block.
+ */
+
+#include "fir.h"
+#include "dmainstrs.h"
+
+static const uint8_t zero_byte = 0;
+
+/**
+ * Generates the tables for filtering with 'coeffs'. 'mem' must start on a 256-byte boundary and
+ * have room for FIR_TABLES_SIZE(ntaps) bytes; ntaps is at most FIR_MAX_TAPS.
+ */
+void setup_fir(fir_t* fir, const int8_t* coeffs, uint32_t ntaps, uint8_t* mem)
+{
+    uint8_t* lo = &mem[0];
+    uint8_t* hi = &mem[ntaps * 256];
+    uint8_t* sext = &mem[2 * ntaps * 256];
+
+    fir->ntaps = ntaps;
+    fir->lo = lo;
+    fir->hi = hi;
+    fir->sext = sext;
+
+    for (uint32_t k = 0; k < ntaps; k++) {
+        for (uint32_t count = 0; count < 256; count++) {
+            uint16_t product = (uint16_t)(coeffs[k] * (int8_t)count);
+            lo[(k * 256) + count] = (product >> 0) & 0xff;
+            hi[(k * 256) + count] = (product >> 8) & 0xff;
+        }
+    }
+    for (uint32_t count = 0; count < 256; count++) { sext[count] = (count & 0x80) ? 0xff : 0x00; }
+}
+
+/**
+ * At most FIR_DESCS(fir->ntaps) descriptors. Filters the n samples at 'in' into 'out':
+ * out[i] = the sum of coeffs[k] * in[i - k] over every tap k, where samples from before in[0] come
+ * from the end of the block that the chain was last run on (zeros the first time). n is at most
+ * FIR_MAX_BLOCK, and neither buffer may cross a 64KiB boundary.
+ *
+ * The chain can be rerun on a new block of samples by copying them into 'in' first. 'scratch' is
+ * FIR_SCRATCH bytes that must start on a 256-byte boundary and be private to this instance; it
+ * holds the delay line, which is cleared here.
+ */
+DmacDescriptor* build_fir(DmacDescriptor* descs,
+                          const bn_engine_t* eng,
+                          const fir_t* fir,
+                          const volatile int8_t* in,
+                          volatile int32_t* out,
+                          uint32_t n,
+                          uint8_t* scratch)
+{
+    const uint32_t ntaps = fir->ntaps;
+
+    // targets has to be at the start of a page, since eng->branch isn't biased.
+    DmacDescriptor** targets = (DmacDescriptor**)&scratch[0];
+    uint8_t* count = &scratch[8];
+    uint8_t* passes = &scratch[9];
+    uint8_t* term = &scratch[12];
+    uint8_t* acc = &scratch[16];
+    uint8_t* sum = &scratch[32];
+    uint8_t* delay = &scratch[128];
+    uint8_t* in_lo = &scratch[1 * 256];
+    uint8_t* in_hi = &scratch[2 * 256];
+    uint8_t* out_lo = &scratch[3 * 256];
+    uint8_t* out_hi = &scratch[4 * 256];
+
+    DmacDescriptor* d = descs;
+
+    // The counter runs from n down to 1, so pass 'count' is sample n - count.
+    *passes = n;
+    setup_index_to_addr(in_lo, in_hi, in, -1, n);
+    setup_index_to_addr(out_lo, out_hi, out, -4, 4 * n);
+    for (uint32_t k = 0; k < ntaps; k++) { delay[k] = 0; }
+
+    d = build_copy(d, passes, count, 1);
+
+    DmacDescriptor* body = d;
+    DmacDescriptor* fetch = body + 4 + ((ntaps > 1) ? 1 : 0);
+    d = build_lookup(d, in_lo, count, desc_src_byte(fetch, 0));
+    d = build_lookup(d, in_hi, count, desc_src_byte(fetch, 1));
+    if (ntaps > 1) {
+        d = build_copy(d, &delay[1], &delay[0], ntaps - 1);
+    }
+    dma_desc_set(d, DMAC_BTCTRL_BEATSIZE_BYTE, 1, in, &delay[ntaps - 1], d + 1);
+    d++;
+
+    dma_desc_set(d, DMAC_BTCTRL_BEATSIZE_BYTE | DMAC_BTCTRL_DSTINC, 3 * DIGITS_PER_BYTE,
+                 &zero_byte, acc, d + 1);
+    d++;
+    for (uint32_t k = 0; k < ntaps; k++) {
+        const volatile uint8_t* x = &delay[ntaps - 1 - k];
+        d = build_lookup(d, &fir->lo[k * 256], x, &term[0]);
+        d = build_lookup(d, &fir->hi[k * 256], x, &term[1]);
+        d = build_lookup(d, fir->sext, &term[1], &term[2]);
+        d = build_csa_accumulate(d, &eng->csa, acc, 3, term, 3);
+    }
+    d = build_csa_resolve(d, &eng->csa, acc, 3, sum);
+    d = build_lookup(d, fir->sext, &sum[2], &sum[3]);
+
+    DmacDescriptor* store = d + 4;
+    d = build_lookup(d, out_lo, count, desc_dst_byte(store, 0));
+    d = build_lookup(d, out_hi, count, desc_dst_byte(store, 1));
+    dma_desc_set(d, DMAC_BTCTRL_BEATSIZE_WORD, 1, sum, out, d + 1);
+    d++;
+
+    d = build_lookup(d, eng->dec, count, count);
+    DmacDescriptor* exit = build_branch(d, eng->branch, count, targets);
+    targets[0] = body;
+    targets[1] = exit;
+    return build_nop(exit);
+}
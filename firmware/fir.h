@@ -0,0 +1,36 @@
+#ifndef _FIR_H
+#define _FIR_H
+
+#include <stdint.h>
+#include "dma.h"
+#include "dmainstrs.h"
+
+/**
+ * Tables for one fixed set of coefficients; see setup_fir().
+ */
+typedef struct fir {
+    uint32_t ntaps;
+    const uint8_t* lo;      // page k: x -> low byte of coeffs[k] * x
+    const uint8_t* hi;      // page k: x -> high byte of coeffs[k] * x
+    const uint8_t* sext;    // v -> 0xff if bit 7 of v is set, otherwise 0
+} fir_t;
+
+#define FIR_MAX_TAPS        128
+#define FIR_MAX_BLOCK       255
+#define FIR_TAP_TABLE_SIZE  (2 * 256)
+#define FIR_TABLES_SIZE(ntaps) (((ntaps) * FIR_TAP_TABLE_SIZE) + 256)
+
+#define FIR_SCRATCH (5 * 256)
+#define FIR_DESCS(ntaps)                                                      \
+    (22 + (36 * DIGITS_PER_BYTE) + ((ntaps) * (6 + (3 * DIGITS_PER_BYTE * CSA_DIGIT_DESCS))))
+
+void setup_fir(fir_t* fir, const int8_t* coeffs, uint32_t ntaps, uint8_t* mem);
+DmacDescriptor* build_fir(DmacDescriptor* descs,
+                          const bn_engine_t* eng,
+                          const fir_t* fir,
+                          const volatile int8_t* in,
+                          volatile int32_t* out,
+                          uint32_t n,
+                          uint8_t* scratch);
+
+#endif
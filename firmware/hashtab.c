@@ -0,0 +1,194 @@
+/**
+ * Open-addressing hash table lookups.
+ *
+ * The hash of a key is its CRC-8, folded in a byte at a time with build_crc8_update(), so the CPU
+ * and the DMAC agree on it just by sharing the table. The slot to look at is patched into the
+ * SRCADDR of a copy that brings the whole slot into scratch memory, where its key is compared
+ * with the one being looked up a digit at a time, most significant digit first, through an
+ * equality table whose "mismatch" page sticks.
+ *
+ * Probing is linear and stops at the first unused slot, so hash_insert() always leaves at least
+ * one slot free; otherwise a lookup of a missing key would never end. There's no deletion.
+ */
+
+#include "hashtab.h"
+
+static const uint8_t hash_zero = 0;
+static const uint8_t hash_one = 1;
+
+/**
+ * Fills out the shared tables. 'mem' must start on a 256-byte boundary and have room for
+ * HASH_ENGINE_SIZE bytes.
+ */
+void setup_hash_engine(hash_engine_t* eng, const digit_luts_t* luts, uint8_t* mem)
+{
+    uint8_t* xor = &mem[0 * 256];
+    uint8_t* crc = &mem[1 * 256];
+    uint8_t* eq = &mem[2 * 256];
+    uint8_t* to_eq = &mem[4 * 256];
+    uint8_t* branch = &mem[5 * 256];
+
+    eng->luts = luts;
+    eng->xor = xor;
+    eng->crc = crc;
+    eng->eq = eq;
+    eng->to_eq = to_eq;
+    eng->branch = branch;
+
+    setup_digit_xor(xor);
+    setup_crc8(crc, 0x07);
+    for (uint32_t count = 0; count < 256; count++) {
+        uint32_t a = (count >> DIGIT_BITS) & DIGIT_MASK;
+        uint32_t b = count & DIGIT_MASK;
+        eq[(0 * 256) + count] = (a == b) ? 0 : 1;
+        eq[(1 * 256) + count] = 1;
+        to_eq[count] = lut_page(eq) + ((count == 0) ? 0 : 1);
+    }
+    setup_branch_if_zero(branch);
+}
+
+/**
+ * Sets up an empty table of 'capacity' slots at 'slots', which must have room for
+ * HASH_SLOTS_SIZE(capacity, key_len, value_len) bytes and not cross a 64KiB boundary. capacity is
+ * at most 256, key_len at most HASH_MAX_KEY, and a slot (1 + key_len + value_len bytes) at most
+ * HASH_MAX_SLOT.
+ */
+void hash_init(hash_table_t* table,
+               const hash_engine_t* eng,
+               uint8_t* slots,
+               uint32_t capacity,
+               uint32_t key_len,
+               uint32_t value_len)
+{
+    table->eng = eng;
+    table->slots = slots;
+    table->capacity = capacity;
+    table->count = 0;
+    table->key_len = key_len;
+    table->value_len = value_len;
+    table->stride = 1 + key_len + value_len;
+
+    for (uint32_t i = 0; i < capacity; i++) { slots[i * table->stride] = 0; }
+}
+
+/**
+ * The hash of a key as the DMAC computes it; the first slot probed is this mod the capacity.
+ */
+uint8_t hash_key(const hash_table_t* table, const uint8_t* key)
+{
+    uint8_t h = 0;
+    for (uint32_t i = 0; i < table->key_len; i++) { h = table->eng->crc[h ^ key[i]]; }
+    return h;
+}
+
+/**
+ * Adds a key, or replaces its value if it's already there. Returns 0 on success and -1 if the
+ * table is full, which is one entry short of its capacity.
+ */
+int hash_insert(hash_table_t* table, const uint8_t* key, const uint8_t* value)
+{
+    uint32_t i = hash_key(table, key) % table->capacity;
+
+    while (1) {
+        uint8_t* slot = &table->slots[i * table->stride];
+        int same = slot[0];
+        for (uint32_t j = 0; same && (j < table->key_len); j++) {
+            if (slot[1 + j] != key[j]) { same = 0; }
+        }
+
+        if (!slot[0] || same) {
+            if (!slot[0]) {
+                if (table->count + 1 >= table->capacity) { return -1; }
+                table->count++;
+            }
+            slot[0] = 1;
+            for (uint32_t j = 0; j < table->key_len; j++) { slot[1 + j] = key[j]; }
+            for (uint32_t j = 0; j < table->value_len; j++) {
+                slot[1 + table->key_len + j] = value[j];
+            }
+            return 0;
+        }
+        i = (i + 1) % table->capacity;
+    }
+}
+
+/**
+ * At most HASH_LOOKUP_DESCS(table->key_len) descriptors. Looks up the key at 'key': if it's in the
+ * table, its value is copied to 'value' and *found is set to 1; otherwise *found is set to 0 and
+ * 'value' is left alone.
+ *
+ * The key is read when the chain runs, and entries can be added with hash_insert() between runs.
+ * 'scratch' is HASH_SCRATCH bytes that must start on a 256-byte boundary and be private to this
+ * instance; it's filled in here.
+ */
+DmacDescriptor* build_hash_lookup(DmacDescriptor* descs,
+                                  const hash_table_t* table,
+                                  const volatile uint8_t* key,
+                                  volatile uint8_t* value,
+                                  volatile uint8_t* found,
+                                  uint8_t* scratch)
+{
+    const hash_engine_t* eng = table->eng;
+    const uint32_t key_len = table->key_len;
+    const uint32_t stride = table->stride;
+
+    // Both branch tables are unbiased, so each set of targets gets the start of a page.
+    DmacDescriptor** used_targets = (DmacDescriptor**)&scratch[0];
+    uint8_t* index = &scratch[8];
+    uint8_t* eq = &scratch[9];
+    uint8_t* crc_scratch = &scratch[16];
+    uint8_t* slot = &scratch[128];
+    DmacDescriptor** eq_targets = (DmacDescriptor**)&scratch[1 * 256];
+    uint8_t* lo = &scratch[2 * 256];
+    uint8_t* hi = &scratch[3 * 256];
+    uint8_t* next = &scratch[4 * 256];
+
+    // Slot tables are indexed by the whole hash, so they do the reduction mod capacity too.
+    for (uint32_t count = 0; count < 256; count++) {
+        uint32_t addr = (uint32_t)&table->slots[((count % table->capacity) + 1) * stride];
+        lo[count] = (addr >> 0) & 0xff;
+        hi[count] = (addr >> 8) & 0xff;
+    }
+    setup_increment_mod(next, table->capacity);
+
+    DmacDescriptor* d = descs;
+
+    d = build_copy(d, &hash_zero, index, 1);
+    for (uint32_t i = 0; i < key_len; i++) {
+        d = build_crc8_update(d, eng->luts, eng->xor, eng->crc, &key[i], index, crc_scratch);
+    }
+
+    DmacDescriptor* probe = d;
+    d = build_indexed_copy(d, table->slots, lo, hi, index, slot, stride);
+    DmacDescriptor* compare = build_branch(d, eng->branch, &slot[0], used_targets);
+
+    d = compare;
+    for (uint32_t i = 0; i < key_len; i++) {
+        for (int32_t j = DIGITS_PER_BYTE - 1; j >= 0; j--) {
+            const int first = ((i == 0) && (j == (DIGITS_PER_BYTE - 1)));
+            d = build_digit_op(d, eng->luts, j, &slot[1 + i], &key[i],
+                               eng->to_eq, first ? 0 : eq, eng->eq, eq);
+        }
+    }
+
+    DmacDescriptor* mismatch = build_branch(d, eng->branch, eq, eq_targets);
+    d = build_lookup(mismatch, next, index, index);
+    (d - 1)->DESCADDR.reg = (uint32_t)probe;
+
+    DmacDescriptor* hit = d;
+    if (table->value_len > 0) {
+        d = build_copy(d, &slot[1 + key_len], value, table->value_len);
+    }
+    d = build_copy(d, &hash_one, found, 1);
+    DmacDescriptor* hit_end = d - 1;
+
+    DmacDescriptor* miss = d;
+    d = build_copy(d, &hash_zero, found, 1);
+    hit_end->DESCADDR.reg = (uint32_t)d;
+
+    used_targets[0] = compare;
+    used_targets[1] = miss;
+    eq_targets[0] = mismatch;
+    eq_targets[1] = hit;
+    return build_nop(d);
+}
@@ -0,0 +1,59 @@
+#ifndef _HASHTAB_H
+#define _HASHTAB_H
+
+#include <stdint.h>
+#include "dma.h"
+#include "dmainstrs.h"
+
+/**
+ * Tables for hashing and comparing keys; shared by every hash table.
+ */
+typedef struct hash_engine {
+    const digit_luts_t* luts;
+    const uint8_t* xor;       // setup_digit_xor()
+    const uint8_t* crc;       // setup_crc8(), the hash function
+    const uint8_t* eq;        // 2x256, [state][a:b] -> 0 while every digit so far matched, else 1
+    const uint8_t* to_eq;     // state -> page of eq
+    const uint8_t* branch;    // setup_branch_if_zero(), unbiased
+} hash_engine_t;
+
+/**
+ * An open-addressing hash table with linear probing. Slot i is 'stride' bytes at
+ * slots + i * stride: a byte that's nonzero if the slot is used, the key, then the value.
+ */
+typedef struct hash_table {
+    const hash_engine_t* eng;
+    uint8_t* slots;
+    uint32_t capacity;        // at most 256
+    uint32_t count;
+    uint8_t key_len;
+    uint8_t value_len;
+    uint8_t stride;
+} hash_table_t;
+
+#define HASH_MAX_KEY   16
+#define HASH_MAX_SLOT  128
+
+#define HASH_ENGINE_SIZE (6 * 256)
+#define HASH_SLOTS_SIZE(capacity, key_len, value_len) ((capacity) * (1 + (key_len) + (value_len)))
+#define HASH_SCRATCH     (5 * 256)
+#define HASH_LOOKUP_DESCS(key_len) \
+    (20 + ((key_len) * (CRC8_UPDATE_DESCS + (8 * DIGITS_PER_BYTE))))
+
+void setup_hash_engine(hash_engine_t* eng, const digit_luts_t* luts, uint8_t* mem);
+void hash_init(hash_table_t* table,
+               const hash_engine_t* eng,
+               uint8_t* slots,
+               uint32_t capacity,
+               uint32_t key_len,
+               uint32_t value_len);
+uint8_t hash_key(const hash_table_t* table, const uint8_t* key);
+int hash_insert(hash_table_t* table, const uint8_t* key, const uint8_t* value);
+DmacDescriptor* build_hash_lookup(DmacDescriptor* descs,
+                                  const hash_table_t* table,
+                                  const volatile uint8_t* key,
+                                  volatile uint8_t* value,
+                                  volatile uint8_t* found,
+                                  uint8_t* scratch);
+
+#endif
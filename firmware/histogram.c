@@ -0,0 +1,431 @@
+/**
+ * Counting bytes with the DMAC.
+ *
+ * Bumping a counter is a lookup whose source is the 'add' table and whose destination is the
+ * counter: the bucket number patches byte 0 of the address that the old count is read from and
+ * of the address that the new count is written to, and the old count patches byte 0 of the
+ * address of the table. 16-bit counters are kept as a plane of low bytes and a plane of high bytes
+ * so that the same bucket number selects both halves. The high byte goes through one more lookup,
+ * into either the identity table or the increment table depending on whether the low byte carried.
+ *
+ * 8-bit counters skip the carry: the old count patches the add lookup, and the add lookup writes
+ * the new count back. They wrap around at 256.
+ *
+ * The code for each element is BUCKET_BLOCK_DESCS descriptors (128 bytes) long, or
+ * BUCKET8_BLOCK_DESCS (32 bytes) for 8-bit counters. A descriptor with a destination step of one
+ * block then scatters the keys of a whole block of elements into one of the places each of them is
+ * needed, so a block of n elements takes 4 descriptors of patching instead of 4n (2 instead of 2n
+ * for 8-bit counters).
+ *
+ * A buffer can also be split between several channels, each counting its part into a histogram of
+ * its own. A merge chain then adds the partial histograms together, one bucket per loop pass.
+ */
+
+#include "histogram.h"
+#include "dmainstrs.h"
+#include "dmac.h"
+
+static const uint8_t zero_byte = 0;
+
+/**
+ * Fills out the tables for counters that go up by 'step'. 'mem' must start on a 256-byte boundary
+ * and have room for COUNT_ENGINE_SIZE bytes.
+ */
+void setup_count_engine(count_engine_t* eng, uint8_t step, uint8_t* mem)
+{
+    eng->step   = step;
+    eng->add    = &mem[0 * 256];
+    eng->carry  = &mem[1 * 256];
+    eng->inc    = &mem[2 * 256];
+    eng->same   = &mem[3 * 256];
+    eng->dec    = &mem[4 * 256];
+    eng->branch = &mem[5 * 256];
+
+    setup_add_const(&mem[0 * 256], step);
+    setup_carry_to_page(&mem[1 * 256], step, lut_page(eng->inc), lut_page(eng->same));
+    setup_add_const(&mem[2 * 256], 1);
+    setup_add_const(&mem[3 * 256], 0);
+    setup_decrement(&mem[4 * 256]);
+    setup_branch_if_zero(&mem[5 * 256]);
+}
+
+/**
+ * BUCKET_ADD16_DESCS descriptors. Adds eng->step to one of the 16-bit counters in 'counters'
+ * (HISTOGRAM16_SIZE bytes, 256-byte aligned). Which one is only known once the chain runs: the
+ * bucket number has to be written to each of the bucket_add16_patch_point()s first.
+ */
+DmacDescriptor* build_bucket_add16(DmacDescriptor* descs,
+                                   const count_engine_t* eng,
+                                   uint8_t* counters)
+{
+    uint8_t* lo = &counters[0];
+    uint8_t* hi = &counters[256];
+
+    // The old low byte goes to both the carry lookup and the add lookup right after it.
+    dma_desc_set(&descs[0], (DMAC_BTCTRL_STEPSIZE_X16 |
+                             DMAC_BTCTRL_STEPSEL_DST |
+                             DMAC_BTCTRL_DSTINC |
+                             DMAC_BTCTRL_BEATSIZE_BYTE),
+                 2, lo, desc_src_byte(&descs[2], 0), &descs[1]);
+    dma_desc_set(&descs[1], DMAC_BTCTRL_BEATSIZE_BYTE, 1, hi, desc_src_byte(&descs[4], 0),
+                 &descs[2]);
+    dma_desc_set(&descs[2], DMAC_BTCTRL_BEATSIZE_BYTE, 1, eng->carry, desc_src_byte(&descs[4], 1),
+                 &descs[3]);
+    dma_desc_set(&descs[3], DMAC_BTCTRL_BEATSIZE_BYTE, 1, eng->add, lo, &descs[4]);
+    dma_desc_set(&descs[4], DMAC_BTCTRL_BEATSIZE_BYTE, 1, eng->same, hi, &descs[5]);
+    return &descs[5];
+}
+
+/**
+ * BUCKET_ADD8_DESCS descriptors. Adds eng->step to one of the 8-bit counters in 'counters'
+ * (HISTOGRAM8_SIZE bytes, 256-byte aligned), wrapping around at 256. The bucket number has to be
+ * written to both of the bucket_add8_patch_point()s first.
+ */
+DmacDescriptor* build_bucket_add8(DmacDescriptor* descs,
+                                  const count_engine_t* eng,
+                                  uint8_t* counters)
+{
+    dma_desc_set(&descs[0], DMAC_BTCTRL_BEATSIZE_BYTE, 1, counters, desc_src_byte(&descs[1], 0),
+                 &descs[1]);
+    dma_desc_set(&descs[1], DMAC_BTCTRL_BEATSIZE_BYTE, 1, eng->add, counters, &descs[2]);
+    return &descs[2];
+}
+
+/**
+ * 1 descriptor. Copies *src to each of the n bytes at first, first + 16, ... i.e. the same byte of
+ * n consecutive descriptors.
+ */
+DmacDescriptor* build_broadcast(DmacDescriptor* descs,
+                                const volatile uint8_t* src,
+                                volatile uint8_t* first,
+                                uint32_t n)
+{
+    dma_desc_set(descs, (DMAC_BTCTRL_STEPSIZE_X16 |
+                         DMAC_BTCTRL_STEPSEL_DST |
+                         DMAC_BTCTRL_DSTINC |
+                         DMAC_BTCTRL_BEATSIZE_BYTE),
+                 n, src, first, descs + 1);
+    return descs + 1;
+}
+
+/**
+ * 1 descriptor. Copies src[j] to the same byte of each of nblocks consecutive blocks of
+ * descriptors; 'stepsize' is the DMAC_BTCTRL_STEPSIZE_ value for the size of a block.
+ */
+static DmacDescriptor* build_strided_scatter(DmacDescriptor* descs,
+                                             const volatile uint8_t* src,
+                                             volatile uint8_t* first,
+                                             uint32_t nblocks,
+                                             uint16_t stepsize)
+{
+    dma_desc_set(descs, (stepsize |
+                         DMAC_BTCTRL_STEPSEL_DST |
+                         DMAC_BTCTRL_DSTINC |
+                         DMAC_BTCTRL_SRCINC |
+                         DMAC_BTCTRL_BEATSIZE_BYTE),
+                 nblocks, src, first, descs + 1);
+    return descs + 1;
+}
+
+/**
+ * 1 descriptor. Copies src[j] to first[j * 128] for j < nblocks, i.e. to the same byte of each of
+ * nblocks consecutive BUCKET_BLOCK_DESCS-long blocks.
+ */
+DmacDescriptor* build_block_scatter(DmacDescriptor* descs,
+                                    const volatile uint8_t* src,
+                                    volatile uint8_t* first,
+                                    uint32_t nblocks)
+{
+    return build_strided_scatter(descs, src, first, nblocks, DMAC_BTCTRL_STEPSIZE_X128);
+}
+
+/**
+ * 1 descriptor. Copies one byte out of each of n esize-byte elements starting at src.
+ */
+static DmacDescriptor* build_key_gather(DmacDescriptor* descs,
+                                        const volatile uint8_t* src,
+                                        uint32_t esize,
+                                        uint32_t n,
+                                        volatile uint8_t* keys)
+{
+    // step sizes are powers of two: X1, X2, X4
+    dma_desc_set(descs, (DMAC_BTCTRL_STEPSIZE(esize >> 1) |
+                         DMAC_BTCTRL_STEPSEL_SRC |
+                         DMAC_BTCTRL_DSTINC |
+                         DMAC_BTCTRL_SRCINC |
+                         DMAC_BTCTRL_BEATSIZE_BYTE),
+                 n, src, keys, descs + 1);
+    return descs + 1;
+}
+
+/**
+ * Counts the n bytes at 'keys' into hist, which has 'width'-byte counters: 2 * width descriptors
+ * of patching, then n blocks of code.
+ */
+static DmacDescriptor* build_count_blocks(DmacDescriptor* descs,
+                                          const count_engine_t* eng,
+                                          uint8_t* hist,
+                                          uint32_t width,
+                                          const volatile uint8_t* keys,
+                                          uint32_t n)
+{
+    DmacDescriptor* blocks = descs + (2 * width);
+    DmacDescriptor* d = descs;
+
+    if (width == 1) {
+        // Blocks are packed back to back, so they fall through into each other.
+        for (int i = 0; i < 2; i++) {
+            d = build_strided_scatter(d, keys, bucket_add8_patch_point(blocks, i), n,
+                                      DMAC_BTCTRL_STEPSIZE_X32);
+        }
+        for (uint32_t j = 0; j < n; j++) {
+            d = build_bucket_add8(&blocks[j * BUCKET8_BLOCK_DESCS], eng, hist);
+        }
+        return d;
+    }
+
+    for (int i = 0; i < 4; i++) {
+        d = build_block_scatter(d, keys, bucket_add16_patch_point(blocks, i), n);
+    }
+
+    for (uint32_t j = 0; j < n; j++) {
+        d = build_bucket_add16(&blocks[j * BUCKET_BLOCK_DESCS], eng, hist);
+        if (j != (n - 1)) { (d - 1)->DESCADDR.reg = (uint32_t)&blocks[(j + 1) * BUCKET_BLOCK_DESCS]; }
+    }
+    return d;
+}
+
+/**
+ * build_histogram8() and build_histogram16(), for 'width'-byte counters.
+ */
+static DmacDescriptor* build_histogram(DmacDescriptor* descs,
+                                       const count_engine_t* eng,
+                                       uint8_t* hist,
+                                       uint32_t width,
+                                       const volatile uint8_t* buf,
+                                       uint32_t n,
+                                       uint32_t esize,
+                                       uint32_t byte,
+                                       uint32_t unroll,
+                                       uint8_t* scratch)
+{
+    const uint32_t npasses = n / unroll;
+    const uint32_t tail = n % unroll;
+
+    // targets has to be at the start of a page, since the branch table isn't biased.
+    DmacDescriptor** targets = (DmacDescriptor**)&scratch[0];
+    uint8_t* count = &scratch[8];
+    uint8_t* passes = &scratch[9];
+    uint8_t* keys = &scratch[128];
+    uint8_t* lo = &scratch[1 * 256];
+    uint8_t* hi = &scratch[2 * 256];
+
+    DmacDescriptor* d = descs;
+
+    // The pass counter is a byte, and 256 passes would store 0 in it.
+    if (npasses >= 256) { return 0; }
+
+    dma_desc_set(d, DMAC_BTCTRL_BEATSIZE_BYTE | DMAC_BTCTRL_DSTINC, width * 256,
+                 &zero_byte, hist, d + 1);
+    d++;
+
+    if (npasses > 0) {
+        // Pass p reads the block at p * stride; the counter runs from npasses down to 1, and the
+        // gather wants the address just past the block.
+        const uint32_t stride = unroll * esize;
+        *passes = npasses;
+        setup_index_to_addr(lo, hi, &buf[byte], -(int32_t)stride, (npasses + 1) * stride);
+
+        d = build_copy(d, passes, count, 1);
+
+        DmacDescriptor* body = d;
+        DmacDescriptor* gather = body + 4;
+        d = build_lookup(d, lo, count, desc_src_byte(gather, 0));
+        d = build_lookup(d, hi, count, desc_src_byte(gather, 1));
+        d = build_key_gather(d, &buf[byte], esize, unroll, keys);
+        d = build_count_blocks(d, eng, hist, width, keys, unroll);
+        d = build_lookup(d, eng->dec, count, count);
+
+        DmacDescriptor* exit = build_branch(d, eng->branch, count, targets);
+        targets[0] = body;
+        targets[1] = exit;
+        d = exit;
+    }
+
+    if (tail > 0) {
+        d = build_key_gather(d, &buf[((n - tail) * esize) + byte], esize, tail, keys);
+        d = build_count_blocks(d, eng, hist, width, keys, tail);
+    } else {
+        d = build_nop(d);
+    }
+    return d;
+}
+
+/**
+ * At most HISTOGRAM_DESCS(unroll) descriptors. Clears hist (HISTOGRAM16_SIZE bytes, 256-byte
+ * aligned) and then, for each of the n esize-byte elements of buf, adds eng->step to the counter
+ * selected by byte 'byte' of the element.
+ *
+ * Elements are counted 'unroll' at a time per loop pass, which is 8 * unroll + 13 descriptors of
+ * which 5 * unroll + 13 run; the leftover n % unroll elements are done after the loop. n / unroll
+ * must be less than 256, unroll at most 128, and esize 1, 2 or 4. buf must not cross a 64KiB
+ * boundary. Returns NULL if n / unroll is too large, otherwise the next free descriptor.
+ *
+ * 'scratch' is HISTOGRAM_SCRATCH bytes of memory that must start on a 256-byte boundary and be
+ * private to this instance. It's filled in here.
+ */
+DmacDescriptor* build_histogram16(DmacDescriptor* descs,
+                                  const count_engine_t* eng,
+                                  uint8_t* hist,
+                                  const volatile uint8_t* buf,
+                                  uint32_t n,
+                                  uint32_t esize,
+                                  uint32_t byte,
+                                  uint32_t unroll,
+                                  uint8_t* scratch)
+{
+    return build_histogram(descs, eng, hist, 2, buf, n, esize, byte, unroll, scratch);
+}
+
+/**
+ * At most HISTOGRAM_DESCS(unroll) descriptors. The same as build_histogram16(), but with 8-bit
+ * counters (HISTOGRAM8_SIZE bytes, 256-byte aligned) that wrap around at 256. A loop pass is
+ * 2 * unroll + 11 descriptors, all of which run.
+ */
+DmacDescriptor* build_histogram8(DmacDescriptor* descs,
+                                 const count_engine_t* eng,
+                                 uint8_t* hist,
+                                 const volatile uint8_t* buf,
+                                 uint32_t n,
+                                 uint32_t esize,
+                                 uint32_t byte,
+                                 uint32_t unroll,
+                                 uint8_t* scratch)
+{
+    return build_histogram(descs, eng, hist, 1, buf, n, esize, byte, unroll, scratch);
+}
+
+/**
+ * At most HISTOGRAM_MERGE_DESCS(width, nparts) descriptors. Adds the nparts - 1 histograms at
+ * 'parts' (one after another, each width * 256 bytes) into hist, bucket by bucket. Counters are
+ * 'width' bytes wide, 1 or 2, and the sums wrap around the same way the counters do.
+ *
+ * 'eng' is only used for its inc and branch tables. nparts is at most HISTOGRAM_MAX_CHANNELS.
+ * 'scratch' is HISTOGRAM_MERGE_SCRATCH bytes that must start on a 256-byte boundary and be private
+ * to this instance.
+ */
+DmacDescriptor* build_histogram_merge(DmacDescriptor* descs,
+                                      const bn_engine_t* bn,
+                                      const count_engine_t* eng,
+                                      uint8_t* hist,
+                                      const uint8_t* parts,
+                                      uint32_t nparts,
+                                      uint32_t width,
+                                      uint8_t* scratch)
+{
+    // targets has to be at the start of a page, since the branch table isn't biased.
+    DmacDescriptor** targets = (DmacDescriptor**)&scratch[0];
+    uint8_t* bucket = &scratch[8];
+    uint8_t* sums = &scratch[16];
+    uint8_t* add_scratch = &scratch[32];
+
+    DmacDescriptor* d = descs;
+
+    d = build_copy(d, &zero_byte, bucket, 1);
+
+    // sums holds this bucket's counter from hist, and then from each of the parts. Every plane is
+    // 256-byte aligned, so the bucket number patches straight into byte 0 of each address.
+    const uint32_t nfetches = nparts * width;
+    DmacDescriptor* body = d;
+    DmacDescriptor* fetch = body + 1;
+    d = build_broadcast(d, bucket, desc_src_byte(fetch, 0), nfetches);
+    for (uint32_t p = 0; p < nparts; p++) {
+        const uint8_t* counters = (p == 0) ? hist : &parts[(p - 1) * width * 256];
+        for (uint32_t i = 0; i < width; i++) {
+            dma_desc_set(d, DMAC_BTCTRL_BEATSIZE_BYTE, 1, &counters[i * 256],
+                         &sums[(p * width) + i], d + 1);
+            d++;
+        }
+    }
+    for (uint32_t p = 1; p < nparts; p++) {
+        d = build_bn_add(d, bn, &sums[0], &sums[p * width], &sums[0], width, 0, 0, add_scratch);
+    }
+
+    DmacDescriptor* store = d + 1;
+    d = build_broadcast(d, bucket, desc_dst_byte(store, 0), width);
+    for (uint32_t i = 0; i < width; i++) {
+        dma_desc_set(d, DMAC_BTCTRL_BEATSIZE_BYTE, 1, &sums[i], &hist[i * 256], d + 1);
+        d++;
+    }
+
+    // bucket 255 wraps around to 0
+    d = build_lookup(d, eng->inc, bucket, bucket);
+    DmacDescriptor* exit = build_branch(d, eng->branch, bucket, targets);
+    targets[0] = body;
+    targets[1] = exit;
+    return build_nop(exit);
+}
+
+/**
+ * At most HISTOGRAM_SPLIT_DESCS(width, unroll, nchannels) descriptors. Lays out a histogram of
+ * 'width'-byte counters (see build_histogram8() and build_histogram16()) that's split between
+ * DMAC channels 0 to nchannels - 1: each channel counts about n / nchannels of the elements, and
+ * then build_histogram_merge() adds the parts together into hist. Every chain is terminated here;
+ * histogram_split_run() runs them.
+ *
+ * Channel 0 counts straight into hist; the others count into 'parts', which is
+ * (nchannels - 1) * width * 256 bytes, 256-byte aligned. Each channel's share of n has to meet
+ * the limits of build_histogram16(), or NULL is returned. 'scratch' is
+ * HISTOGRAM_SPLIT_SCRATCH(nchannels) bytes that must start on a 256-byte boundary and be private
+ * to this instance.
+ */
+DmacDescriptor* build_histogram_split(DmacDescriptor* descs,
+                                      histogram_split_t* split,
+                                      const bn_engine_t* bn,
+                                      const count_engine_t* eng,
+                                      uint8_t* hist,
+                                      uint8_t* parts,
+                                      uint32_t width,
+                                      const volatile uint8_t* buf,
+                                      uint32_t n,
+                                      uint32_t esize,
+                                      uint32_t byte,
+                                      uint32_t unroll,
+                                      uint32_t nchannels,
+                                      uint8_t* scratch)
+{
+    const uint32_t share = n / nchannels;
+    DmacDescriptor* d = descs;
+
+    split->nchannels = nchannels;
+    for (uint32_t c = 0; c < nchannels; c++) {
+        uint8_t* counters = (c == 0) ? hist : &parts[(c - 1) * width * 256];
+        const uint32_t count = (c == (nchannels - 1)) ? (n - (c * share)) : share;
+
+        split->chains[c] = d;
+        d = build_histogram(d, eng, counters, width, &buf[c * share * esize], count, esize, byte,
+                            unroll, &scratch[c * HISTOGRAM_SCRATCH]);
+        if (!d) { return 0; }
+        dma_chain_terminate(d - 1);
+    }
+
+    split->merge = 0;
+    if (nchannels > 1) {
+        split->merge = d;
+        d = build_histogram_merge(d, bn, eng, hist, parts, nchannels, width,
+                                  &scratch[nchannels * HISTOGRAM_SCRATCH]);
+        dma_chain_terminate(d - 1);
+    }
+    return d;
+}
+
+/**
+ * Runs a histogram built by build_histogram_split() to completion: all of the counting channels
+ * at once, and then the merge on channel 0 once they've all finished.
+ */
+void histogram_split_run(const histogram_split_t* split)
+{
+    for (uint32_t c = 0; c < split->nchannels; c++) { dmac_start(c, split->chains[c]); }
+    for (uint32_t c = 0; c < split->nchannels; c++) { while (dmac_busy(c)); }
+    if (split->merge) { dmac_run(0, split->merge); }
+}
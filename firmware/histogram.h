@@ -0,0 +1,139 @@
+#ifndef _HISTOGRAM_H
+#define _HISTOGRAM_H
+
+#include <stdint.h>
+#include "dma.h"
+#include "dmainstrs.h"
+
+/**
+ * Tables for adding a constant to counters that are indexed by a byte; see setup_count_engine().
+ */
+typedef struct count_engine {
+    uint8_t step;
+    const uint8_t* add;       // v -> v + step
+    const uint8_t* carry;     // v -> page of 'inc' if v + step carries out, otherwise page of 'same'
+    const uint8_t* inc;       // v -> v + 1
+    const uint8_t* same;      // v -> v
+    const uint8_t* dec;       // loop counters
+    const uint8_t* branch;    // setup_branch_if_zero(), unbiased
+} count_engine_t;
+
+#define COUNT_ENGINE_SIZE (6 * 256)
+
+// 256 16-bit counters, stored as a plane of low bytes followed by a plane of high bytes.
+#define HISTOGRAM16_SIZE (2 * 256)
+#define HISTOGRAM8_SIZE  256
+
+// Per-element code is laid out in blocks of this many descriptors (128 bytes), so that one strided
+// descriptor can patch the same byte of every block.
+#define BUCKET_BLOCK_DESCS 8
+
+#define BUCKET_ADD16_DESCS 5
+
+/**
+ * Byte i (0 - 3) of the 4 that the bucket number has to be written to before the
+ * build_bucket_add16() descriptors starting at 'add' run.
+ */
+static inline volatile uint8_t* bucket_add16_patch_point(DmacDescriptor* add, int i)
+{
+    return (i < 2) ? desc_src_byte(&add[i], 0) : desc_dst_byte(&add[i + 1], 0);
+}
+
+// 8-bit counters need 2 descriptors (32 bytes) per element.
+#define BUCKET8_BLOCK_DESCS 2
+#define BUCKET_ADD8_DESCS   2
+
+/**
+ * Byte i (0 - 1) of the 2 that the bucket number has to be written to before the
+ * build_bucket_add8() descriptors starting at 'add' run.
+ */
+static inline volatile uint8_t* bucket_add8_patch_point(DmacDescriptor* add, int i)
+{
+    return (i == 0) ? desc_src_byte(&add[0], 0) : desc_dst_byte(&add[1], 0);
+}
+
+#define HISTOGRAM_SCRATCH (3 * 256)
+#define HISTOGRAM_DESCS(unroll) ((16 * (unroll)) + 16)
+
+#define HISTOGRAM_MAX_CHANNELS 4
+
+/**
+ * Where build_histogram_split() put the chain for each channel, and the chain that merges their
+ * results (0 if there's only one channel).
+ */
+typedef struct histogram_split {
+    DmacDescriptor* chains[HISTOGRAM_MAX_CHANNELS];
+    DmacDescriptor* merge;
+    uint32_t nchannels;
+} histogram_split_t;
+
+#define HISTOGRAM_MERGE_SCRATCH 256
+#define HISTOGRAM_MERGE_DESCS(width, nparts)                                  \
+    (10 + ((width) * ((nparts) + 1)) + (((nparts) - 1) * BN_ADD_DESCS(width)))
+
+#define HISTOGRAM_SPLIT_SCRATCH(nchannels)                                     \
+    (((nchannels) * HISTOGRAM_SCRATCH) + HISTOGRAM_MERGE_SCRATCH)
+#define HISTOGRAM_SPLIT_DESCS(width, unroll, nchannels)                        \
+    (((nchannels) * HISTOGRAM_DESCS(unroll)) + HISTOGRAM_MERGE_DESCS(width, nchannels))
+
+void setup_count_engine(count_engine_t* eng, uint8_t step, uint8_t* mem);
+
+DmacDescriptor* build_bucket_add16(DmacDescriptor* descs,
+                                   const count_engine_t* eng,
+                                   uint8_t* counters);
+DmacDescriptor* build_bucket_add8(DmacDescriptor* descs,
+                                  const count_engine_t* eng,
+                                  uint8_t* counters);
+DmacDescriptor* build_broadcast(DmacDescriptor* descs,
+                                const volatile uint8_t* src,
+                                volatile uint8_t* first,
+                                uint32_t n);
+DmacDescriptor* build_block_scatter(DmacDescriptor* descs,
+                                    const volatile uint8_t* src,
+                                    volatile uint8_t* first,
+                                    uint32_t nblocks);
+
+DmacDescriptor* build_histogram16(DmacDescriptor* descs,
+                                  const count_engine_t* eng,
+                                  uint8_t* hist,
+                                  const volatile uint8_t* buf,
+                                  uint32_t n,
+                                  uint32_t esize,
+                                  uint32_t byte,
+                                  uint32_t unroll,
+                                  uint8_t* scratch);
+DmacDescriptor* build_histogram8(DmacDescriptor* descs,
+                                 const count_engine_t* eng,
+                                 uint8_t* hist,
+                                 const volatile uint8_t* buf,
+                                 uint32_t n,
+                                 uint32_t esize,
+                                 uint32_t byte,
+                                 uint32_t unroll,
+                                 uint8_t* scratch);
+
+DmacDescriptor* build_histogram_merge(DmacDescriptor* descs,
+                                      const bn_engine_t* bn,
+                                      const count_engine_t* eng,
+                                      uint8_t* hist,
+                                      const uint8_t* parts,
+                                      uint32_t nparts,
+                                      uint32_t width,
+                                      uint8_t* scratch);
+DmacDescriptor* build_histogram_split(DmacDescriptor* descs,
+                                      histogram_split_t* split,
+                                      const bn_engine_t* bn,
+                                      const count_engine_t* eng,
+                                      uint8_t* hist,
+                                      uint8_t* parts,
+                                      uint32_t width,
+                                      const volatile uint8_t* buf,
+                                      uint32_t n,
+                                      uint32_t esize,
+                                      uint32_t byte,
+                                      uint32_t unroll,
+                                      uint32_t nchannels,
+                                      uint8_t* scratch);
+void histogram_split_run(const histogram_split_t* split);
+
+#endif
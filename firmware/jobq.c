@@ -0,0 +1,327 @@
+/**
+ * A job queue that makes the DMAC a coprocessor: the CPU puts jobs (a program id and argument
+ * pointers) into a ring, and a dispatcher chain on JOBQ_CHANNEL takes them out and runs them.
+ *
+ * A program is any chain that's been built ahead of time, plus the list of its descriptors'
+ * SRCADDR and DSTADDR fields that the job's arguments go in (the "sites"). The CPU works out what
+ * each site should be set to when it submits a job, so the dispatcher only has to copy words:
+ *     * fetch: copy the next slot of the ring to 'current', whether it holds a job or not
+ *     * dispatch: branch on current->program, to the program's bind chain, which patches its
+ *       sites from current->values and goes on to the program itself; or if the slot was free,
+ *       suspend, and fetch the same slot again once resumed
+ *     * finish: the program ends here. Free the slot, set the job's done byte (a block
+ *       interrupt, so TCMPL fires), and fetch the next slot.
+ * The dispatcher follows the ring through each slot's 'next', so it doesn't need an index.
+ *
+ * The CPU only ever writes a free slot and the dispatcher only ever frees a full one, so the ring
+ * doesn't need a lock. 'program' is the first byte of the slot and the last one the CPU writes;
+ * the fetch reads the slot in address order, so a job is never picked up before its values have
+ * landed.
+ *
+ * jobq_submit() resumes the dispatcher, which might not have suspended yet; if so, the resume is
+ * lost. The SUSP interrupt catches that: once the dispatcher has suspended, it's resumed again if
+ * the slot it's waiting on has been filled in the meantime.
+ *
+ * Jobs finish in the order they were submitted, so a job's handle is just how many jobs came
+ * before it. The TCMPL interrupt reaps finished jobs from the front of the ring, calling their
+ * callbacks, and counts them; a job has finished once the count has passed its handle. A slot
+ * isn't reused until its job has been reaped, so the slot is where the callback is kept.
+ */
+
+#include <stddef.h>
+#include "samd21g18a.h"
+#include "jobq.h"
+#include "dmac.h"
+#include "dmainstrs.h"
+
+static const uint8_t jobq_zero = 0;
+static const uint8_t jobq_one = 1;
+
+// The part of a slot that the dispatcher copies out.
+#define JOBQ_FETCH_BYTES offsetof(job_slot_t, callback)
+
+/**
+ * Sets up the ring and the tables, and builds the dispatcher into 'descs', which has room for
+ * JOBQ_DESCS descriptors. The ring has nslots of at most 256; 'scratch' is JOBQ_SCRATCH bytes that
+ * must start on a 256-byte boundary. Programs can be added before or after jobq_start().
+ */
+void jobq_init(jobq_t* q,
+               job_slot_t* ring,
+               uint32_t nslots,
+               uint8_t* scratch,
+               DmacDescriptor* descs)
+{
+    // page 0: jump targets and the current job; page 1: program id -> offset of its target.
+    // targets has to be at the start of a page, since the dispatch table isn't biased.
+    DmacDescriptor** targets = (DmacDescriptor**)&scratch[0];
+    job_slot_t* current = (job_slot_t*)&scratch[128];
+    uint8_t* dispatch = &scratch[1 * 256];
+
+    q->ring = ring;
+    q->nslots = nslots;
+    q->head = 0;
+    q->scratch = scratch;
+    q->current = current;
+    q->tail = 0;
+    q->submitted = 0;
+    q->completed = 0;
+    q->discard = 0;
+
+    for (uint32_t i = 0; i < nslots; i++) {
+        ring[i].program = 0;
+        ring[i].done = &q->discard;
+        ring[i].self = &ring[i].program;
+        ring[i].next = (uint32_t)&ring[(i + 1) % nslots] + JOBQ_FETCH_BYTES;
+        ring[i].callback = 0;
+        ring[i].ctx = 0;
+    }
+
+    // Ids past the last program are skipped, like ids that haven't got a program.
+    for (uint32_t count = 0; count < 256; count++) {
+        const uint32_t id = (count <= JOBQ_MAX_PROGRAMS) ? count : (JOBQ_MAX_PROGRAMS + 1);
+        dispatch[count] = id * 4;
+    }
+
+    DmacDescriptor* d = descs;
+
+    // The first descriptor is copied into the channel when it's started, so it can't be the fetch,
+    // which gets patched.
+    q->start = d;
+    d = build_nop(d);
+
+    q->fetch = d;
+    dma_desc_set(d, DMAC_BTCTRL_BEATSIZE_WORD | DMAC_BTCTRL_SRCINC | DMAC_BTCTRL_DSTINC,
+                 JOBQ_FETCH_BYTES / 4, &ring[0], current, d + 1);
+    d++;
+
+    DmacDescriptor* wait = build_branch(d, dispatch, &current->program, targets);
+    dma_desc_set(wait, DMAC_BTCTRL_BEATSIZE_BYTE | DMAC_BTCTRL_BLOCKACT_SUSPEND, 1,
+                 &jobq_zero, &q->discard, q->fetch);
+    d = wait + 1;
+
+    DmacDescriptor* finish = d;
+    dma_desc_set(&d[0], DMAC_BTCTRL_BEATSIZE_WORD, 1, &current->self, &d[1].DSTADDR.reg, &d[1]);
+    dma_desc_set(&d[1], DMAC_BTCTRL_BEATSIZE_BYTE, 1, &jobq_zero, &q->discard, &d[2]);
+    dma_desc_set(&d[2], DMAC_BTCTRL_BEATSIZE_WORD, 1, &current->done, &d[3].DSTADDR.reg, &d[3]);
+    dma_desc_set(&d[3], DMAC_BTCTRL_BEATSIZE_BYTE | DMAC_BTCTRL_BLOCKACT_INT, 1,
+                 &jobq_one, &q->discard, &d[4]);
+    dma_desc_set(&d[4], DMAC_BTCTRL_BEATSIZE_WORD, 1, &current->next, &q->fetch->SRCADDR.reg,
+                 q->fetch);
+    q->finish = finish;
+
+    targets[0] = wait;
+    for (uint32_t id = 1; id <= JOBQ_MAX_PROGRAMS + 1; id++) { targets[id] = finish; }
+    for (uint32_t id = 0; id <= JOBQ_MAX_PROGRAMS; id++) { q->programs[id].nsites = 0; }
+}
+
+/**
+ * The SRCADDR of 'desc' as a site for argument 'arg'. 'desc' has to be filled in already, so
+ * that the site's offset can be worked out like dma_desc_set() does.
+ */
+job_site_t job_src_site(DmacDescriptor* desc, uint8_t arg)
+{
+    const uint16_t btctrl = desc->BTCTRL.reg;
+    const uint32_t beat = 1ul << ((btctrl & DMAC_BTCTRL_BEATSIZE_Msk) >> DMAC_BTCTRL_BEATSIZE_Pos);
+    const uint32_t step = 1ul << ((btctrl & DMAC_BTCTRL_STEPSIZE_Msk) >> DMAC_BTCTRL_STEPSIZE_Pos);
+    const uint32_t src_step = (btctrl & DMAC_BTCTRL_STEPSEL) ? step : 1;
+
+    job_site_t site = { .field = &desc->SRCADDR.reg, .arg = arg, .offset = 0 };
+    if (btctrl & DMAC_BTCTRL_SRCINC) { site.offset = desc->BTCNT.reg * beat * src_step; }
+    return site;
+}
+
+/**
+ * Likewise for the DSTADDR of 'desc'.
+ */
+job_site_t job_dst_site(DmacDescriptor* desc, uint8_t arg)
+{
+    const uint16_t btctrl = desc->BTCTRL.reg;
+    const uint32_t beat = 1ul << ((btctrl & DMAC_BTCTRL_BEATSIZE_Msk) >> DMAC_BTCTRL_BEATSIZE_Pos);
+    const uint32_t step = 1ul << ((btctrl & DMAC_BTCTRL_STEPSIZE_Msk) >> DMAC_BTCTRL_STEPSIZE_Pos);
+    const uint32_t dst_step = (btctrl & DMAC_BTCTRL_STEPSEL) ? 1 : step;
+
+    job_site_t site = { .field = &desc->DSTADDR.reg, .arg = arg, .offset = 0 };
+    if (btctrl & DMAC_BTCTRL_DSTINC) { site.offset = desc->BTCNT.reg * beat * dst_step; }
+    return site;
+}
+
+/**
+ * Makes the chain from 'first' to 'last' program 'id' (1 - JOBQ_MAX_PROGRAMS), with its arguments
+ * patched into 'sites', and relinks 'last' to the dispatcher. Its bind chain is built into 'descs'
+ * (JOBQ_BIND_DESCS(nsites) descriptors); the descriptor after it is returned.
+ *
+ * A program can't run again before it has finished, so the chain doesn't have to be reentrant,
+ * but anything it leaves behind in scratch memory is still there for the next job.
+ */
+DmacDescriptor* jobq_add_program(jobq_t* q,
+                                 uint8_t id,
+                                 DmacDescriptor* first,
+                                 DmacDescriptor* last,
+                                 const job_site_t* sites,
+                                 uint32_t nsites,
+                                 DmacDescriptor* descs)
+{
+    DmacDescriptor** targets = (DmacDescriptor**)&q->scratch[0];
+    job_program_t* program = &q->programs[id];
+    DmacDescriptor* d = descs;
+
+    program->nsites = nsites;
+    for (uint32_t s = 0; s < nsites; s++) {
+        program->sites[s] = sites[s];
+        dma_desc_set(d, DMAC_BTCTRL_BEATSIZE_WORD, 1, &q->current->values[s], sites[s].field,
+                     d + 1);
+        d++;
+    }
+    if (nsites > 0) { (d - 1)->DESCADDR.reg = (uint32_t)first; }
+    last->DESCADDR.reg = (uint32_t)q->finish;
+
+    // The dispatcher may be running, so the target goes in last, in a single write.
+    targets[id] = (nsites > 0) ? descs : first;
+    return d;
+}
+
+/**
+ * Reaps every finished job at the front of the ring, oldest first.
+ */
+static void jobq_reap(jobq_t* q)
+{
+    while (q->completed != q->submitted) {
+        // The slot's freed before the done byte is set, which is what fires TCMPL, and it can't
+        // be filled again before its job has been reaped.
+        const job_slot_t* slot = &q->ring[q->tail];
+        if (slot->program != 0) { break; }
+
+        // Once it's been counted, the slot can be reused, even by the callback.
+        const job_callback_t callback = slot->callback;
+        void* ctx = slot->ctx;
+        q->tail = (q->tail + 1 == q->nslots) ? 0 : (q->tail + 1);
+        q->completed++;
+        if (callback) { callback(ctx); }
+    }
+}
+
+static void jobq_interrupt(uint8_t channel, uint8_t flags, void* ctx)
+{
+    jobq_t* q = ctx;
+
+    if (flags & DMAC_CHINTFLAG_SUSP) {
+        // The fetch's SRCADDR is still just past the slot that was found free.
+        const job_slot_t* slot = (const job_slot_t*)(q->fetch->SRCADDR.reg - JOBQ_FETCH_BYTES);
+        if (slot->program != 0) { dmac_resume(channel); }
+    }
+    if (flags & DMAC_CHINTFLAG_TCMPL) { jobq_reap(q); }
+}
+
+/**
+ * Starts the dispatcher. It suspends itself right away if there's nothing to do.
+ */
+void jobq_start(jobq_t* q)
+{
+    dmac_set_handler(JOBQ_CHANNEL, DMAC_CHINTENSET_SUSP | DMAC_CHINTENSET_TCMPL,
+                     jobq_interrupt, q);
+    dmac_start(JOBQ_CHANNEL, q->start);
+}
+
+/**
+ * Queues a job; see jobq_submit(). Returns its handle, or JOB_NONE.
+ */
+static job_t jobq_push(jobq_t* q,
+                       uint8_t id,
+                       const void* const* args,
+                       volatile uint8_t* done,
+                       job_callback_t callback,
+                       void* ctx)
+{
+    job_slot_t* slot = &q->ring[q->head];
+    const job_program_t* program = &q->programs[id];
+
+    if ((id == 0) || (id > JOBQ_MAX_PROGRAMS)) { return JOB_NONE; }
+    if ((q->submitted - q->completed) >= q->nslots) { return JOB_NONE; }
+
+    if (done) { *done = 0; }
+    slot->done = done ? done : &q->discard;
+    slot->callback = callback;
+    slot->ctx = ctx;
+    for (uint32_t s = 0; s < program->nsites; s++) {
+        const job_site_t* site = &program->sites[s];
+        slot->values[s] = (uint32_t)args[site->arg] + site->offset;
+    }
+    __DMB();
+    slot->program = id;
+
+    const job_t job = q->submitted & JOB_SEQ_MASK;
+    q->submitted++;
+    q->head = (q->head + 1 == q->nslots) ? 0 : (q->head + 1);
+    dmac_resume(JOBQ_CHANNEL);
+    return job;
+}
+
+/**
+ * Queues program 'id' to run on args[0..], which are whatever its sites expect. *done is cleared
+ * now and set once the job has finished; it can be NULL. Returns 0, or -1 if the ring is full or
+ * there's no such program.
+ */
+int jobq_submit(jobq_t* q, uint8_t id, const void* const* args, volatile uint8_t* done)
+{
+    return (jobq_push(q, id, args, done, 0, 0) == JOB_NONE) ? -1 : 0;
+}
+
+/**
+ * Like jobq_submit(), but returns right away with a handle for jobq_finished() and jobq_wait()
+ * (or JOB_NONE), and calls callback(ctx) from the DMAC interrupt once the job has finished;
+ * 'callback' can be NULL. The ring only has one producer, so a callback mustn't submit jobs unless
+ * nothing outside the DMAC interrupt does.
+ */
+job_t jobq_submit_async(jobq_t* q,
+                        uint8_t id,
+                        const void* const* args,
+                        job_callback_t callback,
+                        void* ctx)
+{
+    return jobq_push(q, id, args, 0, callback, ctx);
+}
+
+/**
+ * 1 once 'job' has finished. Its callback is called by the interrupt that finds out.
+ */
+int jobq_finished(const jobq_t* q, job_t job)
+{
+    // Jobs newer than the oldest one that hasn't been reaped are outstanding.
+    const uint32_t submitted = q->submitted;
+    const uint32_t age = (submitted - (uint32_t)job) & JOB_SEQ_MASK;
+    const uint32_t outstanding = (submitted - q->completed) & JOB_SEQ_MASK;
+    return age > outstanding;
+}
+
+/**
+ * Sleeps until 'job' has finished.
+ */
+void jobq_wait(const jobq_t* q, job_t job)
+{
+    // Interrupts are masked around the check, so that a job can't finish between it and the WFI.
+    // A masked interrupt still ends the WFI, and then gets taken once they're unmasked.
+    __disable_irq();
+    while (!jobq_finished(q, job)) {
+        __WFI();
+        __enable_irq();
+        __disable_irq();
+    }
+    __enable_irq();
+}
+
+/**
+ * 1 once every job that has been submitted has finished.
+ */
+int jobq_idle(const jobq_t* q)
+{
+    for (uint32_t i = 0; i < q->nslots; i++) {
+        if (q->ring[i].program != 0) { return 0; }
+    }
+    return 1;
+}
+
+void jobq_stop(jobq_t* q)
+{
+    dmac_stop(JOBQ_CHANNEL);
+    dmac_set_handler(JOBQ_CHANNEL, 0, 0, 0);
+}
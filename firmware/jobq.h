@@ -0,0 +1,105 @@
+#ifndef _JOBQ_H
+#define _JOBQ_H
+
+#include <stdint.h>
+#include "dma.h"
+
+#define JOBQ_MAX_PROGRAMS 15    // program ids are 1 - 15; 0 marks a free slot
+#define JOBQ_MAX_SITES    8
+
+#define JOBQ_SCRATCH (2 * 256)
+#define JOBQ_DESCS   12
+#define JOBQ_BIND_DESCS(nsites) (nsites)
+
+/**
+ * Called from the DMAC interrupt once a job submitted with jobq_submit_async() has finished.
+ */
+typedef void (*job_callback_t)(void* ctx);
+
+/**
+ * A job submitted with jobq_submit_async(), or JOB_NONE if it couldn't be. Handles count jobs
+ * modulo 2^31, so one can be waited on until 2^31 more jobs have been submitted after it.
+ */
+typedef int32_t job_t;
+#define JOB_NONE     (-1)
+#define JOB_SEQ_MASK 0x7ffffffful
+
+/**
+ * One job in the ring. The CPU fills in everything else before it sets 'program', and the
+ * dispatcher sets 'program' back to 0 once it has copied the job out and run it.
+ */
+typedef struct job_slot {
+    volatile uint8_t program;
+    uint8_t unused[3];
+    volatile uint8_t* done;       // set to 1 when the job has finished
+    const volatile uint8_t* self; // &program, for the dispatcher to free the slot with
+    uint32_t next;                // address just past the next slot's fetched part
+    uint32_t values[JOBQ_MAX_SITES];
+
+    // The dispatcher doesn't fetch the rest.
+    job_callback_t callback;
+    void* ctx;
+} job_slot_t;
+
+/**
+ * A place in a program's descriptors that an argument of the job gets patched into: the SRCADDR
+ * or DSTADDR of one of them, which has to be set to argument 'arg' + 'offset'.
+ */
+typedef struct job_site {
+    volatile uint32_t* field;
+    uint8_t arg;
+    uint32_t offset;      // the length of the transfer if the address is incremented, else 0
+} job_site_t;
+
+typedef struct job_program {
+    uint32_t nsites;
+    job_site_t sites[JOBQ_MAX_SITES];
+} job_program_t;
+
+/**
+ * A single-producer / single-consumer job ring, with the CPU producing and a chain on
+ * JOBQ_CHANNEL consuming. See jobq.c.
+ */
+typedef struct jobq {
+    job_slot_t* ring;
+    uint32_t nslots;
+    uint32_t head;                  // next slot the CPU fills
+    uint8_t* scratch;
+    job_slot_t* current;            // the job being run, copied out of the ring
+    DmacDescriptor* start;
+    DmacDescriptor* fetch;
+    DmacDescriptor* finish;
+    job_program_t programs[JOBQ_MAX_PROGRAMS + 1];
+    uint32_t tail;                  // slot of the oldest job that hasn't been reaped
+    volatile uint32_t submitted;    // jobs so far
+    volatile uint32_t completed;    // jobs reaped so far, always in the order they were submitted
+    volatile uint8_t discard;       // where the done byte of a job that doesn't have one goes
+} jobq_t;
+
+void jobq_init(jobq_t* q,
+               job_slot_t* ring,
+               uint32_t nslots,
+               uint8_t* scratch,
+               DmacDescriptor* descs);
+job_site_t job_src_site(DmacDescriptor* desc, uint8_t arg);
+job_site_t job_dst_site(DmacDescriptor* desc, uint8_t arg);
+DmacDescriptor* jobq_add_program(jobq_t* q,
+                                 uint8_t id,
+                                 DmacDescriptor* first,
+                                 DmacDescriptor* last,
+                                 const job_site_t* sites,
+                                 uint32_t nsites,
+                                 DmacDescriptor* descs);
+void jobq_start(jobq_t* q);
+int jobq_submit(jobq_t* q, uint8_t id, const void* const* args, volatile uint8_t* done);
+job_t jobq_submit_async(jobq_t* q,
+                        uint8_t id,
+                        const void* const* args,
+                        job_callback_t callback,
+                        void* ctx);
+int jobq_finished(const jobq_t* q, job_t job);
+void jobq_wait(const jobq_t* q, job_t job);
+int jobq_idle(const jobq_t* q);
+void jobq_stop(jobq_t* q);
+
+#endif
@@ -1,12 +1,26 @@
 #include "samd21g18a.h"
 #include <stdint.h>
 
+#include "dmac.h"
+
+#ifdef BENCH
+#include "bench.h"
+#endif
+
 void init_hardware();
 
 int main()
 {
 
     uint8_t choffset = 0;
+
+    init_hardware();
+    dmac_init();
+
+#ifdef BENCH
+    bench_run_all();
+#endif
+
     while (1) {
 
     }
@@ -0,0 +1,166 @@
+/**
+ * Dot products and matrix multiplication on unsigned bytes.
+ *
+ * A dot product is a descriptor loop with one pass per pair of elements. Each pass fetches the
+ * pair through index-to-address tables, so either operand can have any stride, multiplies them
+ * with build_bn_mul() (digit products straight out of the multiply tables) and adds the 16-bit
+ * product into a carry-save accumulator. The carries are only propagated once, after the loop.
+ *
+ * A matrix multiply runs one dot product per element of the result. There's only one copy of the
+ * dot product code: every element copies its row and column into the kernel's operand buffers,
+ * writes its own return address into the last descriptor of the kernel and jumps in.
+ */
+
+#include "matmul.h"
+#include "dmainstrs.h"
+
+static const uint8_t zero_byte = 0;
+
+/**
+ * At most DOT_PRODUCT_DESCS - 1 descriptors. Sums x[i * xstride] * y[i * ystride] over i < n into
+ * the DOT_ACC_BYTES-long 'result'. 'scratch' is DOT_PRODUCT_SCRATCH bytes, 256-byte aligned.
+ */
+static DmacDescriptor* build_dot_loop(DmacDescriptor* descs,
+                                      const bn_engine_t* eng,
+                                      const volatile uint8_t* x,
+                                      int32_t xstride,
+                                      const volatile uint8_t* y,
+                                      int32_t ystride,
+                                      uint32_t n,
+                                      volatile uint8_t* result,
+                                      uint8_t* scratch)
+{
+    // targets has to be at the start of a page, since eng->branch isn't biased. Bytes 32 - 35 are
+    // left for build_matmul().
+    DmacDescriptor** targets = (DmacDescriptor**)&scratch[0];
+    uint8_t* count = &scratch[8];
+    uint8_t* passes = &scratch[9];
+    uint8_t* xv = &scratch[10];
+    uint8_t* yv = &scratch[11];
+    uint8_t* product = &scratch[12];
+    uint8_t* acc = &scratch[16];
+    uint8_t* mul_scratch = &scratch[1 * 256];
+    uint8_t* xlo = &scratch[2 * 256];
+    uint8_t* xhi = &scratch[3 * 256];
+    uint8_t* ylo = &scratch[4 * 256];
+    uint8_t* yhi = &scratch[5 * 256];
+
+    DmacDescriptor* d = descs;
+
+    // The counter runs from n down to 1, so pass 'count' is element n - count.
+    *passes = n;
+    setup_index_to_addr(xlo, xhi, x, -xstride, n * xstride);
+    setup_index_to_addr(ylo, yhi, y, -ystride, n * ystride);
+
+    dma_desc_set(d, DMAC_BTCTRL_BEATSIZE_BYTE | DMAC_BTCTRL_DSTINC, DOT_ACC_BYTES * DIGITS_PER_BYTE,
+                 &zero_byte, acc, d + 1);
+    d = build_copy(d + 1, passes, count, 1);
+
+    DmacDescriptor* body = d;
+    DmacDescriptor* fetch = body + 8;
+    d = build_lookup(d, xlo, count, desc_src_byte(&fetch[0], 0));
+    d = build_lookup(d, xhi, count, desc_src_byte(&fetch[0], 1));
+    d = build_lookup(d, ylo, count, desc_src_byte(&fetch[1], 0));
+    d = build_lookup(d, yhi, count, desc_src_byte(&fetch[1], 1));
+    dma_desc_set(d, DMAC_BTCTRL_BEATSIZE_BYTE, 1, x, xv, d + 1); d++;
+    dma_desc_set(d, DMAC_BTCTRL_BEATSIZE_BYTE, 1, y, yv, d + 1); d++;
+
+    d = build_bn_mul(d, eng, xv, 1, yv, 1, product, mul_scratch);
+    d = build_csa_accumulate(d, &eng->csa, acc, DOT_ACC_BYTES, product, 2);
+
+    d = build_lookup(d, eng->dec, count, count);
+    DmacDescriptor* exit = build_branch(d, eng->branch, count, targets);
+    targets[0] = body;
+    targets[1] = exit;
+
+    return build_csa_resolve(exit, &eng->csa, acc, DOT_ACC_BYTES, result);
+}
+
+/**
+ * At most DOT_PRODUCT_DESCS descriptors. *result = the sum of x[i * xstride] * y[i * ystride]
+ * for i < n, with n at most DOT_MAX_LEN.
+ *
+ * Strides can be anything, including negative, but neither operand may cross a 64KiB boundary.
+ * 'scratch' is DOT_PRODUCT_SCRATCH bytes that must start on a 256-byte boundary and be private to
+ * this instance; it's filled in here.
+ */
+DmacDescriptor* build_dot_product(DmacDescriptor* descs,
+                                  const bn_engine_t* eng,
+                                  const volatile uint8_t* x,
+                                  int32_t xstride,
+                                  const volatile uint8_t* y,
+                                  int32_t ystride,
+                                  uint32_t n,
+                                  volatile uint32_t* result,
+                                  uint8_t* scratch)
+{
+    volatile uint8_t* out = (volatile uint8_t*)result;
+    DmacDescriptor* d = build_dot_loop(descs, eng, x, xstride, y, ystride, n, out, scratch);
+    return build_copy(d, &zero_byte, &out[DOT_ACC_BYTES], 1);
+}
+
+/**
+ * At most MATMUL_DESCS(m, k, n) descriptors. c = a * b, where a is m x k, b is k x n and c is
+ * m x n, all row-major; a and b are bytes and c is 32-bit words. k is at most DOT_MAX_LEN.
+ *
+ * The code is laid out column by column: each column of b is gathered once - with one strided
+ * descriptor if n is a power of two up to 128, otherwise a byte at a time - and then each row of
+ * a is copied in and the kernel called, for 3 descriptors per element of c.
+ *
+ * 'scratch' is MATMUL_SCRATCH(m, n) bytes that must start on a 256-byte boundary and be private
+ * to this instance.
+ */
+DmacDescriptor* build_matmul(DmacDescriptor* descs,
+                             const bn_engine_t* eng,
+                             const volatile uint8_t* a,
+                             const volatile uint8_t* b,
+                             volatile uint32_t* c,
+                             uint32_t m,
+                             uint32_t k,
+                             uint32_t n,
+                             uint8_t* scratch)
+{
+    uint8_t* row = &scratch[DOT_PRODUCT_SCRATCH];
+    uint8_t* col = &scratch[DOT_PRODUCT_SCRATCH + 256];
+    uint32_t* returns = (uint32_t*)&scratch[DOT_PRODUCT_SCRATCH + 512];
+
+    // Each element of c is copied out of here, just past the kernel's accumulator.
+    uint8_t* out = &scratch[32];
+    out[DOT_ACC_BYTES] = 0;
+
+    uint32_t log2n = 0;
+    while ((1u << log2n) < n) { log2n++; }
+    const int strided = ((1u << log2n) == n) && (log2n <= 7);
+
+    // The chain starts by jumping over the kernel. The kernel's last descriptor is a nop whose
+    // next descriptor is written by whoever called it.
+    DmacDescriptor* entry = descs;
+    DmacDescriptor* kernel = build_nop(entry);
+    DmacDescriptor* ret = build_dot_loop(kernel, eng, row, 1, col, 1, k, out, scratch);
+    DmacDescriptor* d = build_nop(ret);
+    entry->DESCADDR.reg = (uint32_t)d;
+
+    for (uint32_t j = 0; j < n; j++) {
+        if (strided) {
+            dma_desc_set(d, (DMAC_BTCTRL_STEPSIZE(log2n) |
+                             DMAC_BTCTRL_STEPSEL_SRC |
+                             DMAC_BTCTRL_DSTINC |
+                             DMAC_BTCTRL_SRCINC |
+                             DMAC_BTCTRL_BEATSIZE_BYTE),
+                         k, &b[j], col, d + 1);
+            d++;
+        } else {
+            for (uint32_t i = 0; i < k; i++) { d = build_copy(d, &b[(i * n) + j], &col[i], 1); }
+        }
+
+        for (uint32_t i = 0; i < m; i++) {
+            uint32_t* link = &returns[(i * n) + j];
+            d = build_copy(d, &a[i * k], row, k);
+            d = build_copy(d, link, &ret->DESCADDR.reg, 4);
+            (d - 1)->DESCADDR.reg = (uint32_t)kernel;
+            *link = (uint32_t)d;
+            d = build_copy(d, out, &c[(i * n) + j], 4);
+        }
+    }
+    return d;
+}
@@ -0,0 +1,39 @@
+#ifndef _MATMUL_H
+#define _MATMUL_H
+
+#include <stdint.h>
+#include "dma.h"
+#include "dmainstrs.h"
+
+// Dot products are summed in a 24-bit accumulator and stored as 32-bit little-endian words, which
+// is enough for 255 products of two bytes.
+#define DOT_ACC_BYTES 3
+#define DOT_MAX_LEN   255
+
+#define DOT_PRODUCT_SCRATCH (6 * 256)
+#define DOT_PRODUCT_DESCS                                                     \
+    (19 + BN_MUL_DESCS(1, 1) + (DOT_ACC_BYTES * DIGITS_PER_BYTE * (CSA_DIGIT_DESCS + 12)))
+
+#define MATMUL_SCRATCH(m, n) (DOT_PRODUCT_SCRATCH + (2 * 256) + (4 * (m) * (n)))
+#define MATMUL_DESCS(m, k, n) (DOT_PRODUCT_DESCS + 2 + ((n) * ((k) + (3 * (m)))))
+
+DmacDescriptor* build_dot_product(DmacDescriptor* descs,
+                                  const bn_engine_t* eng,
+                                  const volatile uint8_t* x,
+                                  int32_t xstride,
+                                  const volatile uint8_t* y,
+                                  int32_t ystride,
+                                  uint32_t n,
+                                  volatile uint32_t* result,
+                                  uint8_t* scratch);
+DmacDescriptor* build_matmul(DmacDescriptor* descs,
+                             const bn_engine_t* eng,
+                             const volatile uint8_t* a,
+                             const volatile uint8_t* b,
+                             volatile uint32_t* c,
+                             uint32_t m,
+                             uint32_t k,
+                             uint32_t n,
+                             uint8_t* scratch);
+
+#endif
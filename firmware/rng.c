@@ -0,0 +1,224 @@
+/**
+ * Pseudo-random numbers from shift and XOR tables, without the CPU.
+ *
+ * Both generators are linear, so a step only needs shifted copies of the state XORed together.
+ * A shift of a multi-byte number by s bits is a byte shift by s / 8 and a bit shift by s % 8, and
+ * the bit shift splits every byte of the result into two disjoint parts, one from each of two
+ * neighbouring source bytes: (x[i - 1] << 5) | (x[i - 2] >> 3) is byte i of x << 13, for example.
+ * Disjoint parts can be XORed in one at a time, so every part is a lookup in a 1x256 shift table
+ * and a byte XOR (DIGITS_PER_BYTE digit ops and a merge, as in build_crc8_update()).
+ *
+ * The LFSR is stepped 8 shifts at a time. With the lowest tap at bit 10, none of the feedback
+ * reaches bit 0 within 8 shifts, so the bits shifted out are just the old low byte, and the state
+ * after 8 shifts is (state >> 8) ^ feedback(low byte): two lookups and one XOR per byte.
+ *
+ * build_rng_fill() loops over a buffer a step at a time, with the output address coming from
+ * index-to-address tables on the loop counter, like the string scans.
+ */
+
+#include "rng.h"
+
+#define LFSR16_TAPS 0xb400
+
+/**
+ * Fills out the tables. 'mem' must start on a 256-byte boundary and have room for RNG_ENGINE_SIZE
+ * bytes.
+ */
+void setup_rng_engine(rng_engine_t* eng, const digit_luts_t* luts, uint8_t* mem)
+{
+    uint8_t* xor = &mem[0 * 256];
+    uint8_t* lfsr_lo = &mem[1 * 256];
+    uint8_t* lfsr_hi = &mem[2 * 256];
+    uint8_t* shl5 = &mem[3 * 256];
+    uint8_t* shr3 = &mem[4 * 256];
+    uint8_t* shl7 = &mem[5 * 256];
+    uint8_t* shr1 = &mem[6 * 256];
+    uint8_t* dec = &mem[7 * 256];
+    uint8_t* branch = &mem[8 * 256];
+
+    eng->luts = luts;
+    eng->xor = xor;
+    eng->lfsr_lo = lfsr_lo;
+    eng->lfsr_hi = lfsr_hi;
+    eng->shl5 = shl5;
+    eng->shr3 = shr3;
+    eng->shl7 = shl7;
+    eng->shr1 = shr1;
+    eng->dec = dec;
+    eng->branch = branch;
+
+    setup_digit_xor(xor);
+    setup_decrement(dec);
+    setup_branch_if_zero(branch);
+
+    for (uint32_t count = 0; count < 256; count++) {
+        // The feedback is linear, so running 8 shifts on a state with only the low byte set gives
+        // exactly what the low byte feeds back.
+        uint16_t s = count;
+        for (uint32_t i = 0; i < 8; i++) { s = (s >> 1) ^ ((s & 1) ? LFSR16_TAPS : 0); }
+        lfsr_lo[count] = s & 0xff;
+        lfsr_hi[count] = s >> 8;
+
+        shl5[count] = (count << 5) & 0xff;
+        shr3[count] = count >> 3;
+        shl7[count] = (count << 7) & 0xff;
+        shr1[count] = count >> 1;
+    }
+}
+
+/**
+ * Steps the LFSR in *state by 8 shifts on the CPU, the same as build_lfsr16_step(), and returns
+ * the new low byte.
+ */
+uint8_t lfsr16_next(uint16_t* state)
+{
+    uint16_t s = *state;
+    for (uint32_t i = 0; i < 8; i++) { s = (s >> 1) ^ ((s & 1) ? LFSR16_TAPS : 0); }
+    *state = s;
+    return s & 0xff;
+}
+
+/**
+ * Steps *state on the CPU, the same as build_xorshift32_step(), and returns the new state.
+ */
+uint32_t xorshift32_next(uint32_t* state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/**
+ * At most 2 + RNG_XOR_DESCS descriptors. *x ^= shift[*y]. 'scratch' is DIGITS_PER_BYTE + 1 bytes.
+ */
+static DmacDescriptor* build_xor_shifted(DmacDescriptor* d,
+                                         const rng_engine_t* eng,
+                                         const uint8_t* shift,
+                                         const volatile uint8_t* y,
+                                         volatile uint8_t* x,
+                                         uint8_t* scratch)
+{
+    uint8_t* t = &scratch[DIGITS_PER_BYTE];
+
+    d = build_lookup(d, shift, y, t);
+    for (uint32_t i = 0; i < DIGITS_PER_BYTE; i++) {
+        d = build_digit_op(d, eng->luts, i, x, t, 0, 0, eng->xor, &scratch[i]);
+    }
+    return build_merge_digits(d, eng->luts, scratch, x);
+}
+
+/**
+ * At most LFSR16_STEP_DESCS descriptors. Steps the LFSR in state[0..1] by 8 shifts; the new low
+ * byte is the 8 bits of output.
+ *
+ * 'scratch' is RNG_STEP_SCRATCH bytes that must be private to this instance.
+ */
+DmacDescriptor* build_lfsr16_step(DmacDescriptor* descs,
+                                  const rng_engine_t* eng,
+                                  volatile uint8_t* state,
+                                  uint8_t* scratch)
+{
+    uint8_t* hi = &scratch[DIGITS_PER_BYTE + 1];
+    DmacDescriptor* d = descs;
+
+    // lo = hi ^ lfsr_lo[lo] and hi = lfsr_hi[lo], with the old lo.
+    d = build_lookup(d, eng->lfsr_hi, &state[0], hi);
+    d = build_xor_shifted(d, eng, eng->lfsr_lo, &state[0], &state[1], scratch);
+    d = build_copy(d, &state[1], &state[0], 1);
+    return build_copy(d, hi, &state[1], 1);
+}
+
+/**
+ * At most XORSHIFT32_DESCS descriptors. Steps the xorshift32 generator in state[0..3]; the new
+ * state is the 32 bits of output.
+ *
+ * 'scratch' is RNG_STEP_SCRATCH bytes that must be private to this instance.
+ */
+DmacDescriptor* build_xorshift32_step(DmacDescriptor* descs,
+                                      const rng_engine_t* eng,
+                                      volatile uint8_t* state,
+                                      uint8_t* scratch)
+{
+    volatile uint8_t* x = state;
+    DmacDescriptor* d = descs;
+
+    // x ^= x << 13. Bytes are done from the top down, so the ones that are read are still old.
+    for (int i = 3; i >= 1; i--) {
+        d = build_xor_shifted(d, eng, eng->shl5, &x[i - 1], &x[i], scratch);
+        if (i >= 2) {
+            d = build_xor_shifted(d, eng, eng->shr3, &x[i - 2], &x[i], scratch);
+        }
+    }
+
+    // x ^= x >> 17, from the bottom up.
+    d = build_xor_shifted(d, eng, eng->shr1, &x[2], &x[0], scratch);
+    d = build_xor_shifted(d, eng, eng->shl7, &x[3], &x[0], scratch);
+    d = build_xor_shifted(d, eng, eng->shr1, &x[3], &x[1], scratch);
+
+    // x ^= x << 5, from the top down. Byte i's own part has to go in before it's changed.
+    for (int i = 3; i >= 0; i--) {
+        d = build_xor_shifted(d, eng, eng->shl5, &x[i], &x[i], scratch);
+        if (i >= 1) {
+            d = build_xor_shifted(d, eng, eng->shr3, &x[i - 1], &x[i], scratch);
+        }
+    }
+    return d;
+}
+
+/**
+ * At most RNG_FILL_DESCS(kind) descriptors. Fills buf[0..n-1] with the output of successive steps
+ * of the generator in 'state', which is left where it got to.
+ *
+ * n must be a multiple of RNG_STEP_BYTES(kind), with fewer than 256 steps, and buf must not cross
+ * a 64KiB boundary. 'scratch' is RNG_FILL_SCRATCH bytes that must start on a 256-byte boundary and
+ * be private to this instance; it's filled in here.
+ */
+DmacDescriptor* build_rng_fill(DmacDescriptor* descs,
+                               const rng_engine_t* eng,
+                               rng_kind_t kind,
+                               volatile uint8_t* state,
+                               volatile uint8_t* buf,
+                               uint32_t n,
+                               uint8_t* scratch)
+{
+    const uint32_t stride = RNG_STEP_BYTES(kind);
+    const uint32_t nsteps = n / stride;
+
+    DmacDescriptor** targets = (DmacDescriptor**)&scratch[0];
+    uint8_t* count = &scratch[8];
+    uint8_t* steps = &scratch[9];
+    uint8_t* step_scratch = &scratch[16];
+    uint8_t* lo = &scratch[1 * 256];
+    uint8_t* hi = &scratch[2 * 256];
+
+    DmacDescriptor* d = descs;
+
+    // The counter runs from nsteps down to 1, so step 'count' writes block nsteps - count, and
+    // the copy wants the address just past it.
+    *steps = nsteps;
+    setup_index_to_addr(lo, hi, buf, -stride, (nsteps + 1) * stride);
+    d = build_copy(d, steps, count, 1);
+
+    DmacDescriptor* body = d;
+    if (kind == RNG_LFSR16) {
+        d = build_lfsr16_step(d, eng, state, step_scratch);
+    } else {
+        d = build_xorshift32_step(d, eng, state, step_scratch);
+    }
+
+    DmacDescriptor* out = d + 4;
+    d = build_lookup(d, lo, count, desc_dst_byte(out, 0));
+    d = build_lookup(d, hi, count, desc_dst_byte(out, 1));
+    dma_desc_set(out, DMAC_BTCTRL_BEATSIZE_BYTE | DMAC_BTCTRL_SRCINC | DMAC_BTCTRL_DSTINC, stride,
+                 state, buf, out + 1);
+    d = out + 1;
+
+    d = build_lookup(d, eng->dec, count, count);
+    DmacDescriptor* exit = build_branch(d, eng->branch, count, targets);
+    targets[0] = body;
+    targets[1] = exit;
+    return build_nop(exit);
+}
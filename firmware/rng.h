@@ -0,0 +1,65 @@
+#ifndef _RNG_H
+#define _RNG_H
+
+#include <stdint.h>
+#include "dma.h"
+#include "dmainstrs.h"
+
+/**
+ * The generators. Their state is a little-endian 16- or 32-bit number that must not be 0.
+ */
+typedef enum rng_kind {
+    RNG_LFSR16,         // Galois LFSR, x^16 + x^14 + x^13 + x^11 + 1, 8 shifts per step
+    RNG_XORSHIFT32      // Marsaglia's xorshift32, shifts 13, 17, 5
+} rng_kind_t;
+
+/**
+ * Tables shared by every generator.
+ */
+typedef struct rng_engine {
+    const digit_luts_t* luts;
+    const uint8_t* xor;         // setup_digit_xor()
+    const uint8_t* lfsr_lo;     // low byte of state -> what 8 shifts feed back into the low byte
+    const uint8_t* lfsr_hi;     // likewise for the high byte
+    const uint8_t* shl5;        // v -> (v << 5) & 0xff
+    const uint8_t* shr3;        // v -> v >> 3
+    const uint8_t* shl7;        // v -> (v << 7) & 0xff
+    const uint8_t* shr1;        // v -> v >> 1
+    const uint8_t* dec;         // setup_decrement()
+    const uint8_t* branch;      // setup_branch_if_zero(), unbiased
+} rng_engine_t;
+
+#define RNG_ENGINE_SIZE (9 * 256)
+
+// Bytes of output per step, and the size of the state.
+#define RNG_STEP_BYTES(kind) (((kind) == RNG_LFSR16) ? 1 : 4)
+#define RNG_STATE_SIZE(kind) (((kind) == RNG_LFSR16) ? 2 : 4)
+
+#define RNG_XOR_DESCS       ((8 * DIGITS_PER_BYTE) + (4 * (DIGITS_PER_BYTE - 1)))
+#define LFSR16_STEP_DESCS   (5 + RNG_XOR_DESCS)
+#define XORSHIFT32_DESCS    (15 * (2 + RNG_XOR_DESCS))
+#define RNG_STEP_SCRATCH    (DIGITS_PER_BYTE + 2)
+#define RNG_FILL_SCRATCH    (3 * 256)
+#define RNG_FILL_DESCS(kind) \
+    (13 + (((kind) == RNG_LFSR16) ? LFSR16_STEP_DESCS : XORSHIFT32_DESCS))
+
+void setup_rng_engine(rng_engine_t* eng, const digit_luts_t* luts, uint8_t* mem);
+uint8_t lfsr16_next(uint16_t* state);
+uint32_t xorshift32_next(uint32_t* state);
+DmacDescriptor* build_lfsr16_step(DmacDescriptor* descs,
+                                  const rng_engine_t* eng,
+                                  volatile uint8_t* state,
+                                  uint8_t* scratch);
+DmacDescriptor* build_xorshift32_step(DmacDescriptor* descs,
+                                      const rng_engine_t* eng,
+                                      volatile uint8_t* state,
+                                      uint8_t* scratch);
+DmacDescriptor* build_rng_fill(DmacDescriptor* descs,
+                               const rng_engine_t* eng,
+                               rng_kind_t kind,
+                               volatile uint8_t* state,
+                               volatile uint8_t* buf,
+                               uint32_t n,
+                               uint8_t* scratch);
+
+#endif
@@ -0,0 +1,520 @@
+/**
+ * Sorting with the DMAC.
+ *
+ * build_radix_sort() is an LSD radix sort on unsigned keys, one byte of the key per pass. Each
+ * pass is three descriptor loops:
+ *     * a histogram of the key byte (see histogram.c), counting in bytes rather than elements
+ *     * an exclusive prefix sum over the 256 buckets, which turns every count into the address
+ *       where that bucket's elements start in the output
+ *     * a scatter: each element is written to the address of its bucket, and the address is bumped
+ *       with the same code that bumps a histogram counter
+ *
+ * Bucket addresses are 16 bits wide (bytes 2 and 3 never change), so the low bytes of the address
+ * patch straight into byte 0 and 1 of the DSTADDR of the descriptor that moves the element.
+ *
+ * build_sort_network() is for short arrays of bytes, where a radix sort's 256 buckets cost far
+ * more than the elements do. It lays out a fixed sorting network, so the chain is the same length
+ * whatever the data is.
+ */
+
+#include "sort.h"
+#include "dmainstrs.h"
+#include "dmac.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Sorting networks
+//
+// The network is Batcher's odd-even merge sort. Every comparator is a pair (i, i + k) with k a
+// power of two, so a single descriptor with a source step of k can gather the pair, and one with a
+// destination step of k can write it back. A compare-exchange is then
+//
+//     pair = { a, b, a }
+//     s = (a > b) ? 1 : 0
+//     a, b = pair[s], pair[s + 1]
+//
+// which does with one compare what min and max tables would do with two lookups each.
+//
+// A channel's comparators within a layer all have the same k, so they run as one loop over a
+// table of pair addresses. The loop's cursor carries on from one layer's run of entries to the
+// next, and the entry it lands on says whether to go round again. A layer where a channel only has
+// one comparator does it straight, since that's shorter than the loop.
+//
+// The comparators within a layer are independent, so a layer can be dealt out across several
+// channels, which then meet at a barrier before the next layer. At each barrier, a channel moves
+// its own flag on by one (mod 3) and spins until every other channel's flag has caught up. No flag
+// can get more than one barrier ahead of another, so "caught up" is 2 of the 3 values.
+
+static const uint8_t phases[3] = { 0, 1, 2 };
+
+/**
+ * Fills out the tables for build_sort_network(). 'mem' must start on a 256-byte boundary and have
+ * room for NETWORK_ENGINE_SIZE bytes.
+ */
+void setup_network_engine(network_engine_t* eng, const bn_engine_t* bn, uint8_t* mem)
+{
+    // build_bn_cmp() leaves 0x01 if a > b. The writeback increments its source, so these are the
+    // low bytes of the address just past the 2 bytes it copies.
+    uint8_t* swap = &mem[0];
+    for (uint32_t count = 0; count < 256; count++) { swap[count] = (count == 0x01) ? 3 : 2; }
+    eng->bn = bn;
+    eng->swap = swap;
+
+    uint8_t* inc = &mem[4 * 256];
+    setup_add_const(inc, 1);
+    eng->inc = inc;
+
+    // Offsets into a 2-entry targets array 8 bytes into a page: spin, or carry on.
+    for (uint32_t phase = 0; phase < 3; phase++) {
+        uint8_t* wait = &mem[(1 + phase) * 256];
+        for (uint32_t count = 0; count < 256; count++) {
+            wait[count] = ((count == phase) || (count == ((phase + 1) % 3))) ? 12 : 8;
+        }
+        eng->wait[phase] = wait;
+    }
+}
+
+/**
+ * Fills 'first' with the lower index of each comparator in layer (p, k) of an odd-even merge sort
+ * on n elements; the other index is always first[i] + k. Returns how many comparators there are.
+ */
+static uint32_t merge_sort_layer(uint32_t n, uint32_t p, uint32_t k, uint8_t* first)
+{
+    uint32_t count = 0;
+    for (uint32_t j = k % p; (j + k) < n; j += 2 * k) {
+        for (uint32_t i = 0; (i < k) && ((i + j + k) < n); i++) {
+            if (((i + j) / (2 * p)) == ((i + j + k) / (2 * p))) { first[count++] = i + j; }
+        }
+    }
+    return count;
+}
+
+#define COMPARE_EXCHANGE_DESCS (5 + BN_CMP_DESCS(1))
+#define COMPARATOR_LOOP_DESCS  (8 + COMPARE_EXCHANGE_DESCS + 6)
+
+/**
+ * At most COMPARE_EXCHANGE_DESCS descriptors. Sorts a[0] and a[k] into ascending order. 'pair' is the
+ * first 5 bytes of a page. The first descriptor gathers the pair and the last one writes it back.
+ */
+static DmacDescriptor* build_compare_exchange(DmacDescriptor* descs,
+                                              const network_engine_t* eng,
+                                              uint8_t* a,
+                                              uint32_t k,
+                                              uint8_t* pair)
+{
+    uint32_t log2k = 0;
+    while ((1u << log2k) < k) { log2k++; }
+
+    DmacDescriptor* d = descs;
+    dma_desc_set(d, (DMAC_BTCTRL_STEPSIZE(log2k) |
+                     DMAC_BTCTRL_STEPSEL_SRC |
+                     DMAC_BTCTRL_DSTINC |
+                     DMAC_BTCTRL_SRCINC |
+                     DMAC_BTCTRL_BEATSIZE_BYTE),
+                 2, a, &pair[0], d + 1);
+    d = build_copy(d + 1, &pair[0], &pair[2], 1);
+
+    d = build_bn_cmp(d, eng->bn, &pair[0], &pair[1], 1, &pair[4]);
+    DmacDescriptor* writeback = d + 2;
+    d = build_lookup(d, eng->swap, &pair[4], desc_src_byte(writeback, 0));
+    dma_desc_set(d, (DMAC_BTCTRL_STEPSIZE(log2k) |
+                     DMAC_BTCTRL_STEPSEL_DST |
+                     DMAC_BTCTRL_DSTINC |
+                     DMAC_BTCTRL_SRCINC |
+                     DMAC_BTCTRL_BEATSIZE_BYTE),
+                 2, &pair[0], a, d + 1);
+    return d + 1;
+}
+
+/**
+ * How many of a layer's 'count' comparators channel c gets when they're dealt out across
+ * 'nchannels' channels.
+ */
+static uint32_t channel_share(uint32_t count, uint32_t c, uint32_t nchannels)
+{
+    return (count > c) ? (((count - c) + (nchannels - 1)) / nchannels) : 0;
+}
+
+/**
+ * Descriptors for a channel's share of one layer: a loop over the comparator table, unless there's
+ * only one comparator, which is cheaper done straight.
+ */
+static uint32_t layer_descs(uint32_t share)
+{
+    return (share > 1) ? COMPARATOR_LOOP_DESCS : (share * COMPARE_EXCHANGE_DESCS);
+}
+
+/**
+ * At most how many descriptors build_sort_network() needs for n elements on 'nchannels' channels.
+ */
+uint32_t sort_network_descs(uint32_t n, uint32_t nchannels)
+{
+    uint8_t first[128];
+    uint32_t descs = 0;
+    uint32_t nlayers = 0;
+
+    for (uint32_t p = 1; p < n; p <<= 1) {
+        for (uint32_t k = p; k >= 1; k >>= 1) {
+            uint32_t count = merge_sort_layer(n, p, k, first);
+            for (uint32_t c = 0; c < nchannels; c++) {
+                descs += layer_descs(channel_share(count, c, nchannels));
+            }
+            nlayers += (count != 0);
+        }
+    }
+
+    // Each barrier is a flag write and 5 descriptors per other channel, and every chain starts by
+    // setting its cursor and ends on a nop.
+    uint32_t barriers = (nlayers > 0) ? ((nlayers - 1) * nchannels) : 0;
+    return descs + (barriers * (1 + (5 * (nchannels - 1)))) + (2 * nchannels);
+}
+
+/**
+ * At most sort_network_descs(n, nchannels) descriptors. Lays out a sorting network that sorts the n
+ * bytes of 'array' into ascending order, with its comparators dealt out across DMAC channels 0 to
+ * nchannels - 1. Each channel's chain is terminated here; use sort_network_start() to run them.
+ *
+ * n is at most SORT_NETWORK_MAX_N, and array must not cross a 64KiB boundary. Each channel has room
+ * for 64 barrier checks, and needs (number of layers - 1) * (nchannels - 1) of them, which is at
+ * most 42. 'scratch' is SORT_NETWORK_SCRATCH(nchannels) bytes that must start on a 256-byte
+ * boundary and be private to this instance. Returns NULL if n or nchannels is too large, otherwise
+ * the next free descriptor.
+ */
+DmacDescriptor* build_sort_network(DmacDescriptor* descs,
+                                   sort_network_t* net,
+                                   const network_engine_t* eng,
+                                   uint8_t* array,
+                                   uint32_t n,
+                                   uint32_t nchannels,
+                                   uint8_t* scratch)
+{
+    uint8_t first[128];
+    DmacDescriptor* d = descs;
+
+    if ((n > SORT_NETWORK_MAX_N) || (nchannels > SORT_NETWORK_MAX_CHANNELS)) { return 0; }
+
+    net->nchannels = nchannels;
+    net->ncomparators = 0;
+    net->nlayers = 0;
+    for (uint32_t p = 1; p < n; p <<= 1) {
+        for (uint32_t k = p; k >= 1; k >>= 1) {
+            uint32_t count = merge_sort_layer(n, p, k, first);
+            net->ncomparators += count;
+            net->nlayers += (count != 0);
+        }
+    }
+    if ((net->nlayers > 0) && (((net->nlayers - 1) * (nchannels - 1)) > 64)) { return 0; }
+    for (uint32_t c = 0; c < nchannels; c++) { net->flags[c] = &scratch[(c * 768) + 16]; }
+
+    // The comparator table: the address just past each looped pair, and where the loop goes after
+    // it. All channels share it, each with its own run of entries; SORT_NETWORK_MAX_N keeps the
+    // total under 256.
+    uint8_t* pair_lo = &scratch[(nchannels * 768) + (0 * 256)];
+    uint8_t* pair_hi = &scratch[(nchannels * 768) + (1 * 256)];
+    uint8_t* next = &scratch[(nchannels * 768) + (2 * 256)];
+    uint32_t entry = 0;
+
+    for (uint32_t c = 0; c < nchannels; c++) {
+        uint8_t* pair = &scratch[c * 768];
+        DmacDescriptor** targets = (DmacDescriptor**)&scratch[(c * 768) + 8];
+        uint8_t* cursor = &scratch[(c * 768) + 17];
+        uint8_t* start = &scratch[(c * 768) + 18];
+        DmacDescriptor** loops = (DmacDescriptor**)&scratch[(c * 768) + 32];
+        uint8_t* checks = &scratch[(c * 768) + 256];
+        uint32_t layer = 0;
+
+        net->chains[c] = d;
+        *start = entry;
+        d = build_copy(d, start, cursor, 1);
+        for (uint32_t p = 1; p < n; p <<= 1) {
+            for (uint32_t k = p; k >= 1; k >>= 1) {
+                uint32_t count = merge_sort_layer(n, p, k, first);
+                if (count == 0) { continue; }
+
+                const uint32_t share = channel_share(count, c, nchannels);
+                if (share == 1) {
+                    d = build_compare_exchange(d, eng, &array[first[c]], k, pair);
+                } else if (share > 1) {
+                    // The loop patches the address of each pair into the gather and the writeback,
+                    // then steps the cursor and branches on the entry it lands on.
+                    DmacDescriptor* body = d;
+                    DmacDescriptor* end = build_compare_exchange(body + 8, eng, array, k, pair);
+                    d = build_lookup(d, pair_lo, cursor, desc_src_byte(body + 8, 0));
+                    d = build_lookup(d, pair_hi, cursor, desc_src_byte(body + 8, 1));
+                    d = build_lookup(d, pair_lo, cursor, desc_dst_byte(end - 1, 0));
+                    d = build_lookup(d, pair_hi, cursor, desc_dst_byte(end - 1, 1));
+                    d = build_lookup(end, eng->inc, cursor, cursor);
+                    DmacDescriptor* exit = build_branch(d, next, cursor, loops);
+
+                    for (uint32_t i = c; i < count; i += nchannels) {
+                        uint32_t addr = (uint32_t)&array[first[i]] + (2 * k);
+                        pair_lo[entry] = (addr >> 0) & 0xff;
+                        pair_hi[entry] = (addr >> 8) & 0xff;
+                        entry++;
+                        next[entry] = (uint32_t)&loops[(i + nchannels) >= count] & 0xff;
+                    }
+                    loops[0] = body;
+                    loops[1] = exit;
+                    loops += 2;
+                    d = exit;
+                }
+
+                // Nothing waits after the last layer; sort_network_busy() does that instead.
+                if ((++layer == net->nlayers) || (nchannels == 1)) { continue; }
+
+                const uint32_t phase = layer % 3;
+                d = build_copy(d, &phases[phase], net->flags[c], 1);
+                for (uint32_t other = 0; other < nchannels; other++) {
+                    if (other == c) { continue; }
+
+                    // The branch reads its targets from one fixed place, so each check copies its
+                    // own 2 targets there first.
+                    DmacDescriptor** jumps = (DmacDescriptor**)checks;
+                    DmacDescriptor* check = d;
+                    d = build_copy(d, checks, targets, 8);
+                    d = build_branch(d, eng->wait[phase], net->flags[other], targets);
+                    jumps[0] = check;
+                    jumps[1] = d;
+                    checks += 8;
+                }
+            }
+        }
+
+        d = build_nop(d);
+        dma_chain_terminate(d - 1);
+    }
+    return d;
+}
+
+/**
+ * Starts every channel of a network built by build_sort_network(). The network can be rerun as
+ * soon as sort_network_busy() says it's done.
+ */
+void sort_network_start(const sort_network_t* net)
+{
+    for (uint32_t c = 0; c < net->nchannels; c++) { *net->flags[c] = 0; }
+    for (uint32_t c = 0; c < net->nchannels; c++) { dmac_start(c, net->chains[c]); }
+}
+
+int sort_network_busy(const sort_network_t* net)
+{
+    for (uint32_t c = 0; c < net->nchannels; c++) {
+        if (dmac_busy(c)) { return 1; }
+    }
+    return 0;
+}
+
+static const uint8_t zero_byte = 0;
+
+/**
+ * At most BUCKET_OFFSETS_DESCS descriptors. Replaces each of the 256 16-bit counters in hist with
+ * the low 16 bits of base + the sum of the counters before it.
+ *
+ * 'eng' is only used for its inc and branch tables. 'scratch' is BUCKET_OFFSETS_SCRATCH bytes that
+ * must start on a 256-byte boundary and be private to this instance.
+ */
+DmacDescriptor* build_bucket_offsets(DmacDescriptor* descs,
+                                     const bn_engine_t* bn,
+                                     const count_engine_t* eng,
+                                     uint8_t* hist,
+                                     const volatile void* base,
+                                     uint8_t* scratch)
+{
+    // targets has to be at the start of a page, since the branch table isn't biased.
+    DmacDescriptor** targets = (DmacDescriptor**)&scratch[0];
+    uint8_t* bucket = &scratch[8];
+    uint8_t* cursor = &scratch[10];
+    uint8_t* count = &scratch[12];
+    uint8_t* start = &scratch[14];
+    uint8_t* add_scratch = &scratch[16];
+
+    DmacDescriptor* d = descs;
+
+    start[0] = ((uint32_t)base >> 0) & 0xff;
+    start[1] = ((uint32_t)base >> 8) & 0xff;
+    d = build_copy(d, start, cursor, 2);
+    d = build_copy(d, &zero_byte, bucket, 1);
+
+    // Both halves of the count are read before both halves of the running sum are written back
+    // over them.
+    DmacDescriptor* body = d;
+    DmacDescriptor* fetch = body + 2;
+    DmacDescriptor* store = fetch + 2;
+    d = build_broadcast(d, bucket, desc_src_byte(fetch, 0), 2);
+    d = build_broadcast(d, bucket, desc_dst_byte(store, 0), 2);
+    dma_desc_set(d, DMAC_BTCTRL_BEATSIZE_BYTE, 1, &hist[0], &count[0], d + 1); d++;
+    dma_desc_set(d, DMAC_BTCTRL_BEATSIZE_BYTE, 1, &hist[256], &count[1], d + 1); d++;
+    dma_desc_set(d, DMAC_BTCTRL_BEATSIZE_BYTE, 1, &cursor[0], &hist[0], d + 1); d++;
+    dma_desc_set(d, DMAC_BTCTRL_BEATSIZE_BYTE, 1, &cursor[1], &hist[256], d + 1); d++;
+    d = build_bn_add(d, bn, cursor, count, cursor, 2, 0, 0, add_scratch);
+
+    // bucket 255 wraps around to 0
+    d = build_lookup(d, eng->inc, bucket, bucket);
+    DmacDescriptor* exit = build_branch(d, eng->branch, bucket, targets);
+    targets[0] = body;
+    targets[1] = exit;
+    return exit;
+}
+
+/**
+ * Moves the nelems esize-byte elements at src to the addresses that their key byte 'byte' selects
+ * in offsets, bumping each address as it goes: a copy of the elements into 'elems', a gather of
+ * their keys (unless esize is 1), 6 descriptors of patching, then one block of BUCKET_BLOCK_DESCS
+ * descriptors per element:
+ *
+ *     0, 1    copy the low and high byte of the bucket's address into the DSTADDR of 2
+ *     2       move the element
+ *     3 - 7   build_bucket_add16()
+ *
+ * The first descriptor is the copy, so a loop can patch its SRCADDR.
+ */
+static DmacDescriptor* build_scatter_blocks(DmacDescriptor* descs,
+                                            const count_engine_t* eng,
+                                            uint8_t* offsets,
+                                            const uint8_t* src,
+                                            uint8_t* dst,
+                                            uint32_t nelems,
+                                            uint32_t esize,
+                                            uint32_t byte,
+                                            uint8_t* elems,
+                                            uint8_t* keys)
+{
+    DmacDescriptor* d = build_copy(descs, src, elems, nelems * esize);
+
+    if (esize > 1) {
+        dma_desc_set(d, (DMAC_BTCTRL_STEPSIZE(esize >> 1) |
+                         DMAC_BTCTRL_STEPSEL_SRC |
+                         DMAC_BTCTRL_DSTINC |
+                         DMAC_BTCTRL_SRCINC |
+                         DMAC_BTCTRL_BEATSIZE_BYTE),
+                     nelems, &elems[byte], keys, d + 1);
+        d++;
+    } else {
+        keys = elems;
+    }
+
+    DmacDescriptor* blocks = d + 6;
+    d = build_block_scatter(d, keys, desc_src_byte(&blocks[0], 0), nelems);
+    d = build_block_scatter(d, keys, desc_src_byte(&blocks[1], 0), nelems);
+    for (int i = 0; i < 4; i++) {
+        d = build_block_scatter(d, keys, bucket_add16_patch_point(&blocks[3], i), nelems);
+    }
+
+    for (uint32_t j = 0; j < nelems; j++) {
+        DmacDescriptor* b = &blocks[j * BUCKET_BLOCK_DESCS];
+        dma_desc_set(&b[0], DMAC_BTCTRL_BEATSIZE_BYTE, 1, &offsets[0], desc_dst_byte(&b[2], 0),
+                     &b[1]);
+        dma_desc_set(&b[1], DMAC_BTCTRL_BEATSIZE_BYTE, 1, &offsets[256], desc_dst_byte(&b[2], 1),
+                     &b[2]);
+
+        // Only the top 2 bytes of the destination address survive the patching above.
+        dma_desc_set(&b[2], DMAC_BTCTRL_BEATSIZE(esize >> 1), 1, &elems[j * esize], dst, &b[3]);
+        d = build_bucket_add16(&b[3], eng, offsets);
+    }
+    return d;
+}
+
+/**
+ * One loop that runs build_scatter_blocks() over 'unroll' elements of src per pass; the leftover
+ * n % unroll elements are done after the loop, the same way.
+ *
+ * 'scratch' is 3 pages, 256-byte aligned. Returns NULL if n / unroll is 256 or more.
+ */
+static DmacDescriptor* build_radix_scatter(DmacDescriptor* descs,
+                                           const count_engine_t* eng,
+                                           uint8_t* offsets,
+                                           const uint8_t* src,
+                                           uint8_t* dst,
+                                           uint32_t n,
+                                           uint32_t esize,
+                                           uint32_t byte,
+                                           uint32_t unroll,
+                                           uint8_t* scratch)
+{
+    const uint32_t npasses = n / unroll;
+    const uint32_t tail = n % unroll;
+
+    DmacDescriptor** targets = (DmacDescriptor**)&scratch[0];
+    uint8_t* count = &scratch[8];
+    uint8_t* passes = &scratch[9];
+    uint8_t* keys = &scratch[64];
+    uint8_t* elems = &scratch[128];
+    uint8_t* lo = &scratch[1 * 256];
+    uint8_t* hi = &scratch[2 * 256];
+
+    DmacDescriptor* d = descs;
+
+    // The pass counter is a byte, and 256 passes would store 0 in it.
+    if (npasses >= 256) { return 0; }
+
+    if (npasses > 0) {
+        const uint32_t stride = unroll * esize;
+        *passes = npasses;
+        setup_index_to_addr(lo, hi, src, -(int32_t)stride, (npasses + 1) * stride);
+        d = build_copy(d, passes, count, 1);
+
+        DmacDescriptor* body = d;
+        DmacDescriptor* fetch = body + 4;
+        d = build_lookup(d, lo, count, desc_src_byte(fetch, 0));
+        d = build_lookup(d, hi, count, desc_src_byte(fetch, 1));
+        d = build_scatter_blocks(d, eng, offsets, src, dst, unroll, esize, byte, elems, keys);
+
+        d = build_lookup(d, eng->dec, count, count);
+        DmacDescriptor* exit = build_branch(d, eng->branch, count, targets);
+        targets[0] = body;
+        targets[1] = exit;
+        d = exit;
+    }
+
+    if (tail > 0) {
+        d = build_scatter_blocks(d, eng, offsets, &src[(n - tail) * esize], dst, tail, esize, byte,
+                                 elems, keys);
+    }
+    return d;
+}
+
+/**
+ * At most RADIX_SORT_DESCS(n, esize, unroll) descriptors. Sorts the n esize-byte elements of
+ * buf, as little-endian unsigned numbers, in ascending order. The sort is stable.
+ *
+ * 'eng' must have been set up with step == esize, since bucket counts are kept in bytes. 'tmp' is
+ * another n * esize bytes. esize is 1, 2 or 4, n / unroll less than 256, unroll at most 64 and
+ * n * esize less than 65536; neither buffer may cross a 64KiB boundary, and both need to be
+ * esize-aligned. Returns NULL if n / unroll is too large, otherwise the next free descriptor.
+ *
+ * Each element costs 13 descriptors per byte of key: 5 for the histogram, and 8 for the scatter.
+ * 'scratch' is RADIX_SORT_SCRATCH(esize) bytes that must start on a 256-byte boundary and be
+ * private to this instance.
+ */
+DmacDescriptor* build_radix_sort(DmacDescriptor* descs,
+                                 const bn_engine_t* bn,
+                                 const count_engine_t* eng,
+                                 uint8_t* buf,
+                                 uint8_t* tmp,
+                                 uint32_t n,
+                                 uint32_t esize,
+                                 uint32_t unroll,
+                                 uint8_t* scratch)
+{
+    uint8_t* hist = &scratch[0];
+    DmacDescriptor* d = descs;
+
+    for (uint32_t byte = 0; byte < esize; byte++) {
+        uint8_t* pass_scratch = &scratch[(2 + (7 * byte)) * 256];
+        uint8_t* src = (byte & 1) ? tmp : buf;
+        uint8_t* dst = (byte & 1) ? buf : tmp;
+
+        d = build_histogram16(d, eng, hist, src, n, esize, byte, unroll, &pass_scratch[0 * 256]);
+        if (!d) { return 0; }
+        d = build_bucket_offsets(d, bn, eng, hist, dst, &pass_scratch[3 * 256]);
+        d = build_radix_scatter(d, eng, hist, src, dst, n, esize, byte, unroll,
+                                &pass_scratch[4 * 256]);
+        if (!d) { return 0; }
+    }
+
+    if (esize & 1) {
+        d = build_copy(d, tmp, buf, n * esize);
+    } else {
+        d = build_nop(d);
+    }
+    return d;
+}
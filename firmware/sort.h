@@ -0,0 +1,75 @@
+#ifndef _SORT_H
+#define _SORT_H
+
+#include <stdint.h>
+#include "dma.h"
+#include "dmainstrs.h"
+#include "histogram.h"
+
+#define SORT_NETWORK_MAX_CHANNELS 4
+#define SORT_NETWORK_MAX_N        32
+
+/**
+ * Tables for build_sort_network(); see setup_network_engine().
+ */
+typedef struct network_engine {
+    const bn_engine_t* bn;    // for build_bn_cmp()
+    const uint8_t* swap;      // compare state -> where the writeback starts
+    const uint8_t* wait[3];   // barrier phase -> build_branch() table
+    const uint8_t* inc;       // v -> v + 1, for the comparator table cursor
+} network_engine_t;
+
+#define NETWORK_ENGINE_SIZE (5 * 256)
+
+/**
+ * Where build_sort_network() put each channel's chain, and the barrier flags that have to be reset
+ * before every run.
+ */
+typedef struct sort_network {
+    DmacDescriptor* chains[SORT_NETWORK_MAX_CHANNELS];
+    volatile uint8_t* flags[SORT_NETWORK_MAX_CHANNELS];
+    uint32_t nchannels;
+    uint32_t ncomparators;
+    uint32_t nlayers;
+} sort_network_t;
+
+#define SORT_NETWORK_SCRATCH(nchannels) ((((nchannels) * 3) + 3) * 256)
+
+void setup_network_engine(network_engine_t* eng, const bn_engine_t* bn, uint8_t* mem);
+uint32_t sort_network_descs(uint32_t n, uint32_t nchannels);
+DmacDescriptor* build_sort_network(DmacDescriptor* descs,
+                                   sort_network_t* net,
+                                   const network_engine_t* eng,
+                                   uint8_t* array,
+                                   uint32_t n,
+                                   uint32_t nchannels,
+                                   uint8_t* scratch);
+void sort_network_start(const sort_network_t* net);
+int sort_network_busy(const sort_network_t* net);
+
+#define BUCKET_OFFSETS_SCRATCH 256
+#define BUCKET_OFFSETS_DESCS   (14 + BN_ADD_DESCS(2))
+
+#define RADIX_SORT_SCRATCH(esize) ((2 + (7 * (esize))) * 256)
+#define RADIX_SCATTER_TAIL_DESCS(n, unroll) (((n) % (unroll)) ? (8 * (((n) % (unroll)) + 1)) : 0)
+#define RADIX_SORT_DESCS(n, esize, unroll)                                                       \
+    (((esize) * (HISTOGRAM_DESCS(unroll) + BUCKET_OFFSETS_DESCS + (8 * (unroll)) + 19 +           \
+                 RADIX_SCATTER_TAIL_DESCS(n, unroll))) + 1)
+
+DmacDescriptor* build_bucket_offsets(DmacDescriptor* descs,
+                                     const bn_engine_t* bn,
+                                     const count_engine_t* eng,
+                                     uint8_t* hist,
+                                     const volatile void* base,
+                                     uint8_t* scratch);
+DmacDescriptor* build_radix_sort(DmacDescriptor* descs,
+                                 const bn_engine_t* bn,
+                                 const count_engine_t* eng,
+                                 uint8_t* buf,
+                                 uint8_t* tmp,
+                                 uint32_t n,
+                                 uint32_t esize,
+                                 uint32_t unroll,
+                                 uint8_t* scratch);
+
+#endif
@@ -0,0 +1,401 @@
+/**
+ * String scanning: memchr(), strnlen() and strncmp() as descriptor loops.
+ *
+ * The buffer is looked at SCAN_UNROLL bytes per loop pass, and the loop only branches once per
+ * pass, on the state left by the whole block. That's as close as this gets to comparing a word at
+ * a time: an equality table indexed by a 32-bit word would need 2^32 entries, but a chain of
+ * per-byte lookups that carries its state from one descriptor to the next costs one descriptor per
+ * byte and no branches.
+ *
+ * memchr() and strnlen() run the bytes of a block through a small state machine, DFA-style: every
+ * step is a 2D lookup with the byte in SRCADDR byte 0 and the state in byte 1, and it writes the
+ * next state straight into byte 1 of the next step. Step k has its own page, which maps the byte
+ * being searched for to "found at k" and everything else to the page of step k + 1. The found
+ * states are pages that map every byte to themselves, so whichever comes first sticks, and the
+ * state at the end of a block says both whether the byte was there and where.
+ *
+ * strncmp() compares a pair of bytes a digit at a time with the compare tables of build_bn_cmp(),
+ * most significant digit first, and then checks whether a byte that compared equal was a NUL.
+ * The state sticks as soon as the strings differ or end.
+ */
+
+#include "strscan.h"
+
+/**
+ * Fills out the tables shared by every scan engine. 'mem' must start on a 256-byte boundary and
+ * have room for SCAN_LUTS_SIZE bytes.
+ */
+void setup_scan_luts(scan_luts_t* luts, uint8_t* mem)
+{
+    uint8_t* found = &mem[0];
+    uint8_t* offset = &mem[SCAN_UNROLL * 256];
+    uint8_t* to_offset = &mem[2 * SCAN_UNROLL * 256];
+    uint8_t* done = &mem[((2 * SCAN_UNROLL) + 1) * 256];
+    uint8_t* dec = &mem[((2 * SCAN_UNROLL) + 2) * 256];
+    uint8_t* branch = &mem[((2 * SCAN_UNROLL) + 3) * 256];
+
+    luts->found = found;
+    luts->offset = offset;
+    luts->to_offset = to_offset;
+    luts->done = done;
+    luts->dec = dec;
+    luts->branch = branch;
+
+    for (uint32_t k = 0; k < SCAN_UNROLL; k++) {
+        for (uint32_t count = 0; count < 256; count++) {
+            found[(k * 256) + count] = lut_page(found) + k;
+            offset[(k * 256) + count] = (count + k) & 0xff;
+        }
+    }
+
+    // Branch targets are { not found, found } at byte offset 8 of a page; see build_scan().
+    for (uint32_t count = 0; count < 256; count++) {
+        uint8_t k = count - lut_page(found);
+        to_offset[count] = lut_page(offset) + ((k < SCAN_UNROLL) ? k : 0);
+        done[count] = (k < SCAN_UNROLL) ? 12 : 8;
+    }
+    setup_decrement(dec);
+    setup_branch_if_zero(branch);
+}
+
+/**
+ * Sets up an engine that looks for the byte c. 'mem' must start on a 256-byte boundary and have
+ * room for SCAN_ENGINE_SIZE bytes.
+ */
+void setup_scan_engine(scan_engine_t* eng, const scan_luts_t* luts, uint8_t c, uint8_t* mem)
+{
+    eng->luts = luts;
+    eng->steps = mem;
+
+    // Once past the last step the state can stay on its page; nothing reads it as a row.
+    for (uint32_t k = 0; k < SCAN_UNROLL; k++) {
+        uint8_t next = lut_page(mem) + ((k + 1 < SCAN_UNROLL) ? (k + 1) : k);
+        for (uint32_t count = 0; count < 256; count++) {
+            mem[(k * 256) + count] = (count == c) ? (lut_page(luts->found) + k) : next;
+        }
+    }
+}
+
+/**
+ * n steps over the bytes that the scatter in front of them drops into their SRCADDR. The first
+ * step starts from the "nothing found" state, and the last one leaves its state in *state.
+ */
+static DmacDescriptor* build_scan_steps(DmacDescriptor* d,
+                                        const scan_engine_t* eng,
+                                        uint32_t n,
+                                        volatile uint8_t* state)
+{
+    for (uint32_t k = 0; k < n; k++) {
+        volatile uint8_t* next = (k == n - 1) ? state : desc_src_byte(d + 1, 1);
+        dma_desc_set(d, DMAC_BTCTRL_BEATSIZE_BYTE, 1, eng->steps, next, d + 1);
+        d++;
+    }
+    return d;
+}
+
+/**
+ * Scatters n bytes from src into byte 0 of the SRCADDRs of the n descriptors at 'steps'.
+ */
+static DmacDescriptor* build_scan_scatter(DmacDescriptor* d,
+                                          const volatile uint8_t* src,
+                                          DmacDescriptor* steps,
+                                          uint32_t n)
+{
+    // consecutive descriptors are 16 bytes apart
+    dma_desc_set(d, (DMAC_BTCTRL_STEPSIZE_X16 |
+                     DMAC_BTCTRL_STEPSEL_DST |
+                     DMAC_BTCTRL_DSTINC |
+                     DMAC_BTCTRL_SRCINC |
+                     DMAC_BTCTRL_BEATSIZE_BYTE),
+                 n, src, desc_src_byte(steps, 0), d + 1);
+    return d + 1;
+}
+
+/**
+ * Shared by build_memchr() and build_strnlen(): *result = the index of the first byte of buf that
+ * the engine looks for, or 'missing' if none of the n bytes is.
+ */
+static DmacDescriptor* build_scan(DmacDescriptor* descs,
+                                  const scan_engine_t* eng,
+                                  const volatile uint8_t* buf,
+                                  uint32_t n,
+                                  uint16_t missing,
+                                  volatile uint16_t* result,
+                                  uint8_t* scratch)
+{
+    const scan_luts_t* luts = eng->luts;
+    const uint32_t npasses = n / SCAN_UNROLL;
+    const uint32_t tail = n % SCAN_UNROLL;
+    volatile uint8_t* out = (volatile uint8_t*)result;
+
+    // luts->done picks byte offset 8 or 12, so each set of { not found, found } targets sits at
+    // offset 8 of its own page. The loop counter's targets take offset 0 of the first one.
+    DmacDescriptor** targets = (DmacDescriptor**)&scratch[0];
+    DmacDescriptor** found_targets = (DmacDescriptor**)&scratch[8];
+    uint8_t* count = &scratch[16];
+    uint8_t* passes = &scratch[17];
+    uint8_t* state = &scratch[18];
+    uint8_t* base = &scratch[20];
+    uint8_t* tail_base = &scratch[22];
+    uint8_t* not_found = &scratch[24];
+    DmacDescriptor** tail_targets = (DmacDescriptor**)&scratch[256 + 8];
+    uint8_t* lo = &scratch[2 * 256];
+    uint8_t* hi = &scratch[3 * 256];
+    uint8_t* base_lo = &scratch[4 * 256];
+    uint8_t* base_hi = &scratch[5 * 256];
+
+    DmacDescriptor* d = descs;
+
+    not_found[0] = (missing >> 0) & 0xff;
+    not_found[1] = (missing >> 8) & 0xff;
+
+    if (npasses > 0) {
+        // The counter runs from npasses down to 1, so pass 'count' is block npasses - count. The
+        // scatter wants the address just past the block, and the result wants the block's index.
+        *passes = npasses;
+        setup_index_to_addr(lo, hi, buf, -SCAN_UNROLL, (npasses + 1) * SCAN_UNROLL);
+        setup_index_to_addr(base_lo, base_hi, 0, -SCAN_UNROLL, npasses * SCAN_UNROLL);
+
+        d = build_copy(d, passes, count, 1);
+
+        DmacDescriptor* body = d;
+        DmacDescriptor* steps = body + 5;
+        d = build_lookup(d, lo, count, desc_src_byte(steps - 1, 0));
+        d = build_lookup(d, hi, count, desc_src_byte(steps - 1, 1));
+        d = build_scan_scatter(d, buf, steps, SCAN_UNROLL);
+        d = build_scan_steps(d, eng, SCAN_UNROLL, state);
+
+        DmacDescriptor* next = build_branch(d, luts->done, state, found_targets);
+        found_targets[0] = next;
+
+        d = build_lookup(next, luts->dec, count, count);
+        DmacDescriptor* exit = build_branch(d, luts->branch, count, targets);
+        targets[0] = body;
+        targets[1] = exit;
+        d = exit;
+    }
+
+    if (tail > 0) {
+        const uint32_t start = npasses * SCAN_UNROLL;
+        tail_base[0] = (start >> 0) & 0xff;
+        tail_base[1] = (start >> 8) & 0xff;
+
+        d = build_scan_scatter(d, &buf[start], d + 1, tail);
+        d = build_scan_steps(d, eng, tail, state);
+        d = build_copy(d, tail_base, base, 2);
+        d = build_branch(d, luts->done, state, tail_targets);
+        tail_targets[0] = d;
+    }
+
+    DmacDescriptor* missed = d;
+    d = build_copy(d, not_found, out, 2);
+
+    // Found in the loop: the block's index comes from the counter.
+    if (npasses > 0) {
+        found_targets[1] = d;
+        d = build_lookup(d, base_lo, count, &base[0]);
+        d = build_lookup(d, base_hi, count, &base[1]);
+    }
+
+    // Found: *result = base + k, where the state is found page k. Blocks start on multiples of
+    // SCAN_UNROLL, so there's never a carry into the high byte.
+    DmacDescriptor* epilogue = d;
+    DmacDescriptor* add = d + 4;
+    d = build_copy(d, &base[1], &out[1], 1);
+    d = build_copy(d, &base[0], desc_src_byte(add, 0), 1);
+    d = build_lookup(d, luts->to_offset, state, desc_src_byte(add, 1));
+    dma_desc_set(add, DMAC_BTCTRL_BEATSIZE_BYTE, 1, luts->offset, &out[0], add + 1);
+    d = add + 1;
+
+    if (tail > 0) {
+        tail_targets[1] = epilogue;
+    }
+    missed->DESCADDR.reg = (uint32_t)d;
+    return build_nop(d);
+}
+
+/**
+ * At most SCAN_DESCS descriptors. *result = the index of the first byte of buf[0..n-1] that's equal
+ * to the byte 'eng' was set up for, or SCAN_NOT_FOUND if there isn't one.
+ *
+ * Costs SCAN_UNROLL + 15 descriptors per SCAN_UNROLL bytes up to the block with the byte in it.
+ * n / SCAN_UNROLL must be less than 256, and buf must not cross a 64KiB boundary. 'scratch' is
+ * SCAN_SCRATCH bytes that must start on a 256-byte boundary and be private to this instance; it's
+ * filled in here.
+ */
+DmacDescriptor* build_memchr(DmacDescriptor* descs,
+                             const scan_engine_t* eng,
+                             const volatile uint8_t* buf,
+                             uint32_t n,
+                             volatile uint16_t* result,
+                             uint8_t* scratch)
+{
+    return build_scan(descs, eng, buf, n, SCAN_NOT_FOUND, result, scratch);
+}
+
+/**
+ * At most SCAN_DESCS descriptors. *result = the length of the string at s, or maxlen if there's no
+ * NUL in its first maxlen bytes. 'eng' must be set up to look for 0; otherwise this is the same as
+ * build_memchr().
+ */
+DmacDescriptor* build_strnlen(DmacDescriptor* descs,
+                              const scan_engine_t* eng,
+                              const volatile uint8_t* s,
+                              uint32_t maxlen,
+                              volatile uint16_t* result,
+                              uint8_t* scratch)
+{
+    return build_scan(descs, eng, s, maxlen, maxlen, result, scratch);
+}
+
+#define CMP_EQUAL 0x00
+#define CMP_GT    0x01
+#define CMP_LT    0xff
+#define CMP_END   0x02
+
+static const uint8_t cmp_equal = CMP_EQUAL;
+
+static uint8_t cmp_page(uint32_t state)
+{
+    switch (state) {
+        case CMP_GT:  return 1;
+        case CMP_LT:  return 2;
+        case CMP_END: return 3;
+        default:      return 0;
+    }
+}
+
+/**
+ * Fills out the tables for build_strncmp(). 'mem' must start on a 256-byte boundary and have room
+ * for STRCMP_ENGINE_SIZE bytes.
+ */
+void setup_strcmp_engine(strcmp_engine_t* eng, const digit_luts_t* luts, uint8_t* mem)
+{
+    uint8_t* cmp = &mem[0 * 256];
+    uint8_t* nul = &mem[4 * 256];
+    uint8_t* to_cmp = &mem[8 * 256];
+    uint8_t* to_nul = &mem[9 * 256];
+    uint8_t* result = &mem[10 * 256];
+    uint8_t* dec = &mem[11 * 256];
+    uint8_t* branch = &mem[12 * 256];
+
+    eng->luts = luts;
+    eng->cmp = cmp;
+    eng->to_cmp = to_cmp;
+    eng->nul = nul;
+    eng->to_nul = to_nul;
+    eng->result = result;
+    eng->dec = dec;
+    eng->branch = branch;
+
+    setup_digit_compare(cmp);
+    for (uint32_t count = 0; count < 256; count++) {
+        cmp[(3 * 256) + count] = CMP_END;
+
+        nul[(0 * 256) + count] = (count == 0) ? CMP_END : CMP_EQUAL;
+        nul[(1 * 256) + count] = CMP_GT;
+        nul[(2 * 256) + count] = CMP_LT;
+        nul[(3 * 256) + count] = CMP_END;
+
+        to_cmp[count] = lut_page(cmp) + cmp_page(count);
+        to_nul[count] = lut_page(nul) + cmp_page(count);
+        result[count] = (count == CMP_GT) ? 1 : ((count == CMP_LT) ? 0xff : 0);
+    }
+    setup_decrement(dec);
+    setup_branch_if_zero(branch);
+}
+
+/**
+ * At most 8 * DIGITS_PER_BYTE + 4 descriptors. Moves *state on by one pair of bytes.
+ */
+static DmacDescriptor* build_strcmp_byte(DmacDescriptor* d,
+                                         const strcmp_engine_t* eng,
+                                         const volatile uint8_t* a,
+                                         const volatile uint8_t* b,
+                                         volatile uint8_t* state)
+{
+    for (int32_t i = DIGITS_PER_BYTE - 1; i >= 0; i--) {
+        d = build_digit_op(d, eng->luts, i, a, b, eng->to_cmp, state, eng->cmp, state);
+    }
+
+    // state = nul[state][a]; the row goes into the lookup's own SRCADDR.
+    d = build_lookup(d, eng->to_nul, state, desc_src_byte(d + 3, 1));
+    return build_lookup(d, eng->nul, a, state);
+}
+
+/**
+ * At most STRCMP_DESCS descriptors. Compares at most n bytes of the strings a and b like strncmp():
+ * *result is 0 if they're equal up to a NUL or for all n bytes, and otherwise 1 or -1 as the first
+ * byte that differs is greater or less in a than in b.
+ *
+ * Both strings are copied SCAN_UNROLL bytes at a time into scratch, and the loop stops after the
+ * block where they differ or end, so up to SCAN_UNROLL - 1 bytes past the end of the shorter
+ * string can be read (but never past a + n or b + n). n / SCAN_UNROLL must be less than 256, and
+ * neither string may cross a 64KiB boundary. 'scratch' is STRCMP_SCRATCH bytes that must start on
+ * a 256-byte boundary and be private to this instance; it's filled in here.
+ */
+DmacDescriptor* build_strncmp(DmacDescriptor* descs,
+                              const strcmp_engine_t* eng,
+                              const volatile uint8_t* a,
+                              const volatile uint8_t* b,
+                              uint32_t n,
+                              volatile int8_t* result,
+                              uint8_t* scratch)
+{
+    const uint32_t npasses = n / SCAN_UNROLL;
+    const uint32_t tail = n % SCAN_UNROLL;
+
+    // Both branch tables are unbiased, so each set of targets gets the start of a page.
+    DmacDescriptor** targets = (DmacDescriptor**)&scratch[0];
+    uint8_t* count = &scratch[8];
+    uint8_t* passes = &scratch[9];
+    uint8_t* state = &scratch[10];
+    uint8_t* block_a = &scratch[16];
+    uint8_t* block_b = &scratch[32];
+    DmacDescriptor** state_targets = (DmacDescriptor**)&scratch[1 * 256];
+    uint8_t* a_lo = &scratch[2 * 256];
+    uint8_t* a_hi = &scratch[3 * 256];
+    uint8_t* b_lo = &scratch[4 * 256];
+    uint8_t* b_hi = &scratch[5 * 256];
+
+    DmacDescriptor* d = descs;
+    DmacDescriptor* exit = 0;
+
+    d = build_copy(d, &cmp_equal, state, 1);
+
+    if (npasses > 0) {
+        *passes = npasses;
+        setup_index_to_addr(a_lo, a_hi, a, -SCAN_UNROLL, (npasses + 1) * SCAN_UNROLL);
+        setup_index_to_addr(b_lo, b_hi, b, -SCAN_UNROLL, (npasses + 1) * SCAN_UNROLL);
+
+        d = build_copy(d, passes, count, 1);
+
+        DmacDescriptor* body = d;
+        d = build_indexed_copy(d, a, a_lo, a_hi, count, block_a, SCAN_UNROLL);
+        d = build_indexed_copy(d, b, b_lo, b_hi, count, block_b, SCAN_UNROLL);
+        for (uint32_t k = 0; k < SCAN_UNROLL; k++) {
+            d = build_strcmp_byte(d, eng, &block_a[k], &block_b[k], state);
+        }
+
+        // Keep going while the state is still "equal so far".
+        DmacDescriptor* next = build_branch(d, eng->branch, state, state_targets);
+        state_targets[1] = next;
+
+        d = build_lookup(next, eng->dec, count, count);
+        exit = build_branch(d, eng->branch, count, targets);
+        targets[0] = body;
+        targets[1] = exit;
+        d = exit;
+    }
+
+    // Once the state has stuck, running the tail anyway doesn't change it.
+    for (uint32_t k = 0; k < tail; k++) {
+        const uint32_t i = (npasses * SCAN_UNROLL) + k;
+        d = build_strcmp_byte(d, eng, &a[i], &b[i], state);
+    }
+
+    if (npasses > 0) {
+        state_targets[0] = d;
+    }
+    return build_lookup(d, eng->result, state, (volatile uint8_t*)result);
+}
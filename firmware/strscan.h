@@ -0,0 +1,82 @@
+#ifndef _STRSCAN_H
+#define _STRSCAN_H
+
+#include <stdint.h>
+#include "dma.h"
+#include "dmainstrs.h"
+
+// Bytes looked at per loop pass, i.e. per branch.
+#define SCAN_UNROLL 8
+
+// *result of build_memchr() when the byte isn't there.
+#define SCAN_NOT_FOUND 0xffff
+
+/**
+ * Tables shared by every scan_engine_t; see strscan.c.
+ */
+typedef struct scan_luts {
+    const uint8_t* found;       // SCAN_UNROLL x 256, page k -> itself: "found at byte k of the block"
+    const uint8_t* offset;      // SCAN_UNROLL x 256, [k][x] -> x + k
+    const uint8_t* to_offset;   // state -> page of offset, for the found states
+    const uint8_t* done;        // state -> byte offset 12 for the found states, 8 otherwise
+    const uint8_t* dec;         // loop counter
+    const uint8_t* branch;      // setup_branch_if_zero(), unbiased
+} scan_luts_t;
+
+/**
+ * Tables for finding one particular byte value.
+ */
+typedef struct scan_engine {
+    const scan_luts_t* luts;
+    const uint8_t* steps;       // SCAN_UNROLL x 256, [k][byte] -> state after byte k of a block
+} scan_engine_t;
+
+#define SCAN_LUTS_SIZE   (((2 * SCAN_UNROLL) + 4) * 256)
+#define SCAN_ENGINE_SIZE (SCAN_UNROLL * 256)
+#define SCAN_SCRATCH     (6 * 256)
+#define SCAN_DESCS       (32 + (2 * SCAN_UNROLL))
+
+void setup_scan_luts(scan_luts_t* luts, uint8_t* mem);
+void setup_scan_engine(scan_engine_t* eng, const scan_luts_t* luts, uint8_t c, uint8_t* mem);
+DmacDescriptor* build_memchr(DmacDescriptor* descs,
+                             const scan_engine_t* eng,
+                             const volatile uint8_t* buf,
+                             uint32_t n,
+                             volatile uint16_t* result,
+                             uint8_t* scratch);
+DmacDescriptor* build_strnlen(DmacDescriptor* descs,
+                              const scan_engine_t* eng,
+                              const volatile uint8_t* s,
+                              uint32_t maxlen,
+                              volatile uint16_t* result,
+                              uint8_t* scratch);
+
+/**
+ * Tables for build_strncmp(). The compare state is 0x00 (equal so far), 0x01 (a > b), 0xff
+ * (a < b) or 0x02 (equal up to and including a NUL); each of them has a page in cmp and nul.
+ */
+typedef struct strcmp_engine {
+    const digit_luts_t* luts;
+    const uint8_t* cmp;         // 4x256, setup_digit_compare() plus a page for 0x02
+    const uint8_t* to_cmp;      // state -> page of cmp
+    const uint8_t* nul;         // 4x256, [state][a] -> state after a byte that compared equal
+    const uint8_t* to_nul;      // state -> page of nul
+    const uint8_t* result;      // state -> 0, 1 or -1
+    const uint8_t* dec;         // loop counter
+    const uint8_t* branch;      // setup_branch_if_zero(), unbiased
+} strcmp_engine_t;
+
+#define STRCMP_ENGINE_SIZE (13 * 256)
+#define STRCMP_SCRATCH     (6 * 256)
+#define STRCMP_DESCS       (24 + (2 * SCAN_UNROLL * ((8 * DIGITS_PER_BYTE) + 4)))
+
+void setup_strcmp_engine(strcmp_engine_t* eng, const digit_luts_t* luts, uint8_t* mem);
+DmacDescriptor* build_strncmp(DmacDescriptor* descs,
+                              const strcmp_engine_t* eng,
+                              const volatile uint8_t* a,
+                              const volatile uint8_t* b,
+                              uint32_t n,
+                              volatile int8_t* result,
+                              uint8_t* scratch);
+
+#endif
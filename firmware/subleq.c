@@ -0,0 +1,327 @@
+/**
+ * A SUBLEQ interpreter made of descriptors, and a compiler from a small register ISA to SUBLEQ.
+ *
+ * The interpreter is one fixed loop whatever the program: fetch the 3 bytes at pc through a
+ * patched SRCADDR, load mem[a] and mem[b] with lookups into the SUBLEQ memory (which is itself
+ * 256-byte aligned, so it can be used as a table), subtract with build_add8(), and store the
+ * result back through a patched DSTADDR. The "<= 0" test needs no branch: a table turns the result
+ * into the offset of either c or pc + 3 in scratch, and that offset is patched into the copy that
+ * updates pc. The only real branch is the halt test at the top of the loop.
+ *
+ * The compiler runs on the CPU. Registers and two temporaries live in the top bytes of the SUBLEQ
+ * memory and the temporaries are kept at 0 between mini instructions. Loads, stores and indirect
+ * jumps are done the usual SUBLEQ way, by rewriting the operands of instructions further down.
+ * There's no bitwise op: SUBLEQ can only do those a bit at a time, which doesn't fit in 256 bytes.
+ */
+
+#include "subleq.h"
+
+#define MINI_Z 0xf8    // always 0 between mini instructions
+#define MINI_T 0xf9    // likewise
+
+#define MINI_MAX_CONSTS 32
+
+static const uint8_t subleq_zero = 0;
+
+/**
+ * Fills out the tables. 'mem' must start on a 256-byte boundary and have room for
+ * SUBLEQ_ENGINE_SIZE bytes.
+ */
+void setup_subleq_engine(subleq_engine_t* eng, const digit_luts_t* luts, uint8_t* mem)
+{
+    uint8_t* next = &mem[ADD8_ENGINE_SIZE + (0 * 256)];
+    uint8_t* select = &mem[ADD8_ENGINE_SIZE + (1 * 256)];
+    uint8_t* running = &mem[ADD8_ENGINE_SIZE + (2 * 256)];
+
+    setup_add8_engine(&eng->sub, luts, SUB8_WRAP, 0, mem);
+    eng->next = next;
+    eng->select = select;
+    eng->running = running;
+
+    // Offsets 10 and 11 are c and pc + 3 in build_subleq()'s scratch.
+    for (uint32_t count = 0; count < 256; count++) {
+        next[count] = count + 3;
+        select[count] = ((count == 0) || (count & 0x80)) ? 10 : 11;
+        running[count] = (count > SUBLEQ_MAX_PC) ? 4 : 0;
+    }
+}
+
+/**
+ * Runs the program in 'mem' on the CPU from pc = 0 until it halts or max_steps instructions have
+ * run, and returns the number of instructions run.
+ */
+uint32_t subleq_run(uint8_t* mem, uint32_t max_steps)
+{
+    uint32_t pc = 0;
+    uint32_t steps = 0;
+
+    while ((pc <= SUBLEQ_MAX_PC) && (steps < max_steps)) {
+        const uint8_t a = mem[pc];
+        const uint8_t b = mem[pc + 1];
+        const uint8_t c = mem[pc + 2];
+        mem[b] -= mem[a];
+        pc = ((int8_t)mem[b] <= 0) ? c : (pc + 3);
+        steps++;
+    }
+    return steps;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Compiler
+
+// Compilation is two passes over the program: the first only finds out where every mini
+// instruction starts and which constants are needed, the second writes the code.
+static uint8_t* code;
+static uint32_t here;
+static uint32_t code_end;
+static uint8_t addrs[256];
+static uint8_t consts[MINI_MAX_CONSTS];
+static uint32_t nconsts;
+static int error;
+
+static void emit(uint8_t a, uint8_t b, uint8_t c)
+{
+    if (here > SUBLEQ_MAX_PC) {
+        error = MINI_ERR_TOO_BIG;
+        return;
+    }
+    if (code) {
+        code[here + 0] = a;
+        code[here + 1] = b;
+        code[here + 2] = c;
+    }
+    here += 3;
+}
+
+// An instruction whose branch goes to the same place as falling through.
+static void emit_next(uint8_t a, uint8_t b) { emit(a, b, here + 3); }
+
+// The address of a byte holding v, placed after the code.
+static uint8_t konst(uint8_t v)
+{
+    uint32_t i;
+    for (i = 0; (i < nconsts) && (consts[i] != v); i++);
+    if (i == nconsts) {
+        if (nconsts == MINI_MAX_CONSTS) {
+            error = MINI_ERR_TOO_BIG;
+            return 0;
+        }
+        consts[nconsts++] = v;
+    }
+    return code_end + i;
+}
+
+static void compile_instr(const mini_instr_t* in, uint32_t n)
+{
+    const uint8_t rd = MINI_REG(in->rd);
+    const uint8_t rs = MINI_REG(in->rs);
+    const uint8_t target = ((in->imm >= 0) && ((uint32_t)in->imm < n)) ? addrs[in->imm] : 0;
+    uint32_t x;
+
+    switch (in->op) {
+    case MINI_LI:
+        emit_next(rd, rd);
+        if (in->imm != 0) { emit_next(konst(-in->imm), rd); }
+        break;
+
+    case MINI_MOV:
+        if (rd == rs) { break; }
+        emit_next(rd, rd);
+        // fallthrough
+    case MINI_ADD:
+        emit_next(rs, MINI_Z);
+        emit_next(MINI_Z, rd);
+        emit_next(MINI_Z, MINI_Z);
+        break;
+
+    case MINI_SUB:
+        emit_next(rs, rd);
+        break;
+
+    case MINI_ADDI:
+        emit_next(konst(-in->imm), rd);
+        break;
+
+    case MINI_LW:
+        // x: subleq rs's target, Z
+        x = here + (5 * 3);
+        emit_next(x, x);
+        emit_next(rs, MINI_Z);
+        emit_next(MINI_Z, x);
+        emit_next(MINI_Z, MINI_Z);
+        emit_next(rd, rd);
+        emit_next(0, MINI_Z);
+        emit_next(MINI_Z, rd);
+        emit_next(MINI_Z, MINI_Z);
+        break;
+
+    case MINI_SW:
+        // x: subleq rd's target, rd's target; x + 3: subleq T, rd's target
+        x = here + (9 * 3);
+        emit_next(rd, MINI_Z);
+        emit_next(x + 0, x + 0);
+        emit_next(MINI_Z, x + 0);
+        emit_next(x + 1, x + 1);
+        emit_next(MINI_Z, x + 1);
+        emit_next(x + 4, x + 4);
+        emit_next(MINI_Z, x + 4);
+        emit_next(MINI_Z, MINI_Z);
+        emit_next(rs, MINI_T);
+        emit_next(0, 0);
+        emit_next(MINI_T, 0);
+        emit_next(MINI_T, MINI_T);
+        break;
+
+    case MINI_BEQ:
+        if (rd == rs) {
+            emit(MINI_Z, MINI_Z, target);
+            break;
+        }
+        // T = rd - rs. It's 0 if it's <= 0 but T + 1 isn't; -T would do instead of T + 1, except
+        // that -(-128) is -128. T is cleared on every way out.
+        x = here + (9 * 3);
+        emit_next(rd, MINI_Z);
+        emit_next(MINI_Z, MINI_T);
+        emit_next(MINI_Z, MINI_Z);
+        emit_next(rs, MINI_T);
+        emit(MINI_Z, MINI_T, here + 6);
+        emit(MINI_T, MINI_T, x);
+        emit(konst(0xff), MINI_T, here + 6);
+        emit(MINI_T, MINI_T, target);
+        emit(MINI_T, MINI_T, x);
+        break;
+
+    case MINI_BLEZ:
+        emit(MINI_Z, rd, target);
+        break;
+
+    case MINI_JMP:
+        emit(MINI_Z, MINI_Z, target);
+        break;
+
+    case MINI_JAL:
+        x = here + (3 * 3);
+        emit_next(rd, rd);
+        emit_next(konst(-x), rd);
+        emit(MINI_Z, MINI_Z, target);
+        break;
+
+    case MINI_JALR:
+        // x: subleq Z, Z, rs's target. rs is read before rd is written, so they can be the same.
+        x = here + (6 * 3);
+        emit_next(x + 2, x + 2);
+        emit_next(rs, MINI_Z);
+        emit_next(MINI_Z, x + 2);
+        emit_next(MINI_Z, MINI_Z);
+        emit_next(rd, rd);
+        emit_next(konst(-(x + 3)), rd);
+        emit(MINI_Z, MINI_Z, 0);
+        break;
+
+    case MINI_HALT:
+        emit(MINI_Z, MINI_Z, SUBLEQ_HALT);
+        break;
+
+    default:
+        error = MINI_ERR_INVALID;
+        break;
+    }
+}
+
+/**
+ * Compiles the n mini instructions at 'prog' into a SUBLEQ program in 'mem' (SUBLEQ_MEM_SIZE
+ * bytes), with the code starting at address 0 and the constants it needs right after it. The
+ * registers start out at 0; everything between the constants and MINI_RESERVED is left alone, for
+ * the program's data.
+ *
+ * Returns the number of bytes taken by code and constants, MINI_ERR_INVALID if an instruction has
+ * a bad opcode, register or jump target, or MINI_ERR_TOO_BIG if the program doesn't fit.
+ */
+int mini_compile(const mini_instr_t* prog, uint32_t n, uint8_t* mem)
+{
+    if (n > 256) { return MINI_ERR_TOO_BIG; }
+
+    for (uint32_t i = 0; i < n; i++) {
+        const int jumps = ((prog[i].op == MINI_BEQ) || (prog[i].op == MINI_BLEZ) ||
+                           (prog[i].op == MINI_JMP) || (prog[i].op == MINI_JAL));
+        if ((prog[i].rd >= MINI_NREGS) || (prog[i].rs >= MINI_NREGS)) { return MINI_ERR_INVALID; }
+        if (jumps && ((prog[i].imm < 0) || ((uint32_t)prog[i].imm >= n))) {
+            return MINI_ERR_INVALID;
+        }
+    }
+
+    error = 0;
+    for (uint32_t pass = 0; pass < 2; pass++) {
+        code = (pass == 0) ? 0 : mem;
+        here = 0;
+        nconsts = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            addrs[i] = here;
+            compile_instr(&prog[i], n);
+            if (error) { return error; }
+        }
+        code_end = here;
+    }
+
+    if ((code_end + nconsts) > MINI_RESERVED) { return MINI_ERR_TOO_BIG; }
+    for (uint32_t i = 0; i < nconsts; i++) { mem[code_end + i] = consts[i]; }
+    for (uint32_t i = MINI_REG(0); i < SUBLEQ_MEM_SIZE; i++) { mem[i] = 0; }
+    return code_end + nconsts;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Running SUBLEQ with the DMAC
+
+/**
+ * At most SUBLEQ_DESCS descriptors. Runs the program in 'mem' from pc = 0 until it halts. Nothing
+ * stops a program that never halts.
+ *
+ * 'mem' is SUBLEQ_MEM_SIZE bytes that must start on a 256-byte boundary. 'scratch' is
+ * SUBLEQ_SCRATCH bytes that must start on a 256-byte boundary and be private to this instance;
+ * it's filled in here.
+ */
+DmacDescriptor* build_subleq(DmacDescriptor* descs,
+                             const subleq_engine_t* eng,
+                             uint8_t* mem,
+                             uint8_t* scratch)
+{
+    // ins is a, b, c, pc + 3; eng->select picks one of the last two.
+    DmacDescriptor** targets = (DmacDescriptor**)&scratch[0];
+    uint8_t* ins = &scratch[8];
+    uint8_t* pc = &scratch[12];
+    uint8_t* va = &scratch[13];
+    uint8_t* vb = &scratch[14];
+    uint8_t* r = &scratch[15];
+    uint8_t* sub_scratch = &scratch[16];
+
+    DmacDescriptor* d = descs;
+
+    d = build_copy(d, &subleq_zero, pc, 1);
+
+    DmacDescriptor* top = d;
+    DmacDescriptor* body = build_branch(d, eng->running, pc, targets);
+
+    // The fetch's source address is the end of the instruction, which is also the next pc.
+    DmacDescriptor* fetch = body + 2;
+    build_lookup(body, eng->next, pc, desc_src_byte(fetch, 0));
+    dma_desc_set(fetch, DMAC_BTCTRL_BEATSIZE_BYTE | DMAC_BTCTRL_SRCINC | DMAC_BTCTRL_DSTINC, 3,
+                 mem, ins, fetch + 1);
+    d = build_copy(fetch + 1, desc_src_byte(fetch, 0), &ins[3], 1);
+
+    d = build_lookup(d, mem, &ins[0], va);
+    d = build_lookup(d, mem, &ins[1], vb);
+    d = build_add8(d, &eng->sub, vb, va, r, 0, sub_scratch);
+
+    DmacDescriptor* store = d + 1;
+    d = build_copy(d, &ins[1], desc_dst_byte(store, 0), 1);
+    dma_desc_set(store, DMAC_BTCTRL_BEATSIZE_BYTE, 1, r, mem, store + 1);
+
+    DmacDescriptor* select = store + 3;
+    build_lookup(store + 1, eng->select, r, desc_src_byte(select, 0));
+    dma_desc_set(select, DMAC_BTCTRL_BEATSIZE_BYTE, 1, scratch, pc, top);
+    d = select + 1;
+
+    targets[0] = body;
+    targets[1] = d;
+    return build_nop(d);
+}
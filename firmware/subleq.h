@@ -0,0 +1,75 @@
+#ifndef _SUBLEQ_H
+#define _SUBLEQ_H
+
+#include <stdint.h>
+#include "dma.h"
+#include "dmainstrs.h"
+
+/**
+ * A SUBLEQ machine has 256 bytes of memory holding both code and data. The instruction at pc is
+ * the 3 bytes a, b, c at mem[pc]: mem[b] -= mem[a], then if mem[b] as an int8_t is <= 0, pc = c,
+ * else pc += 3. It halts when pc goes past SUBLEQ_MAX_PC.
+ */
+#define SUBLEQ_MEM_SIZE 256
+#define SUBLEQ_MAX_PC   252
+#define SUBLEQ_HALT     0xff
+
+/**
+ * Tables for build_subleq(); they don't depend on the program.
+ */
+typedef struct subleq_engine {
+    add8_engine_t sub;          // SUB8_WRAP
+    const uint8_t* next;        // pc -> pc + 3
+    const uint8_t* select;      // mem[b] -> offset of the next pc in scratch
+    const uint8_t* running;     // pc -> 0 while running, 4 once halted
+} subleq_engine_t;
+
+#define SUBLEQ_ENGINE_SIZE (ADD8_ENGINE_SIZE + (3 * 256))
+#define SUBLEQ_SCRATCH     256
+#define SUBLEQ_DESCS       (20 + ADD8_DESCS)
+
+/**
+ * The mini-ISA: 8 byte registers and byte-addressed loads and stores into the SUBLEQ memory. Jump
+ * targets are indices into the program being compiled.
+ */
+typedef enum mini_op {
+    MINI_LI,      // rd = imm
+    MINI_MOV,     // rd = rs
+    MINI_ADD,     // rd += rs
+    MINI_SUB,     // rd -= rs
+    MINI_ADDI,    // rd += imm
+    MINI_LW,      // rd = mem[rs]
+    MINI_SW,      // mem[rd] = rs
+    MINI_BEQ,     // if rd == rs, jump to imm
+    MINI_BLEZ,    // if (int8_t)rd <= 0, jump to imm
+    MINI_JMP,     // jump to imm
+    MINI_JAL,     // rd = return address, jump to imm
+    MINI_JALR,    // rd = return address, jump to the address in rs
+    MINI_HALT
+} mini_op_t;
+
+typedef struct mini_instr {
+    mini_op_t op;
+    uint8_t rd;
+    uint8_t rs;
+    int16_t imm;
+} mini_instr_t;
+
+// Register r lives at mem[MINI_REG(r)]; memory from MINI_RESERVED up belongs to the compiler.
+#define MINI_NREGS    8
+#define MINI_REG(r)   (0xf0 + (r))
+#define MINI_RESERVED 0xf8
+
+#define MINI_ERR_INVALID (-1)
+#define MINI_ERR_TOO_BIG (-2)
+
+void setup_subleq_engine(subleq_engine_t* eng, const digit_luts_t* luts, uint8_t* mem);
+uint32_t subleq_run(uint8_t* mem, uint32_t max_steps);
+int mini_compile(const mini_instr_t* prog, uint32_t n, uint8_t* mem);
+
+DmacDescriptor* build_subleq(DmacDescriptor* descs,
+                             const subleq_engine_t* eng,
+                             uint8_t* mem,
+                             uint8_t* scratch);
+
+#endif
@@ -0,0 +1,254 @@
+/**
+ * Streaming pipeline from the SERCOM0 UART into descriptor chains.
+ *
+ * Two DMAC channels are involved:
+ *     * UART_RX_CHANNEL is triggered by SERCOM0's RXC, and moves every received byte into the next
+ *       slot of a ring. Each beat also fires a DMAC event.
+ *     * UART_RX_COMPUTE_CHANNEL runs a chain that loops forever: take the byte out of the next
+ *       ring slot, run the caller's compute descriptors on it, mark the slot done and move on.
+ *       When the next slot is empty it suspends itself; the event from the RX channel resumes it.
+ *
+ * Neither needs the CPU, which can sleep while data arrives. A byte can land just after the compute
+ * chain finds the ring empty but before it has suspended, and then its event doesn't resume
+ * anything. The SUSP interrupt catches that: once the chain has suspended, it's resumed again if
+ * the slot it's waiting on has been filled in the meantime. Bytes are never lost unless the ring
+ * overflows, which the tail watches for: see uart_rx_overran().
+ *
+ * uart_rx_inject() is a stand-in for the UART: it feeds a canned stream into the ring at the byte
+ * rate of a given baud rate, paced by TC3, so that a pipeline can be exercised without a sender.
+ */
+
+#include "samd21g18a.h"
+#include "uart_rx.h"
+#include "dmac.h"
+#include "dmainstrs.h"
+
+// init_hardware() runs GCLK0 (and the CPU) straight off of OSC8M.
+#define UART_RX_CLOCK_HZ 8000000ul
+
+static const uint8_t slot_done = 0xff;
+
+/**
+ * Sets up the pipe's tables and marks every slot of the ring as done. nslots must be from 2 to 256.
+ * 'scratch' is UART_RX_SCRATCH bytes that must start on a 256-byte boundary.
+ */
+void uart_rx_pipe_init(uart_rx_pipe_t* pipe, uint16_t* ring, uint32_t nslots, uint8_t* scratch)
+{
+    pipe->ring = ring;
+    pipe->nslots = nslots;
+    pipe->scratch = scratch;
+    pipe->byte = &scratch[10];
+    pipe->check = 0;
+    pipe->injecting = 0;
+
+    for (uint32_t i = 0; i < nslots; i++) { ring[i] = 0xff00; }
+
+    // page 0: jump targets, slot index, the current slot and the index of the one before it
+    scratch[8] = 0;
+    setup_index_to_addr(&scratch[1 * 256], &scratch[2 * 256], ring, 2, 2);
+    setup_increment_mod(&scratch[3 * 256], nslots);
+    setup_branch_if_zero(&scratch[4 * 256]);
+
+    // page 5: index of the slot before each one; page 6: the overrun flag at 0x00
+    for (uint32_t i = 0; i < 256; i++) { scratch[(5 * 256) + i] = (i + nslots - 1) % nslots; }
+    scratch[6 * 256] = 0;
+}
+
+/**
+ * UART_RX_HEAD_DESCS descriptors. Waits for the next byte to arrive and copies it to pipe->byte.
+ * The caller's compute chain goes right after, followed by build_uart_rx_tail().
+ */
+DmacDescriptor* build_uart_rx_head(DmacDescriptor* descs, uart_rx_pipe_t* pipe)
+{
+    uint8_t* scratch = pipe->scratch;
+    DmacDescriptor** targets = (DmacDescriptor**)&scratch[0];    // page-aligned; branch is unbiased
+    uint8_t* index = &scratch[8];
+    uint8_t* slot = &scratch[10];
+    DmacDescriptor* d = descs;
+
+    pipe->check = d;
+    d = build_indexed_copy(d, pipe->ring, &scratch[1 * 256], &scratch[2 * 256], index, slot, 2);
+
+    DmacDescriptor* wait = build_branch(d, &scratch[4 * 256], &slot[1], targets);
+    dma_desc_set(wait, DMAC_BTCTRL_BEATSIZE_BYTE | DMAC_BTCTRL_BLOCKACT_SUSPEND, 1,
+                 &slot_done, &scratch[12], pipe->check);
+
+    // the high byte of the slot is nonzero when it's empty
+    targets[0] = wait;
+    targets[1] = wait + 1;
+    return wait + 1;
+}
+
+/**
+ * UART_RX_TAIL_DESCS descriptors. Marks the current slot done and goes back to the head for the
+ * next one. Like build_branch(), the last descriptor isn't linked to the next slot.
+ *
+ * On the way, it checks whether the slot before the current one has been filled again. If it has,
+ * the RX channel has gone all the way around the ring and is about to write over bytes that haven't
+ * been processed, so the overrun flag gets set.
+ */
+DmacDescriptor* build_uart_rx_tail(DmacDescriptor* descs, uart_rx_pipe_t* pipe)
+{
+    uint8_t* scratch = pipe->scratch;
+    uint8_t* index = &scratch[8];
+    uint8_t* prev = &scratch[13];
+    uint8_t* flags = &scratch[6 * 256];
+    DmacDescriptor* d = descs;
+
+    d = build_indexed_store(d, pipe->ring, &scratch[1 * 256], &scratch[2 * 256], index,
+                            &slot_done, 1);
+
+    // The previous slot's high byte (0x00 when filled, 0xff when done) becomes the low byte of
+    // where a nonzero byte is written: the flag, or a byte of the flag page nothing reads.
+    d = build_lookup(d, &scratch[5 * 256], index, prev);
+    DmacDescriptor* set_flag = d + 5;
+    d = build_indexed_copy(d, pipe->ring, &scratch[1 * 256], &scratch[2 * 256], prev,
+                           desc_dst_byte(set_flag, 0), 1);
+    dma_desc_set(set_flag, DMAC_BTCTRL_BEATSIZE_BYTE, 1, &slot_done, flags, set_flag + 1);
+    d = set_flag + 1;
+
+    d = build_lookup(d, &scratch[3 * 256], index, index);
+    (d - 1)->DESCADDR.reg = (uint32_t)pipe->check;
+    return d;
+}
+
+static void uart_rx_interrupt(uint8_t channel, uint8_t flags, void* ctx)
+{
+    uart_rx_pipe_t* pipe = ctx;
+
+    // The slot index only moves on once a byte has been processed, so it's still the slot that was
+    // found empty.
+    const uint8_t index = pipe->scratch[8];
+    if ((flags & DMAC_CHINTFLAG_SUSP) && ((pipe->ring[index] >> 8) != slot_done)) {
+        dmac_resume(channel);
+    }
+}
+
+/**
+ * Routes the RX channel's per-beat event to the compute channel, where it resumes a suspended
+ * chain, and starts the compute chain.
+ */
+static void uart_rx_start_compute(uart_rx_pipe_t* pipe)
+{
+    PM->APBCMASK.reg |= PM_APBCMASK_EVSYS;
+    GCLK->CLKCTRL.reg = (GCLK_CLKCTRL_CLKEN |
+                         GCLK_CLKCTRL_GEN_GCLK0 |
+                         GCLK_CLKCTRL_ID(GCLK_CLKCTRL_ID_EVSYS_0_Val));
+
+    // EVSYS channel 0; USER.CHANNEL is the channel number + 1.
+    EVSYS->USER.reg = (EVSYS_USER_USER(EVSYS_ID_USER_DMAC_CH_0 + UART_RX_COMPUTE_CHANNEL) |
+                       EVSYS_USER_CHANNEL(0 + 1));
+    EVSYS->CHANNEL.reg = (EVSYS_CHANNEL_CHANNEL(0) |
+                          EVSYS_CHANNEL_EVGEN(EVSYS_ID_GEN_DMAC_CH_0 + UART_RX_CHANNEL) |
+                          EVSYS_CHANNEL_PATH_RESYNCHRONIZED |
+                          EVSYS_CHANNEL_EDGSEL_RISING_EDGE);
+
+    dmac_set_handler(UART_RX_COMPUTE_CHANNEL, DMAC_CHINTENSET_SUSP, uart_rx_interrupt, pipe);
+    dmac_enable(UART_RX_COMPUTE_CHANNEL, pipe->check, (DMAC_CHCTRLB_EVIE |
+                                                       DMAC_CHCTRLB_EVACT_RESUME |
+                                                       DMAC_CHCTRLB_TRIGACT_TRANSACTION |
+                                                       DMAC_CHCTRLB_TRIGSRC(0) |
+                                                       DMAC_CHCTRLB_LVL(0)));
+    dmac_trigger(UART_RX_COMPUTE_CHANNEL);
+}
+
+/**
+ * Starts processing bytes from SERCOM0, which init_hardware() has already set up. The compute
+ * chain (build_uart_rx_head(), the caller's descriptors, build_uart_rx_tail()) has to be built
+ * first.
+ */
+void uart_rx_start(uart_rx_pipe_t* pipe)
+{
+    uart_rx_start_compute(pipe);
+
+    dma_desc_set(&pipe->rx_desc, (DMAC_BTCTRL_EVOSEL_BEAT |
+                                  DMAC_BTCTRL_DSTINC |
+                                  DMAC_BTCTRL_BEATSIZE_HWORD),
+                 pipe->nslots, &SERCOM0->USART.DATA.reg, pipe->ring, &pipe->rx_desc);
+
+    // The RX channel gets the higher priority so that the compute chain can't starve it.
+    dmac_enable(UART_RX_CHANNEL, &pipe->rx_desc, (DMAC_CHCTRLB_EVOE |
+                                                  DMAC_CHCTRLB_TRIGACT_BEAT |
+                                                  DMAC_CHCTRLB_TRIGSRC(SERCOM0_DMAC_ID_RX) |
+                                                  DMAC_CHCTRLB_LVL(1)));
+}
+
+/**
+ * Stand-in for uart_rx_start() that feeds 'stream' into the ring as if it was arriving over a UART
+ * at 'baud' with 8N1 framing, instead of listening to SERCOM0.
+ *
+ * Every entry of 'stream' is a received byte in the low byte and 0 in the high byte, which is what
+ * reading SERCOM0's DATA register gives. 'descs' is room for (len / nslots) + 1 descriptors.
+ */
+void uart_rx_inject(uart_rx_pipe_t* pipe,
+                    DmacDescriptor* descs,
+                    const uint16_t* stream,
+                    uint32_t len,
+                    uint32_t baud)
+{
+    DmacDescriptor* d = descs;
+    for (uint32_t done = 0; done < len; done += pipe->nslots) {
+        const uint32_t n = ((len - done) < pipe->nslots) ? (len - done) : pipe->nslots;
+        dma_desc_set(d, (DMAC_BTCTRL_EVOSEL_BEAT |
+                         DMAC_BTCTRL_SRCINC |
+                         DMAC_BTCTRL_DSTINC |
+                         DMAC_BTCTRL_BEATSIZE_HWORD),
+                     n, &stream[done], pipe->ring, d + 1);
+        d++;
+    }
+    dma_chain_terminate(d - 1);
+
+    uart_rx_start_compute(pipe);
+
+    // TC3 overflows once per byte time: 10 bits of 8N1 frame.
+    PM->APBCMASK.reg |= PM_APBCMASK_TC3;
+    GCLK->CLKCTRL.reg = (GCLK_CLKCTRL_CLKEN |
+                         GCLK_CLKCTRL_GEN_GCLK0 |
+                         GCLK_CLKCTRL_ID(GCLK_CLKCTRL_ID_TCC2_TC3_Val));
+    TC3->COUNT16.CTRLA.reg = TC_CTRLA_SWRST;
+    while (TC3->COUNT16.CTRLA.reg & TC_CTRLA_SWRST);
+    TC3->COUNT16.CTRLA.reg = (TC_CTRLA_MODE_COUNT16 |
+                              TC_CTRLA_WAVEGEN_MFRQ |
+                              TC_CTRLA_PRESCALER_DIV1);
+    TC3->COUNT16.CC[0].reg = ((UART_RX_CLOCK_HZ * 10) / baud) - 1;
+    while (TC3->COUNT16.STATUS.reg & TC_STATUS_SYNCBUSY);
+
+    dmac_enable(UART_RX_CHANNEL, descs, (DMAC_CHCTRLB_EVOE |
+                                         DMAC_CHCTRLB_TRIGACT_BEAT |
+                                         DMAC_CHCTRLB_TRIGSRC(TC3_DMAC_ID_OVF) |
+                                         DMAC_CHCTRLB_LVL(1)));
+
+    pipe->injecting = 1;
+    TC3->COUNT16.CTRLA.reg |= TC_CTRLA_ENABLE;
+}
+
+/**
+ * Returns 1 if every byte that has arrived so far has been processed.
+ */
+int uart_rx_idle(const uart_rx_pipe_t* pipe)
+{
+    for (uint32_t i = 0; i < pipe->nslots; i++) {
+        if ((pipe->ring[i] >> 8) != slot_done) return 0;
+    }
+    return 1;
+}
+
+/**
+ * Returns 1 if the ring has filled up since uart_rx_pipe_init(), so bytes may have been lost: the
+ * compute chain isn't keeping up with the line rate.
+ */
+int uart_rx_overran(const uart_rx_pipe_t* pipe)
+{
+    return *(const volatile uint8_t*)&pipe->scratch[6 * 256] != 0;
+}
+
+void uart_rx_stop(uart_rx_pipe_t* pipe)
+{
+    if (pipe->injecting) {
+        TC3->COUNT16.CTRLA.reg &= ~TC_CTRLA_ENABLE;
+        pipe->injecting = 0;
+    }
+    dmac_stop(UART_RX_CHANNEL);
+    dmac_stop(UART_RX_COMPUTE_CHANNEL);
+    dmac_set_handler(UART_RX_COMPUTE_CHANNEL, 0, 0, 0);
+}
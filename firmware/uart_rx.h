@@ -0,0 +1,41 @@
+#ifndef _UART_RX_H
+#define _UART_RX_H
+
+#include <stdint.h>
+#include "dma.h"
+
+#define UART_RX_SCRATCH    (7 * 256)
+#define UART_RX_HEAD_DESCS 10
+#define UART_RX_TAIL_DESCS 15
+
+/**
+ * A stream of bytes from SERCOM0, processed by a descriptor chain as they arrive.
+ *
+ * Every slot of the ring is a half-word: the received byte, and a high byte that is 0x00 when the
+ * slot holds a byte that hasn't been processed yet and 0xff once it has.
+ */
+typedef struct uart_rx_pipe {
+    DmacDescriptor rx_desc __attribute__((aligned(16)));    // fills the ring, looping on itself
+    uint16_t* ring;
+    uint32_t nslots;
+    uint8_t* scratch;
+    const volatile uint8_t* byte;    // the byte being processed, for the compute chain to read
+    DmacDescriptor* check;           // first descriptor of the compute chain
+    int injecting;
+} uart_rx_pipe_t;
+
+void uart_rx_pipe_init(uart_rx_pipe_t* pipe, uint16_t* ring, uint32_t nslots, uint8_t* scratch);
+DmacDescriptor* build_uart_rx_head(DmacDescriptor* descs, uart_rx_pipe_t* pipe);
+DmacDescriptor* build_uart_rx_tail(DmacDescriptor* descs, uart_rx_pipe_t* pipe);
+
+void uart_rx_start(uart_rx_pipe_t* pipe);
+void uart_rx_inject(uart_rx_pipe_t* pipe,
+                    DmacDescriptor* descs,
+                    const uint16_t* stream,
+                    uint32_t len,
+                    uint32_t baud);
+int uart_rx_idle(const uart_rx_pipe_t* pipe);
+int uart_rx_overran(const uart_rx_pipe_t* pipe);
+void uart_rx_stop(uart_rx_pipe_t* pipe);
+
+#endif
@@ -0,0 +1,39 @@
+/**
+ * Sending a buffer out of the SERCOM0 UART without the CPU.
+ *
+ * One descriptor moves the buffer into the DATA register a beat at a time, and every beat waits
+ * for SERCOM0's data register empty trigger. Anything that builds its output into a buffer (like
+ * build_codec()) can have it sent this way once its chain has finished.
+ */
+
+#include "samd21g18a.h"
+#include "uart_tx.h"
+#include "dmac.h"
+#include "dmainstrs.h"
+
+/**
+ * Starts sending the len bytes at 'buf' (at most 65535) and returns right away. 'desc' and 'buf'
+ * have to stay put until uart_tx_busy() returns 0. SERCOM0 has to be set up already, which
+ * init_hardware() does.
+ */
+void uart_tx_start(DmacDescriptor* desc, const volatile uint8_t* buf, uint32_t len)
+{
+    dma_desc_set(desc, DMAC_BTCTRL_SRCINC | DMAC_BTCTRL_BEATSIZE_BYTE, len, buf,
+                 &SERCOM0->USART.DATA.reg, 0);
+    dmac_enable(UART_TX_CHANNEL, desc, (DMAC_CHCTRLB_TRIGACT_BEAT |
+                                        DMAC_CHCTRLB_TRIGSRC(SERCOM0_DMAC_ID_TX) |
+                                        DMAC_CHCTRLB_LVL(1)));
+}
+
+int uart_tx_busy(void)
+{
+    return dmac_busy(UART_TX_CHANNEL);
+}
+
+/**
+ * Abandons whatever is left of the buffer.
+ */
+void uart_tx_stop(void)
+{
+    dmac_stop(UART_TX_CHANNEL);
+}
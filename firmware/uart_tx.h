@@ -0,0 +1,11 @@
+#ifndef _UART_TX_H
+#define _UART_TX_H
+
+#include <stdint.h>
+#include "dma.h"
+
+void uart_tx_start(DmacDescriptor* desc, const volatile uint8_t* buf, uint32_t len);
+int uart_tx_busy(void);
+void uart_tx_stop(void);
+
+#endif